@@ -0,0 +1,182 @@
+// Copyright 2026 Adobe
+// All Rights Reserved.
+//
+// NOTICE: Adobe permits you to use, modify, and distribute this file in accordance with the terms
+// of the Adobe license agreement accompanying it.
+
+// identity
+#include "corpus.hpp"
+
+// stdc++
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**************************************************************************************************/
+
+namespace {
+
+/**************************************************************************************************/
+// Each unit defines one of these variant types. Units that are picked for an ODRV give theirs an
+// extra member, so its size differs from the other units' (a `structure:byte_size` ODRV.)
+constexpr std::size_t variant_count_k = 16;
+
+/**************************************************************************************************/
+
+std::ofstream open(const std::filesystem::path& path) {
+    std::ofstream result(path);
+    if (!result) throw std::runtime_error("could not write " + path.string());
+    return result;
+}
+
+std::string namespace_path(std::size_t depth) {
+    std::string result;
+    for (std::size_t i = 0; i != depth; ++i) {
+        if (i) result += "::";
+        result += "n" + std::to_string(i);
+    }
+    return result;
+}
+
+/**************************************************************************************************/
+
+void write_header(const std::filesystem::path& directory, const corpus_options& options) {
+    auto out = open(directory / "corpus.hpp");
+
+    out << "// Generated by orc_bench --generate\n"
+           "#pragma once\n"
+           "\n"
+           "#include <cstddef>\n"
+           "\n"
+           "namespace corpus {\n"
+           "\n"
+           "template <class T, int N>\n"
+           "struct box {\n"
+           "    T _values[N + 1];\n"
+           "    std::size_t size() const { return sizeof(_values) / sizeof(T); }\n"
+           "};\n"
+           "\n";
+
+    for (std::size_t i = 0; i != options._depth; ++i) {
+        out << "namespace n" << i << " {\n";
+    }
+
+    for (std::size_t i = 0; i != options._types; ++i) {
+        out << "\nstruct type_" << i << " {\n"
+            << "    int _a;\n"
+            << "    double _b;\n";
+        if (i) out << "    const type_" << (i - 1) << "* _previous;\n";
+        out << "    std::size_t total() const { return sizeof(*this) + " << i << "; }\n"
+            << "};\n";
+    }
+
+    out << '\n';
+    for (std::size_t i = 0; i != options._depth; ++i) {
+        out << "} // namespace n" << (options._depth - i - 1) << '\n';
+    }
+
+    out << "\n} // namespace corpus\n";
+}
+
+/**************************************************************************************************/
+
+void write_unit(const std::filesystem::path& directory,
+                const corpus_options& options,
+                std::size_t index,
+                bool odrv) {
+    std::ostringstream name;
+    name << "unit_" << std::setw(6) << std::setfill('0') << index << ".cpp";
+    auto out = open(directory / name.str());
+
+    const std::size_t variant = index % variant_count_k;
+    const std::string ns = options._depth ? namespace_path(options._depth) + "::" : std::string();
+
+    out << "// Generated by orc_bench --generate\n"
+           "#include \"corpus.hpp\"\n"
+           "\n"
+           "namespace corpus {\n"
+           "\n"
+        << "struct variant_" << variant << " {\n"
+        << "    int _a;\n";
+    if (odrv) out << "    long _b;\n";
+    out << "};\n"
+        << "\n"
+        << "std::size_t unit_" << index << "() {\n"
+        << "    std::size_t result = sizeof(variant_" << variant << ");\n";
+
+    for (std::size_t i = 0; i != options._types; ++i) {
+        const std::string type = ns + "type_" + std::to_string(i);
+        out << "    result += " << type << "{}.total();\n";
+        for (std::size_t j = 0; j != options._fanout; ++j) {
+            out << "    result += box<" << type << ", " << j << ">{}.size();\n";
+        }
+    }
+
+    out << "    return result;\n"
+        << "}\n"
+        << "\n"
+        << "} // namespace corpus\n";
+}
+
+/**************************************************************************************************/
+
+void write_makefile(const std::filesystem::path& directory) {
+    auto out = open(directory / "Makefile");
+
+    out << "# Generated by orc_bench --generate\n"
+           "CXX ?= clang++\n"
+           "CXXFLAGS ?= -g -std=c++17\n"
+           "\n"
+           "OBJECTS := $(patsubst %.cpp,%.o,$(wildcard unit_*.cpp))\n"
+           "\n"
+           "all: $(OBJECTS)\n"
+           "\n"
+           "%.o: %.cpp corpus.hpp\n"
+           "\t$(CXX) $(CXXFLAGS) -c $< -o $@\n"
+           "\n"
+           "clean:\n"
+           "\trm -f $(OBJECTS)\n"
+           "\n"
+           ".PHONY: all clean\n";
+}
+
+/**************************************************************************************************/
+
+} // namespace
+
+/**************************************************************************************************/
+
+void generate_corpus(const std::filesystem::path& directory, const corpus_options& options) {
+    std::filesystem::create_directories(directory);
+
+    write_header(directory, options);
+    write_makefile(directory);
+
+    std::mt19937_64 generator(options._seed);
+    std::uniform_real_distribution<double> odds(0, 1);
+    std::vector<bool> variant_odrv(variant_count_k, false);
+    std::vector<bool> variant_plain(variant_count_k, false);
+
+    for (std::size_t i = 0; i != options._units; ++i) {
+        const bool odrv = odds(generator) < options._odrv_rate;
+        (odrv ? variant_odrv : variant_plain)[i % variant_count_k] = true;
+        write_unit(directory, options, i, odrv);
+    }
+
+    // A variant is only an ODRV if it was defined both ways.
+    std::size_t expected{0};
+    for (std::size_t i = 0; i != variant_count_k; ++i) {
+        expected += variant_odrv[i] && variant_plain[i];
+    }
+
+    std::cout << "wrote " << options._units << " units to " << directory.string() << "; a scan of "
+              << "their objects should report " << expected << " ODRV(s)\n"
+              << "build them with: make -C " << directory.string() << " -j\n";
+}
+
+/**************************************************************************************************/
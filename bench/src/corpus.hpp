@@ -0,0 +1,29 @@
+// Copyright 2026 Adobe
+// All Rights Reserved.
+//
+// NOTICE: Adobe permits you to use, modify, and distribute this file in accordance with the terms
+// of the Adobe license agreement accompanying it.
+
+#pragma once
+
+// stdc++
+#include <cstddef>
+#include <filesystem>
+
+/**************************************************************************************************/
+// The shape of a generated corpus (see `generate_corpus`.)
+struct corpus_options {
+    std::size_t _units{1000}; // translation units
+    std::size_t _types{32}; // types in the shared header, all of which each unit uses
+    std::size_t _depth{3}; // namespaces the types are nested in
+    std::size_t _fanout{4}; // instantiations of the class template, per type
+    double _odrv_rate{0.01}; // the odds a unit defines its variant type differently
+    std::size_t _seed{42};
+};
+
+// Writes a corpus of C++ sources to `directory`: a shared header, `_units` translation units that
+// use it, and a Makefile that compiles each unit to an object file with debug info. A scan of the
+// objects finds one ODRV for each variant type that some unit defined differently.
+void generate_corpus(const std::filesystem::path& directory, const corpus_options& options);
+
+/**************************************************************************************************/
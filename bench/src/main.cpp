@@ -0,0 +1,545 @@
+// stdc++
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// orc
+#include <orc/dwarf_structs.hpp>
+#include <orc/hash.hpp>
+#include <orc/object_file_registry.hpp>
+#include <orc/orc.hpp>
+#include <orc/parse_file.hpp>
+#include <orc/string_pool.hpp>
+
+// bench
+#include "corpus.hpp"
+
+/**************************************************************************************************/
+/*
+    orc_bench measures the parts of ORC that are hot enough to be worth measuring on their own.
+
+    Usage: orc_bench [corpus.txt ...]
+           orc_bench --generate <directory> [--units N] [--types N] [--depth N] [--fanout N]
+                     [--odrv-rate R] [--seed N]
+           orc_bench --scan <object file or directory> ... [--objects N]
+
+    hashing: A corpus is a text file with one string per line, ideally captured from a real scan,
+    e.g.:
+
+        find build -name "*.o" -exec nm -jU {} + > corpus.txt
+
+    The strings are bucketed by length, and each bucket is hashed repeatedly with every hash ORC
+    has, so the throughput of each can be compared by string length. This is skipped if no corpus
+    is given.
+
+    leb128: Decodes a buffer of LEB128 values with `uleb128` and `sleb128`, and with a byte-at-a-time
+    decoder for comparison. This is done once with mostly one byte values, as in DWARF, and once
+    with values of two bytes or more.
+
+    empool: Interns the corpus strings (or generated symbol names, without a corpus) once, when
+    they are all new to the string pool, and again when they are all found there.
+
+    register_die, enforce_odrv_for_die_list: Registers generated dies, several per symbol, in the
+    die map, and reviews generated lists of them for ODRVs, as `orc_process` does.
+
+    --generate: Writes a corpus of C++ sources (see `corpus_options` for what the options do),
+    along with a Makefile to compile them. Scanning corpora of different sizes gives the scaling
+    curve of a whole ORC scan.
+
+    --scan: Runs `orc_process` over the object files, the first `--objects` of them if given, and
+    reports how fast the DWARF was processed. For a directory, every .o file in it is scanned.
+*/
+/**************************************************************************************************/
+
+namespace {
+
+/**************************************************************************************************/
+
+using clock_type = std::chrono::steady_clock;
+
+constexpr std::size_t target_bytes_k = std::size_t(256) << 20; // hashed per hash, per bucket
+
+/**************************************************************************************************/
+
+struct bucket {
+    std::size_t _max_length{0}; // inclusive; the last bucket takes everything else
+    std::vector<std::string> _strings;
+    std::size_t _bytes{0};
+};
+
+auto make_buckets() {
+    std::vector<bucket> result;
+    for (std::size_t n : {8, 16, 32, 64, 128, 256, 1024}) {
+        result.push_back(bucket{n});
+    }
+    result.push_back(bucket{std::numeric_limits<std::size_t>::max()});
+    return result;
+}
+
+void read_corpus(const std::filesystem::path& path, std::vector<bucket>& buckets) {
+    std::ifstream input(path);
+    if (!input) {
+        throw std::runtime_error("could not read corpus " + path.string());
+    }
+
+    std::string line;
+    while (std::getline(input, line)) {
+        if (line.empty()) continue;
+
+        auto found = std::find_if(buckets.begin(), buckets.end(), [&](const bucket& b) {
+            return line.size() <= b._max_length;
+        });
+        found->_bytes += line.size();
+        found->_strings.push_back(std::move(line));
+    }
+}
+
+/**************************************************************************************************/
+// Returns the throughput of `hash` over the bucket in MiB/s, and the time per string in ns.
+template <class F>
+auto measure(const bucket& b, F hash) {
+    const std::size_t passes = std::max<std::size_t>(1, target_bytes_k / b._bytes);
+
+    // Accumulated and printed, so the hashing can't be optimized away.
+    static volatile std::size_t sink = 0;
+    std::size_t accumulated = 0;
+
+    const auto start = clock_type::now();
+    for (std::size_t i = 0; i != passes; ++i) {
+        for (const auto& s : b._strings) {
+            accumulated += hash(s);
+        }
+    }
+    const std::chrono::duration<double> elapsed = clock_type::now() - start;
+
+    sink = sink + accumulated;
+
+    const double mib = static_cast<double>(b._bytes * passes) / (1 << 20);
+    const double strings = static_cast<double>(b._strings.size() * passes);
+    return std::make_pair(mib / elapsed.count(), elapsed.count() * 1e9 / strings);
+}
+
+/**************************************************************************************************/
+
+void bench_hashes(const std::vector<bucket>& buckets) {
+    std::cout << "string_hash is " << orc::string_hash_name() << "\n\n";
+    std::cout << std::setw(12) << "length" << std::setw(10) << "strings" << std::setw(18)
+              << "murmur3 MiB/s" << std::setw(12) << "ns/string" << std::setw(22)
+              << "string_hash MiB/s" << std::setw(12) << "ns/string" << '\n';
+
+    std::size_t min_length = 0;
+
+    for (const auto& b : buckets) {
+        const std::size_t max_length = b._max_length;
+
+        if (!b._strings.empty()) {
+            const auto murmur = measure(b, [](const std::string& s) {
+                return orc::murmur3_64(s.data(), static_cast<int>(s.size()));
+            });
+            const auto fast = measure(b, [](const std::string& s) {
+                return orc::string_hash(s.data(), s.size());
+            });
+
+            std::string range = std::to_string(min_length) + "..";
+            if (max_length != std::numeric_limits<std::size_t>::max()) {
+                range += std::to_string(max_length);
+            }
+
+            std::cout << std::fixed << std::setprecision(1) << std::setw(12) << range
+                      << std::setw(10) << b._strings.size() << std::setw(18) << murmur.first
+                      << std::setw(12) << murmur.second << std::setw(22) << fast.first
+                      << std::setw(12) << fast.second << '\n';
+        }
+
+        min_length = max_length + 1;
+    }
+}
+
+/**************************************************************************************************/
+// The decoder `uleb128` used to be, minus its 32-bit limit. Kept out of line, as it was in
+// parse_file.cpp, so the comparison is a fair one.
+[[gnu::noinline]] std::uint64_t uleb128_bytewise(freader& s) {
+    std::uint64_t result{0};
+    std::size_t shift{0};
+
+    while (true) {
+        const auto c = static_cast<std::uint8_t>(s.get());
+        if (shift < 64) result |= std::uint64_t(c & 0x7f) << shift;
+        if (!(c & 0x80)) return result;
+        shift += 7;
+    }
+}
+
+void encode_uleb128(std::vector<char>& out, std::uint64_t x) {
+    do {
+        char c = x & 0x7f;
+        x >>= 7;
+        if (x) c |= 0x80;
+        out.push_back(c);
+    } while (x);
+}
+
+void encode_sleb128(std::vector<char>& out, std::int64_t x) {
+    while (true) {
+        char c = x & 0x7f;
+        x >>= 7;
+        if ((x == 0 && !(c & 0x40)) || (x == -1 && (c & 0x40))) {
+            out.push_back(c);
+            return;
+        }
+        out.push_back(c | 0x80);
+    }
+}
+
+template <class F>
+void measure_leb128(const char* name, const std::filesystem::path& path, std::size_t count, F f) {
+    constexpr std::size_t passes_k = 20;
+
+    freader s(path);
+    std::size_t accumulated = 0;
+
+    const auto start = clock_type::now();
+    for (std::size_t i = 0; i != passes_k; ++i) {
+        s.seekg(0);
+        for (std::size_t j = 0; j != count; ++j) {
+            accumulated += f(s);
+        }
+    }
+    const std::chrono::duration<double> elapsed = clock_type::now() - start;
+
+    static volatile std::size_t sink = 0;
+    sink = sink + accumulated;
+
+    const double mib = static_cast<double>(s.size() * passes_k) / (1 << 20);
+    std::cout << std::fixed << std::setprecision(2) << std::setw(20) << name << std::setw(12)
+              << elapsed.count() * 1e9 / (count * passes_k) << " ns/value" << std::setw(12)
+              << mib / elapsed.count() << " MiB/s\n";
+}
+
+// `one_byte_percent` of the values fit in one byte; the rest take two or more.
+void bench_leb128(const char* mix, std::size_t one_byte_percent) {
+    constexpr std::size_t count_k = 4 * 1024 * 1024;
+
+    std::mt19937_64 generator(42);
+    std::vector<char> unsigned_values;
+    std::vector<char> signed_values;
+
+    for (std::size_t i = 0; i != count_k; ++i) {
+        const bool one_byte = generator() % 100 < one_byte_percent;
+        const int bits = one_byte ? 7 : 8 + generator() % 56;
+        const std::uint64_t x = generator() & ((std::uint64_t(1) << bits) - 1);
+        encode_uleb128(unsigned_values, x);
+        encode_sleb128(signed_values, (generator() & 1) ? -static_cast<std::int64_t>(x / 2)
+                                                        : static_cast<std::int64_t>(x / 2));
+    }
+
+    const auto directory = std::filesystem::temp_directory_path();
+    const auto unsigned_path = directory / "orc_bench_uleb128.bin";
+    const auto signed_path = directory / "orc_bench_sleb128.bin";
+    std::ofstream(unsigned_path, std::ios::binary)
+        .write(unsigned_values.data(), unsigned_values.size());
+    std::ofstream(signed_path, std::ios::binary).write(signed_values.data(), signed_values.size());
+
+    std::cout << "\nleb128, " << mix << " (" << count_k << " values)\n\n";
+    measure_leb128("bytewise", unsigned_path, count_k, uleb128_bytewise);
+    measure_leb128("uleb128", unsigned_path, count_k, uleb128);
+    measure_leb128("sleb128", signed_path, count_k, sleb128);
+
+    std::filesystem::remove(unsigned_path);
+    std::filesystem::remove(signed_path);
+}
+
+/**************************************************************************************************/
+
+double elapsed_ns(clock_type::time_point start, std::size_t count) {
+    const std::chrono::duration<double> elapsed = clock_type::now() - start;
+    return elapsed.count() * 1e9 / std::max<std::size_t>(count, 1);
+}
+
+/**************************************************************************************************/
+// Symbol-like names, for when there is no corpus.
+std::vector<std::string> generated_strings() {
+    constexpr std::size_t count_k = 1024 * 1024;
+    std::vector<std::string> result;
+    result.reserve(count_k);
+    for (std::size_t i = 0; i != count_k; ++i) {
+        result.push_back("corpus::n0::n1::type_" + std::to_string(i / 16) + "::member_" +
+                         std::to_string(i % 16));
+    }
+    return result;
+}
+
+void bench_empool(const std::vector<std::string>& strings) {
+    constexpr std::size_t hit_passes_k = 4;
+
+    std::cout << "\nempool (" << strings.size() << " strings)\n\n";
+
+    const auto before = empool_statistics();
+
+    auto start = clock_type::now();
+    for (const auto& s : strings) {
+        (void)empool(s);
+    }
+    const double new_ns = elapsed_ns(start, strings.size());
+
+    start = clock_type::now();
+    for (std::size_t i = 0; i != hit_passes_k; ++i) {
+        for (const auto& s : strings) {
+            (void)empool(s);
+        }
+    }
+    const double found_ns = elapsed_ns(start, strings.size() * hit_passes_k);
+
+    const auto after = empool_statistics();
+    const std::size_t lookups = after._lookups - before._lookups;
+    const std::size_t hits = after._hits - before._hits;
+
+    std::cout << std::fixed << std::setprecision(2) << std::setw(20) << "new" << std::setw(12)
+              << new_ns << " ns/string\n"
+              << std::setw(20) << "found" << std::setw(12) << found_ns << " ns/string\n"
+              << std::setw(20) << "hit rate" << std::setw(12)
+              << (lookups ? 100. * hits / lookups : 0) << " %\n"
+              << std::setw(20) << "pool bytes" << std::setw(12) << (after._bytes - before._bytes)
+              << '\n';
+}
+
+/**************************************************************************************************/
+// `symbols` symbols, each defined in `instances` object files. One in `conflict_interval` of them
+// has a different definition in one of its object files.
+std::vector<die> generated_dies(std::size_t symbols,
+                                std::size_t instances,
+                                std::size_t conflict_interval) {
+    std::vector<std::uint32_t> ofds;
+    for (std::size_t i = 0; i != instances; ++i) {
+        object_ancestry ancestry;
+        ancestry.emplace_back(empool("bench_" + std::to_string(i) + ".o"));
+        ofds.push_back(static_cast<std::uint32_t>(
+            object_file_register(std::move(ancestry), file_details())));
+    }
+
+    std::vector<die> result;
+    result.reserve(symbols * instances);
+
+    for (std::size_t i = 0; i != symbols; ++i) {
+        const pool_string path = empool("::[u]::corpus::symbol_" + std::to_string(i));
+        for (std::size_t j = 0; j != instances; ++j) {
+            die d;
+            d._path = path;
+            d._hash = path.hash();
+            d._fatal_attribute_hash = i % conflict_interval == 0 && j == 0 ? ~i : i;
+            d._ofd_index = ofds[instances - j - 1]; // in reverse, so the review has to sort them
+            d._tag = dw::tag::structure_type;
+            result.push_back(d);
+        }
+    }
+
+    return result;
+}
+
+void bench_register_die() {
+    constexpr std::size_t symbols_k = 256 * 1024;
+    constexpr std::size_t instances_k = 4;
+
+    orc_reset();
+    auto dies = generated_dies(symbols_k, instances_k, 100);
+
+    std::cout << "\nregister_die (" << symbols_k << " symbols, " << instances_k
+              << " dies each)\n\n";
+
+    const auto start = clock_type::now();
+    for (auto& d : dies) {
+        orc::register_die(std::move(d));
+    }
+    const double ns = elapsed_ns(start, dies.size());
+
+    std::cout << std::fixed << std::setprecision(2) << std::setw(20) << "register_die"
+              << std::setw(12) << ns << " ns/die" << std::setw(12) << 1e3 / ns << " Mdies/s\n";
+
+    orc_reset();
+}
+
+void bench_enforce_odrv_for_die_list() {
+    constexpr std::size_t symbols_k = 64 * 1024;
+    constexpr std::size_t passes_k = 5;
+
+    std::cout << "\nenforce_odrv_for_die_list (" << symbols_k << " lists per pass)\n\n";
+
+    for (std::size_t instances : {2, 8, 64}) {
+        auto dies = generated_dies(symbols_k, instances, 100);
+        object_file_rank_by_ancestry();
+        clock_type::duration elapsed{0};
+
+        for (std::size_t pass = 0; pass != passes_k; ++pass) {
+            // Relinked each pass, in the original (unsorted) order.
+            std::vector<die*> heads;
+            for (std::size_t i = 0; i != dies.size(); ++i) {
+                const bool last = (i + 1) % instances == 0;
+                dies[i]._next_die = last ? nullptr : &dies[i + 1];
+                dies[i]._conflict = false;
+                if (i % instances == 0) heads.push_back(&dies[i]);
+            }
+
+            const auto start = clock_type::now();
+            for (die* head : heads) {
+                (void)enforce_odrv_for_die_list(head);
+            }
+            elapsed += clock_type::now() - start;
+        }
+
+        const double ns =
+            std::chrono::duration<double>(elapsed).count() * 1e9 / (symbols_k * passes_k);
+        std::cout << std::fixed << std::setprecision(2) << std::setw(14) << instances
+                  << " dies" << std::setw(12) << ns << " ns/list" << std::setw(12)
+                  << ns / instances << " ns/die\n";
+    }
+}
+
+/**************************************************************************************************/
+
+void bench_scan(const std::vector<std::filesystem::path>& inputs, std::size_t max_objects) {
+    std::vector<std::filesystem::path> objects;
+
+    for (const auto& input : inputs) {
+        if (!is_directory(input)) {
+            objects.push_back(input);
+            continue;
+        }
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(input)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".o") {
+                objects.push_back(entry.path());
+            }
+        }
+    }
+
+    std::sort(objects.begin(), objects.end());
+    if (max_objects && objects.size() > max_objects) objects.resize(max_objects);
+
+    const std::size_t object_count = objects.size();
+    orc_reset();
+
+    const auto start = clock_type::now();
+    const auto reports = orc_process(std::move(objects));
+    const std::chrono::duration<double> elapsed = clock_type::now() - start;
+
+    const auto& g = globals::instance();
+    std::cout << "scan (" << object_count << " objects)\n\n"
+              << std::fixed << std::setprecision(2) << std::setw(20) << "seconds" << std::setw(14)
+              << elapsed.count() << '\n'
+              << std::setw(20) << "dies processed" << std::setw(14) << g._die_processed_count
+              << '\n'
+              << std::setw(20) << "dies skipped" << std::setw(14) << g._die_skipped_count << '\n'
+              << std::setw(20) << "unique symbols" << std::setw(14) << g._unique_symbol_count
+              << '\n'
+              << std::setw(20) << "Mdies/s" << std::setw(14)
+              << g._die_processed_count / elapsed.count() / 1e6 << '\n'
+              << std::setw(20) << "ODRVs" << std::setw(14) << reports.size() << '\n';
+}
+
+/**************************************************************************************************/
+// The value following the option at `i`, which is consumed.
+std::string option_value(const std::vector<std::string>& args, std::size_t& i) {
+    if (i + 1 == args.size()) throw std::runtime_error("missing value for " + args[i]);
+    return args[++i];
+}
+
+corpus_options parse_corpus_options(const std::vector<std::string>& args, std::size_t first) {
+    corpus_options result;
+
+    for (std::size_t i = first; i < args.size(); ++i) {
+        const auto& arg = args[i];
+        if (arg == "--units") {
+            result._units = std::stoul(option_value(args, i));
+        } else if (arg == "--types") {
+            result._types = std::stoul(option_value(args, i));
+        } else if (arg == "--depth") {
+            result._depth = std::stoul(option_value(args, i));
+        } else if (arg == "--fanout") {
+            result._fanout = std::stoul(option_value(args, i));
+        } else if (arg == "--odrv-rate") {
+            result._odrv_rate = std::stod(option_value(args, i));
+        } else if (arg == "--seed") {
+            result._seed = std::stoul(option_value(args, i));
+        } else {
+            throw std::runtime_error("unknown option " + arg);
+        }
+    }
+
+    return result;
+}
+
+/**************************************************************************************************/
+
+} // namespace
+
+/**************************************************************************************************/
+
+int main(int argc, char** argv) try {
+    const std::vector<std::string> args(argv + 1, argv + argc);
+
+    if (!args.empty() && args[0] == "--generate") {
+        if (args.size() < 2) throw std::runtime_error("--generate needs a directory");
+        generate_corpus(args[1], parse_corpus_options(args, 2));
+        return EXIT_SUCCESS;
+    }
+
+    if (!args.empty() && args[0] == "--scan") {
+        std::vector<std::filesystem::path> inputs;
+        std::size_t max_objects{0};
+        for (std::size_t i = 1; i < args.size(); ++i) {
+            if (args[i] == "--objects") {
+                max_objects = std::stoul(option_value(args, i));
+            } else {
+                inputs.push_back(args[i]);
+            }
+        }
+        bench_scan(inputs, max_objects);
+        return EXIT_SUCCESS;
+    }
+
+    std::vector<std::string> strings;
+
+    if (!args.empty()) {
+        auto buckets = make_buckets();
+
+        for (const auto& corpus : args) {
+            read_corpus(corpus, buckets);
+        }
+
+        bench_hashes(buckets);
+
+        for (const auto& b : buckets) {
+            strings.insert(strings.end(), b._strings.begin(), b._strings.end());
+        }
+    } else {
+        strings = generated_strings();
+    }
+
+    // Like DWARF: mostly one byte values (abbreviation codes, small constants).
+    bench_leb128("dwarf-like", 80);
+    bench_leb128("multi-byte", 0);
+
+    bench_empool(strings);
+    bench_register_die();
+    bench_enforce_odrv_for_die_list();
+
+    return EXIT_SUCCESS;
+} catch (const std::exception& error) {
+    std::cerr << "Fatal error: " << error.what() << '\n';
+    return EXIT_FAILURE;
+} catch (...) {
+    std::cerr << "Fatal error: unknown\n";
+    return EXIT_FAILURE;
+}
+
+/**************************************************************************************************/
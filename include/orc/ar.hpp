@@ -8,12 +8,14 @@
 
 // stdc++
 #include <iostream>
+#include <optional>
+#include <unordered_map>
 
 // application
 #include "orc/parse_file.hpp"
 
 /**************************************************************************************************/
-
+// Reads every `.o` file in the archive, or only the one named by `params._ar_member` if it is set.
 void read_ar(object_ancestry&& ancestry,
              freader& s,
              std::istream::pos_type end_pos,
@@ -21,3 +23,18 @@ void read_ar(object_ancestry&& ancestry,
              macho_params params);
 
 /**************************************************************************************************/
+// Debug maps name the members of archives as `/path/to/bar.a(foo.o)`.
+struct ar_member_path {
+    std::filesystem::path _archive;
+    std::string _member;
+};
+
+// Splits a path of the form above into the archive and the member. Returns `std::nullopt` for any
+// other path.
+std::optional<ar_member_path> parse_ar_member_path(const std::filesystem::path& path);
+
+// The modification time of each `.o` file in the archive at `path`, by name, as recorded in the
+// archive's headers. Empty if the archive cannot be read.
+std::unordered_map<std::string, std::uint64_t> ar_member_times(const std::filesystem::path& path);
+
+/**************************************************************************************************/
@@ -6,7 +6,17 @@
 
 #pragma once
 
-#include <functional>
+// stdc++
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <exception>
+#include <utility>
+
+// application
+#include "orc/features.hpp"
+#include "orc/settings.hpp"
+#include "orc/task_system.hpp"
 
 //======================================================================================================================
 
@@ -14,15 +24,129 @@ namespace orc {
 
 //======================================================================================================================
 
+namespace detail {
+
+//======================================================================================================================
+// Counts the work items that have been enqueued but have not yet completed. Every work item holds
+// a `work_token` for its lifetime. Incrementing and decrementing the count are single atomic
+// operations; the waiting thread is only woken when the count reaches its target.
+struct work_counter {
+    std::atomic<std::size_t> _n{0};
+    // The number of work items that are themselves blocked in `block_on_work`.
+    std::atomic<std::size_t> _blocked{0};
+};
+
+work_counter& work();
+
+// Called when the count may have reached the target of one of the threads in `block_on_work`.
+void work_target_reached();
+
+struct work_token {
+    work_token() { work()._n.fetch_add(1, std::memory_order_relaxed); }
+    work_token(const work_token&) : work_token() {}
+    work_token(work_token&& t) noexcept : _live{std::exchange(t._live, false)} {}
+    ~work_token() {
+        if (!_live) return;
+        auto& w = work();
+        const std::size_t n = w._n.fetch_sub(1, std::memory_order_acq_rel) - 1;
+        if (n <= w._blocked.load(std::memory_order_acquire)) work_target_reached();
+    }
+
+private:
+    bool _live{true};
+};
+
+//======================================================================================================================
+// The number of work items currently executing on this thread. It is usually zero or one, but can
+// be more when a work item calls `block_on_work`, which then runs other work items while it waits.
+inline std::size_t& task_depth() {
+    thread_local std::size_t _depth{0};
+    return _depth;
+}
+
+#if ORC_FEATURE(TRACY)
+void name_worker_thread();
+#endif // ORC_FEATURE(TRACY)
+
+template <class F>
+void invoke_work(F& f) {
+    ++task_depth();
+
+    // I changed my opinion on this: an unhandled background task exception should terminate
+    // the application. This mimics the behavior of an unhandled exception on the main
+    // thread. Now (like main thread exceptions) background task exceptions must be
+    // handled before they hit this point.
+    try {
+        f();
+    } catch (const std::exception& error) {
+        const char* what = error.what();
+        (void)what; // so you can see it in the debugger.
+        assert(!"unhandled background task exception");
+        std::terminate();
+    } catch (...) {
+        assert(!"unknown unhandled background task exception");
+        std::terminate();
+    }
+
+    --task_depth();
+}
+
+//======================================================================================================================
+
+} // namespace detail
+
+//======================================================================================================================
+
 // Enqueue a task for (possibly asynchronous) execution. If the `parallel_processing` setting in the
 // ORC config file is true, the task will be enqueued for processing on a background thread pool.
-// Otherwise, the task will be executed immediately in the current thread.
-void do_work(std::function<void()>);
+// Otherwise, the task will be executed immediately in the current thread. The task is moved
+// directly into the work item; it need not be copyable.
+template <class F>
+void do_work(F&& f) {
+    if (!settings::instance()._parallel_processing) {
+        detail::invoke_work(f);
+        return;
+    }
+
+    orc::task_system<>{}([_token = detail::work_token(), _f = std::forward<F>(f)]() mutable {
+#if ORC_FEATURE(TRACY)
+        detail::name_worker_thread();
+#endif // ORC_FEATURE(TRACY)
+        detail::invoke_work(_f);
+    });
+}
 
-// blocks the calling thread until all enqueued work items have completed. If the
-// `parallel_processing` setting in the ORC config file is `false`, this will return immediately.
+// blocks the calling thread until all enqueued work items have completed. While it waits, the
+// calling thread runs pending work items itself. When called from within a work item, other work
+// items that are also blocked in this routine are not waited upon. If the `parallel_processing`
+// setting in the ORC config file is `false`, this will return immediately.
 void block_on_work();
 
+//======================================================================================================================
+// A set of work items that can be waited on apart from all the others. A work item that fans out
+// work of its own waits on it with this, rather than with `block_on_work`, which would also wait
+// on every unrelated item in the queue.
+class work_group {
+public:
+    // As `orc::do_work`, and the item is counted as a part of this group.
+    template <class F>
+    void do_work(F&& f) {
+        _n.fetch_add(1, std::memory_order_relaxed);
+        orc::do_work([this, _f = std::forward<F>(f)]() mutable {
+            _f();
+            if (_n.fetch_sub(1, std::memory_order_acq_rel) == 1) detail::work_target_reached();
+        });
+    }
+
+    // Blocks the calling thread until every item in the group has completed. While it waits, the
+    // calling thread runs pending work items (of any group) itself. If the `parallel_processing`
+    // setting in the ORC config file is `false`, this will return immediately.
+    void block();
+
+private:
+    std::atomic<std::size_t> _n{0};
+};
+
 //======================================================================================================================
 
 } // namespace orc
@@ -0,0 +1,55 @@
+// Copyright 2024 Adobe
+// All Rights Reserved.
+//
+// NOTICE: Adobe permits you to use, modify, and distribute this file in accordance with the terms
+// of the Adobe license agreement accompanying it.
+
+#pragma once
+
+// stdc++
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**************************************************************************************************/
+/*
+    ORC can run as a long-lived daemon (`orc --daemon`) that links are sent to over a Unix domain
+    socket (see the `daemon_socket` setting.) Between links the daemon keeps the string pool and
+    the dies of every object it has seen in memory (up to the `daemon_cache_mb` setting), so a link
+    whose inputs mostly haven't changed only has to parse the ones that have. The object file registry is started over for each link.
+
+    The client sends the arguments it was invoked with, along with its working directory. The
+    daemon processes the link as ORC would have, and sends back everything it would have written
+    to standard output and standard error (each on its own), the JSON report (if any), and the
+    exit code. The client takes care of the output file. Links are processed one at a time. The
+    socket is only accessible to the user who started the daemon, and links from other users are
+    refused.
+*/
+namespace orc {
+
+/**************************************************************************************************/
+
+struct daemon_result {
+    int _exit_code{EXIT_FAILURE};
+    std::string _json_report; // only produced in the `json` output file mode
+};
+
+// Processes one link in the daemon. `args` are the client's command line arguments, `argv[0]`
+// included.
+using daemon_handler = std::function<daemon_result(std::vector<std::string>&& args)>;
+
+// Serves links sent to `socket_path` until the process is killed. Does not return.
+[[noreturn]] void daemon_serve(const std::filesystem::path& socket_path, daemon_handler handler);
+
+// Sends the link to the daemon listening on `socket_path`, and writes its output to the console.
+// Returns the daemon's exit code, or nothing if no daemon could be reached.
+std::optional<int> daemon_request(const std::filesystem::path& socket_path, int argc, char** argv);
+
+/**************************************************************************************************/
+
+} // namespace orc
+
+/**************************************************************************************************/
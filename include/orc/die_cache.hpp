@@ -0,0 +1,90 @@
+// Copyright 2024 Adobe
+// All Rights Reserved.
+//
+// NOTICE: Adobe permits you to use, modify, and distribute this file in accordance with the terms
+// of the Adobe license agreement accompanying it.
+
+#pragma once
+
+// stdc++
+#include <cstdint>
+#include <vector>
+
+// application
+#include "orc/dwarf_structs.hpp"
+#include "orc/parse_file.hpp"
+
+/**************************************************************************************************/
+/*
+    The die cache is an optional file (see the `die_cache_file` setting) that records the
+    registered dies of every object file ORC scans. On a subsequent run, an object file whose
+    contents have not changed has its dies registered straight from the cache, without parsing any
+    of its DWARF.
+
+    Objects are identified by a hash of their contents, so a cache entry is good no matter where
+    the object lives (e.g., inside an archive) or how its timestamp changes. The cache file is
+    rewritten at the end of every run, holding only the objects seen during that run.
+
+    The file is laid out so it can be used straight from its memory mapping: dies are fixed-width
+    records, and their strings are adopted by the string pool without being copied. The same
+    files can be used read-only as prebuilt caches (see the `prebuilt_die_caches` setting.)
+*/
+namespace orc {
+
+/**************************************************************************************************/
+
+struct die_cache_key {
+    std::uint64_t _hash{0};
+    std::uint64_t _size{0};
+
+    friend bool operator==(const die_cache_key& x, const die_cache_key& y) {
+        return x._hash == y._hash && x._size == y._size;
+    }
+};
+
+/**************************************************************************************************/
+
+// Which dies get registered depends on more than an object file's contents: the build of ORC,
+// and the settings that filter dies (`symbol_ignore`, `skip_subtrees`, `accelerated_scan`.) This
+// hashes those details. Files of registered dies (the cache, and die indices) record it, and are
+// only good for a run with the same one.
+std::uint64_t die_registration_fingerprint();
+
+bool die_cache_enabled();
+
+// Keeps the dies of every object file seen in a run in memory, so later runs in the same process
+// register them from there, as if they were in the cache file. Used by the daemon. The dies of
+// earlier runs are kept, too, until they pass the `daemon_cache_mb` budget; then those that have
+// gone unused the longest are dropped.
+void die_cache_make_resident();
+
+// Derives the key for the object file found at `[offset, offset + size)` in `s`.
+die_cache_key die_cache_key_for(const freader& s, std::size_t offset, std::size_t size);
+
+// Reads the cache file, if there is one. To be called before any dies are registered.
+void die_cache_load();
+
+// If the object file is in the cache, registers its dies as belonging to `ofd_index`, and returns
+// `true`. Thread safe.
+bool die_cache_register(const die_cache_key& key, std::uint32_t ofd_index);
+
+// Records the dies registered for an object file that was not found in the cache. Thread safe.
+void die_cache_store(const die_cache_key& key,
+                     const std::vector<die>& dies,
+                     std::size_t processed_count,
+                     std::size_t skipped_count);
+
+// Writes out the cache file (and, if the cache is resident, keeps this run's entries for the next
+// one.) To be called once all dies have been registered.
+void die_cache_save();
+
+// Forgets the hits and misses recorded since the last `die_cache_save`, without writing them. Each
+// pass of a multi-pass scan (see the `hash_partitions` setting) sees the same objects as the first
+// one, which is the only pass that is saved.
+void die_cache_discard();
+
+/**************************************************************************************************/
+
+} // namespace orc
+
+/**************************************************************************************************/
@@ -0,0 +1,47 @@
+// Copyright 2026 Adobe
+// All Rights Reserved.
+//
+// NOTICE: Adobe permits you to use, modify, and distribute this file in accordance with the terms
+// of the Adobe license agreement accompanying it.
+
+#pragma once
+
+// stdc++
+#include <filesystem>
+
+/**************************************************************************************************/
+/*
+    A die index holds the registered dies of a scan, and the object files they came from, so that
+    the scan and the review can happen on different machines. Each machine in a build farm scans
+    a share of the inputs with `orc --emit-index`, and one of them reviews all of the dies with
+    `orc --merge`, as if it had registered them itself.
+
+    Only what the review needs of a die is in the index: its hashes, path, tag, location, and
+    where it is in its object file. The attributes of the dies that conflict are fetched from their
+    object files when the reports are built, so those files must be found at the same paths on the
+    machine doing the merge. (Relative paths are made absolute when the index is written.)
+
+    Every machine, and the merge, must run the same build of ORC with the same settings for
+    filtering dies (see `die_registration_fingerprint`); an index written otherwise is rejected.
+
+    Every input should be scanned by exactly one machine. The same object file scanned twice still
+    reports the same ODRVs, but its dies are reviewed twice over.
+*/
+namespace orc {
+
+/**************************************************************************************************/
+
+// Writes every registered die, and every registered object file, to the index at `path`. Nothing
+// else can be registering dies at the time.
+void die_index_write(const std::filesystem::path& path);
+
+// Registers the object files and the dies in the index at `path`. The dies are registered as
+// `register_die` would be (so they are subject to the current hash partition, see the
+// `hash_partitions` setting.) Thread safe.
+void die_index_read(const std::filesystem::path& path);
+
+/**************************************************************************************************/
+
+} // namespace orc
+
+/**************************************************************************************************/
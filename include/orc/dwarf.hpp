@@ -17,12 +17,19 @@
 
 using die_pair = std::tuple<die, attribute_sequence>;
 
+struct die_counts {
+    std::size_t _processed{0};
+    std::size_t _skipped{0};
+};
+
 struct dwarf {
     dwarf(std::uint32_t ofd_index, freader&& s, file_details&& details);
 
     void register_section(std::string name, std::size_t offset, std::size_t size);
 
-    void process_all_dies();
+    // Registers every die in the object file that should be reviewed for ODRVs. If `registered`
+    // is not null, a copy of every registered die is appended to it.
+    die_counts process_all_dies(std::vector<die>* registered = nullptr);
 
     die_pair fetch_one_die(std::size_t die_offset,
                            std::size_t cu_header_offset,
@@ -7,6 +7,7 @@
 #pragma once
 
 // stdc++
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <cstdint>
@@ -159,14 +160,41 @@ std::ostream& operator<<(std::ostream& s, const attribute& x);
 
 /**************************************************************************************************/
 // I'm not a fan of this name.
+//
+// One of these is made for every die ORC reads, so the attributes are kept inline (and nothing is
+// allocated) unless there are more of them than most abbreviations have.
 struct attribute_sequence {
-    using attributes_type = std::vector<attribute>;
-    using value_type = typename attributes_type::value_type;
-    using iterator = typename attributes_type::iterator;
-    using const_iterator = typename attributes_type::const_iterator;
+    static constexpr std::size_t inline_capacity_k = 12;
+
+    using value_type = attribute;
+    using iterator = attribute*;
+    using const_iterator = const attribute*;
+
+    attribute_sequence() = default;
+    attribute_sequence(const attribute_sequence&) = default;
+    attribute_sequence& operator=(const attribute_sequence&) = default;
+
+    attribute_sequence(attribute_sequence&& x) noexcept
+        : _inline(x._inline), _overflow(std::move(x._overflow)), _size(x._size),
+          _spilled(x._spilled) {
+        x._overflow.clear();
+        x._size = 0;
+        x._spilled = false;
+    }
+
+    attribute_sequence& operator=(attribute_sequence&& x) noexcept {
+        _inline = x._inline;
+        _overflow = std::move(x._overflow);
+        _size = x._size;
+        _spilled = x._spilled;
+        x._overflow.clear();
+        x._size = 0;
+        x._spilled = false;
+        return *this;
+    }
 
     void reserve(std::size_t size) {
-        _attributes.reserve(size);
+        if (size > inline_capacity_k) spill(size);
     }
 
     bool has(dw::at name) const {
@@ -220,34 +248,54 @@ struct attribute_sequence {
     }
 
     void push_back(const value_type& x) {
-        _attributes.push_back(x);
+        if (!_spilled) {
+            if (_size < inline_capacity_k) {
+                _inline[_size++] = x;
+                return;
+            }
+            spill(2 * inline_capacity_k);
+        }
+
+        _overflow.push_back(x);
+        ++_size;
     }
 
-    bool empty() const { return _attributes.empty(); }
+    bool empty() const { return _size == 0; }
 
-    auto size() const { return _attributes.size(); }
+    auto size() const { return _size; }
 
-    auto begin() { return _attributes.begin(); }
-    auto begin() const { return _attributes.begin(); }
-    auto end() { return _attributes.end(); }
-    auto end() const { return _attributes.end(); }
+    iterator begin() { return _spilled ? _overflow.data() : _inline.data(); }
+    const_iterator begin() const { return _spilled ? _overflow.data() : _inline.data(); }
+    iterator end() { return begin() + _size; }
+    const_iterator end() const { return begin() + _size; }
 
 private:
+    // Moves the attributes out of the inline storage, making room for `capacity` of them.
+    void spill(std::size_t capacity) {
+        _overflow.reserve(std::max(capacity, _size));
+        if (_spilled) return;
+        _overflow.assign(_inline.begin(), _inline.begin() + _size);
+        _spilled = true;
+    }
+
     std::tuple<bool, iterator> find(dw::at name) {
-        auto result = std::find_if(_attributes.begin(), _attributes.end(), [&](const auto& attr){
+        auto result = std::find_if(begin(), end(), [&](const auto& attr){
             return attr._name == name;
         });
-        return std::make_tuple(result != _attributes.end(), result);
+        return std::make_tuple(result != end(), result);
     }
 
     std::tuple<bool, const_iterator> find(dw::at name) const {
-        auto result = std::find_if(_attributes.begin(), _attributes.end(), [&](const auto& attr){
+        auto result = std::find_if(begin(), end(), [&](const auto& attr){
             return attr._name == name;
         });
-        return std::make_tuple(result != _attributes.end(), result);
+        return std::make_tuple(result != end(), result);
     }
 
-    attributes_type _attributes;
+    std::array<attribute, inline_capacity_k> _inline;
+    std::vector<attribute> _overflow; // holds every attribute once `_spilled`
+    std::size_t _size{0};
+    bool _spilled{false};
 };
 
 std::ostream& operator<<(std::ostream& s, const attribute_sequence& x);
@@ -295,41 +343,38 @@ const char* to_string(arch arch);
 
 /**************************************************************************************************/
 
-struct object_ancestry {
-    std::array<pool_string, 5> _ancestors;
-    std::size_t _count{0};
+// The files an object file was found in, from the top-level file given to ORC down to the object
+// file itself (e.g., `libfoo.a -> arm64 -> foo.o`.) Ancestries are interned as the nodes of a tree,
+// each of which names its parent, so an ancestry is only the id of its node, and the prefixes
+// ancestries have in common (like `libfoo.a -> arm64`) are stored once. There is no limit to the
+// depth of an ancestry. Nodes are never freed. Thread safe.
+class object_ancestry {
+public:
+    object_ancestry() = default; // the empty ancestry
 
-    auto begin() const { return _ancestors.begin(); }
-    auto end() const { return begin() + _count; }
+    bool empty() const { return _id == 0; }
+    std::size_t size() const;
 
-    auto& back() {
-        assert(_count);
-        return _ancestors[_count];
-    }
+    // The top-level file, and the object file itself. The ancestry must not be empty.
+    pool_string front() const;
+    pool_string back() const;
 
-    const auto& back() const {
-        assert(_count);
-        return _ancestors[_count];
-    }
+    // The names of the files, from the top-level file down.
+    std::vector<pool_string> names() const;
 
-    void emplace_back(pool_string&& ancestor) {
-        assert((_count + 1) < _ancestors.size());
-        _ancestors[_count++] = std::move(ancestor);
-    }
+    // Extends the ancestry with the next file down.
+    void emplace_back(pool_string&& ancestor);
 
-    bool operator<(const object_ancestry& rhs) const {
-        if (_count < rhs._count)
-            return true;
-        if (_count > rhs._count)
-            return false;
-        for(size_t i=0; i<_count; ++i) {
-            if (_ancestors[i].view() < rhs._ancestors[i].view())
-                return true;
-            if (_ancestors[i].view() > rhs._ancestors[i].view())
-                return false;
-        }
-        return false;
+    // Ancestries are interned, so they are equal if their ids are.
+    friend bool operator==(const object_ancestry& x, const object_ancestry& y) {
+        return x._id == y._id;
     }
+
+    // Shorter ancestries come first; those of the same size are in the order of their names.
+    bool operator<(const object_ancestry& rhs) const;
+
+private:
+    std::uint32_t _id{0};
 };
 
 std::ostream& operator<<(std::ostream& s, const object_ancestry& x);
@@ -348,27 +393,46 @@ std::ostream& operator<<(std::ostream& s, const object_ancestry& x);
 //       what their value is relative to.
 // All DWARF/DIE/scanning related variables should follow the above conventions.
 struct die {
-    // Because the quantity of these created at runtime can beon the order of millions of instances,
-    // these are ordered for optimal alignment. If you change the ordering, or add/remove items
-    // here, please consider alignment issues.
+    // Because the quantity of these created at runtime can be on the order of tens of millions of
+    // instances, this is kept to a single 64-byte cache line, and the fields are ordered for optimal
+    // alignment. Offsets are 32 bits and relative to the compilation unit, which is found by index
+    // (see `object_file_unit_register`), so a __debug_info section larger than 4GB is fine. If you
+    // change the ordering, or add/remove items here, please consider the size and alignment (there
+    // is a `static_assert` below to keep everyone honest.)
     pool_string _path;
     die* _next_die{nullptr};
-    std::optional<location> _location; // file_decl and file_line, if they exit for the die.
     std::size_t _hash{0};
     std::size_t _fatal_attribute_hash{0};
+    pool_string _location_file; // file_decl, if _has_location
+    std::uint32_t _location_line{0}; // file_line, if _has_location
     std::uint32_t _ofd_index{0}; // object file descriptor index
-    std::size_t _cu_header_offset{0}; // offset to the compilation unit that contains this die; relative to __debug_info
-    std::size_t _cu_die_offset{0}; // offset to the associated compilation unit die entry; relative to __debug_info
-    std::size_t _offset{0}; // offset of this die; relative to __debug_info
+    std::uint32_t _cu_index{0}; // the compilation unit that contains this die; see `object_file_unit_offset`
+    std::uint32_t _cu_die_offset{0}; // offset to the associated compilation unit die entry; relative to the unit
+    std::uint32_t _offset{0}; // offset of this die; relative to the unit
     dw::tag _tag{dw::tag::none};
     arch _arch{arch::unknown};
-    bool _has_children{false};
-    bool _conflict{false};
-    bool _skippable{false};
+    bool _has_children : 1 {false};
+    bool _conflict : 1 {false};
+    bool _skippable : 1 {false};
+    bool _has_location : 1 {false};
+
+    std::optional<location> definition_location() const {
+        if (!_has_location) return std::nullopt;
+        return location{_location_file, _location_line};
+    }
+
+    void set_definition_location(const std::optional<location>& x) {
+        _has_location = x.has_value();
+        if (!_has_location) return;
+        _location_file = x->file;
+        _location_line = static_cast<std::uint32_t>(x->loc);
+    }
 
     friend bool operator<(const die& x, const die& y);
 };
 
+static_assert(sizeof(die) <= 64, "die should fit in a cache line");
+
 std::ostream& operator<<(std::ostream& s, const die& x);
 
 using dies = std::vector<die>;
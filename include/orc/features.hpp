@@ -24,4 +24,9 @@
     #define ORC_PRIVATE_FEATURE_TRACY() 0
 #endif
 
+// Selects the hash behind `orc::string_hash` (and so behind every pool string): wyhash when
+// enabled, the 64-bit combination of MurmurHash3 otherwise. wyhash needs a 64x64->128 bit
+// multiply, which every compiler ORC is built with provides.
+#define ORC_PRIVATE_FEATURE_FAST_STRING_HASH() 1
+
 /**************************************************************************************************/
@@ -7,6 +7,8 @@
 #pragma once
 
 // stdc++
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
 
 /**************************************************************************************************/
@@ -66,6 +68,15 @@ inline std::size_t murmur3_64(const void* key, int len, uint32_t seed = 0) {
     return hash_combine(result.hi, result.lo);
 }
 
+/**************************************************************************************************/
+// The hash of pool strings (see `empool`), and so of symbol names and die paths. Which hash this
+// is depends on the `FAST_STRING_HASH` feature (see features.hpp). Either way the result only
+// needs to be stable for a given build; hashes that outlive the process (like the ones in the die
+// cache) are tagged with `string_hash_name`.
+std::size_t string_hash(const void* key, std::size_t len);
+
+const char* string_hash_name();
+
 /**************************************************************************************************/
 
 } // namespace orc
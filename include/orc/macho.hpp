@@ -7,6 +7,7 @@
 #pragma once
 
 // stdc++
+#include <functional>
 #include <iostream>
 
 // application
@@ -26,6 +27,15 @@ struct dwarf dwarf_from_macho(std::uint32_t ofd_index, macho_params params);
 
 /**************************************************************************************************/
 
-std::vector<std::filesystem::path> macho_derive_dylibs(const std::vector<std::filesystem::path>& root_binaries);
+// Called once for each binary or object file found by `macho_derive_dylibs`, from whichever thread
+// found it.
+using macho_found_callback = std::function<void(const std::filesystem::path&)>;
+
+// Walks the dependencies of the root binaries, the roots included, handing each one to `found` as
+// it is discovered. Returns once the walk is done, along with any work `found` handed off. The
+// result holds the dependency closure of each root (the root included), in the order of
+// `root_binaries`.
+std::vector<std::vector<std::filesystem::path>> macho_derive_dylibs(
+    const std::vector<std::filesystem::path>& root_binaries, macho_found_callback found);
 
 /**************************************************************************************************/
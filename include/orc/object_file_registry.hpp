@@ -6,6 +6,10 @@
 
 #pragma once
 
+// stdc++
+#include <cstdint>
+#include <vector>
+
 // application
 #include "orc/dwarf_structs.hpp"
 #include "orc/parse_file.hpp"
@@ -23,6 +27,22 @@ std::size_t object_file_register(object_ancestry&& ancestry, file_details&& deta
 
 const object_file_descriptor& object_file_fetch(std::size_t index);
 
+// The number of object files registered so far.
+std::size_t object_file_count();
+
+/**************************************************************************************************/
+// The review sorts the dies of a symbol by the ancestries of their object files. Comparing two
+// ancestries compares their names, so the registry is sorted by ancestry once, up front, and each
+// object file is given its rank in that order. Comparing ranks is then as good as comparing
+// ancestries. Object files with the same ancestry have the same rank.
+
+// Ranks every registered object file. Nothing can be registering object files at the time.
+void object_file_rank_by_ancestry();
+
+// The rank of the object file at `index`, which must have been registered before the last call
+// to `object_file_rank_by_ancestry`. Thread safe.
+std::uint32_t object_file_rank(std::size_t index);
+
 inline const object_ancestry& object_file_ancestry(std::size_t index) {
     return object_file_fetch(index)._ancestry;
 }
@@ -32,3 +52,44 @@ inline const file_details& object_file_details(std::size_t index) {
 }
 
 /**************************************************************************************************/
+// An object file whose contents are the same as one already registered (e.g., the same archive
+// member linked into several dylibs) needn't be processed again. This returns the index of the
+// first object file registered with the contents identified by `fingerprint` and `size`. If that
+// is not `index`, `index` is recorded as an alias of it, so reports can list everywhere its dies
+// are used. Thread safe.
+std::size_t object_file_deduplicate(std::uint64_t fingerprint,
+                                    std::uint64_t size,
+                                    std::size_t index);
+
+// The aliases recorded for the object file at `index`.
+std::vector<std::size_t> object_file_aliases(std::size_t index);
+
+// Records `alias` as an alias of the object file at `index`, as `object_file_deduplicate` would
+// have. For object files whose contents were compared elsewhere (see `die_index.hpp`.) Thread
+// safe.
+void object_file_add_alias(std::size_t index, std::size_t alias);
+
+/**************************************************************************************************/
+// A die keeps its offsets relative to the compilation unit it is in, so they fit in 32 bits however
+// large `__debug_info` gets (a 32-bit DWARF unit can't pass 4GB, but a dSYM full of them can.) The
+// units' own offsets are kept here, and a die refers to its unit by index.
+
+// Records the unit at `cu_header_offset` (relative to `__debug_info`), and returns its index.
+// Registering the same unit again gives it another index, which is just as good. Thread safe.
+std::uint32_t object_file_unit_register(std::size_t cu_header_offset);
+
+// The offset (relative to `__debug_info`) of the unit registered as `index`. Thread safe.
+std::size_t object_file_unit_offset(std::uint32_t index);
+
+/**************************************************************************************************/
+
+// Forgets the contents, aliases, and units (see `object_file_unit_register`) recorded so far, as
+// the dies they stand for are gone. See `orc_reset`.
+void object_file_forget_contents();
+
+// Forgets every object file registered so far, along with its rank, contents, and aliases, so the
+// next one registered is at index 0. Nothing can refer to the object files by index any longer
+// (e.g., a die or a report.) Not thread safe.
+void object_file_registry_clear();
+
+/**************************************************************************************************/
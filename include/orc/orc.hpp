@@ -8,6 +8,8 @@
 
 // stdc++
 #include <filesystem>
+#include <functional>
+#include <span>
 #include <unordered_map>
 #include <vector>
 #include <map>
@@ -20,31 +22,51 @@
 /**************************************************************************************************/
 
 struct odrv_report {
-    odrv_report(std::string_view symbol, const die* list_head);
+    // If `includes` is given, only the object files it includes are counted and listed as
+    // instances of a definition (e.g., those in one root's closure, for a dylib scan session.)
+    odrv_report(std::string_view symbol,
+                const die* list_head,
+                const std::function<bool(std::size_t ofd_index)>& includes = nullptr);
 
     std::size_t category_count() const { return _conflicting_attributes.size(); }
     std::string category(std::size_t n) const;
     std::string reporting_categories() const;
     std::string filtered_categories() const;
 
-    using symbol_instances = std::vector<object_ancestry>;
-    using symbol_declaration = location;
-    using symbol_location_map = std::unordered_map<symbol_declaration, symbol_instances>;
+    // Where one instance of a definition was declared, and the object file it was found in. The
+    // ancestry of the object file is only looked up when the report is output.
+    struct instance {
+        std::size_t _conflict_hash{0};
+        location _location;
+        std::size_t _ofd_index{0};
+    };
 
+    // One of the conflicting definitions, and thus one fatal attribute hash.
     struct conflict_details {
+        std::size_t _hash{0};
         dw::tag _tag{dw::tag::none};
         attribute_sequence _attributes;
-        symbol_location_map _locations;
-        std::size_t _count{0}; // may be different than _locations.size()
+        std::size_t _count{0}; // may be different than the number of instances
+        std::size_t _first{0}; // the instances of this definition (see `instances`)
+        std::size_t _last{0};
     };
 
-    const auto& conflict_map() const { return _conflict_map; }
+    // Sorted by fatal attribute hash.
+    const auto& conflicts() const { return _conflicts; }
+
+    // The instances of `conflict` that have a location, sorted by location. Instances with the
+    // same location are in the order of the die list, so the first is also first by ancestry.
+    std::span<const instance> instances(const conflict_details& conflict) const {
+        return std::span<const instance>(_instances).subspan(conflict._first,
+                                                             conflict._last - conflict._first);
+    }
 
     std::string_view _symbol;
 
 private:
     const die* _list_head{nullptr};
-    mutable std::map<std::size_t, conflict_details> _conflict_map;
+    std::vector<conflict_details> _conflicts;
+    std::vector<instance> _instances; // sorted by conflict hash, then location
     std::vector<dw::at> _conflicting_attributes;
 };
 
@@ -55,13 +77,37 @@ bool emit_report(const odrv_report& report);
 
 /**************************************************************************************************/
 
+// Returns the reports to be emitted (see `emit_report`), sorted by symbol, and no more than
+// `max_violation_count` of them.
 std::vector<odrv_report> orc_process(std::vector<std::filesystem::path>&&);
 
+// Registers the dies of the inputs as `orc_process` does, but instead of reviewing them, writes
+// them to a die index at `index_path` (see `die_index.hpp`.)
+void orc_emit_index(std::vector<std::filesystem::path>&& file_list,
+                    const std::filesystem::path& index_path);
+
+// Registers the dies in the die indices, then reviews and reports on them as `orc_process` does.
+std::vector<odrv_report> orc_merge(const std::vector<std::filesystem::path>& index_paths);
+
+// Sorts the list of dies (all of one symbol) by object file ancestry, and records the list for
+// reporting if their definitions conflict. Returns the new head of the list. This is the review
+// `orc_process` does of every list in the die map whose dies do not all have the same fatal
+// attribute hash, exposed for `orc_bench`.
+die* enforce_odrv_for_die_list(die* base);
+
 namespace orc {
 
-void register_dies(dies die_vector);
+// Moves the die into storage that is stable for the lifetime of the application, and enters it
+// into the global die map for ODRV review. The die must not be skippable. Thread safe.
+void register_die(die&& d);
 
-std::string to_json(const std::vector<odrv_report>&);
+// Calls `f` with every registered die. Nothing else can be registering dies at the time.
+void for_each_registered_die(const std::function<void(const die&)>& f);
+
+// Writes the reports, which must be sorted by symbol, as one JSON object. Each report is written as
+// it is formatted, rather than building the whole document first. A symbol with several reports
+// (from a dylib scan by session) has them all, as an array, under its one key.
+void to_json(std::ostream& out, const std::vector<odrv_report>& reports);
 
 std::string version_json();
 
@@ -69,7 +115,11 @@ std::string version_json();
 
 void orc_reset();
 
-// The returned char* is good until the next call to demangle() on the same thread.
+// Returns the demangled name, or the name itself if it isn't a mangled one. Each name is only
+// demangled once; after that the result is looked up. Thread safe.
+pool_string demangle(pool_string mangled);
+
+// As above. The returned char* is good for the life of the application.
 const char* demangle(const char* x);
 
 /**************************************************************************************************/
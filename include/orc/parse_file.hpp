@@ -28,6 +28,10 @@ struct freader {
 
     explicit freader(const std::filesystem::path& p);
 
+    // `on_unmap` is called when the file is unmapped, which is once this reader and every copy of
+    // it are gone. It is called even if the file could not be mapped.
+    freader(const std::filesystem::path& p, std::function<void()> on_unmap);
+
     // `<=` here because sometimes we jump to one past the end of the buffer right before stopping.
     explicit operator bool() const { return static_cast<bool>(_buffer) && _p <= _l; }
 
@@ -36,6 +40,12 @@ struct freader {
         return _l - _f;
     }
 
+    // The start of the mapped file.
+    const char* data() const {
+        assert(*this);
+        return _f;
+    }
+
     std::size_t tellg() const {
         assert(*this);
         return _p - _f;
@@ -88,6 +98,19 @@ struct freader {
         return std::string_view(f, n);
     }
 
+    // Hints to the kernel about how the `size` bytes at `offset` in the file are going to be read,
+    // so it can read ahead of us, or not, or let go of pages we're done with. They are only hints;
+    // if one can't be taken, nothing changes.
+    enum class advice {
+        normal,
+        sequential, // read front to back, soon
+        random, // a few places here and there
+        willneed, // start reading now
+        dontneed, // done with it
+    };
+
+    void advise(advice a, std::size_t offset, std::size_t size) const;
+
 private:
     std::shared_ptr<char> _buffer;
     char* _f{0};
@@ -206,8 +229,10 @@ inline bool read_pod(freader& s, bool) {
 
 /**************************************************************************************************/
 
-std::uint32_t uleb128(freader& s);
-std::int32_t sleb128(freader& s);
+// Both decode values of up to 64 bits. Those that fit in 8 bytes (which is nearly all of them) are
+// decoded without a loop.
+std::uint64_t uleb128(freader& s);
+std::int64_t sleb128(freader& s);
 
 /**************************************************************************************************/
 /*
@@ -239,6 +264,7 @@ struct macho_params {
     macho_reader_mode _mode{macho_reader_mode::invalid};
     std::filesystem::path _executable_path; // only required if mode == derive_dylibs
     register_dependencies_callback _register_dependencies; // only required if mode == derive_dylibs
+    std::string _ar_member; // if set, the only member of an archive to read (see `read_ar`)
 };
 
 void parse_file(std::string_view object_name,
@@ -0,0 +1,70 @@
+// Copyright 2026 Adobe
+// All Rights Reserved.
+//
+// NOTICE: Adobe permits you to use, modify, and distribute this file in accordance with the terms
+// of the Adobe license agreement accompanying it.
+
+#pragma once
+
+// stdc++
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**************************************************************************************************/
+
+namespace orc {
+
+/**************************************************************************************************/
+// Matches symbol paths against a set of patterns, all at once, in a single pass over the path. It
+// is an Aho-Corasick automaton, fed one piece of the path at a time: a path can be matched as it is
+// built up, one identifier after another, by keeping the `cursor` for each of its prefixes.
+//
+// There are three kinds of pattern:
+//     - substrings, that reject any path that contains them
+//     - prefixes, that reject any path that starts with them
+//     - paths, that reject only the path that is exactly them
+// The first two reject every extension of a path they reject, which is what lets the caller skip
+// over everything beneath it.
+class path_filter {
+public:
+    struct cursor {
+        std::uint32_t _state{0};
+        bool _rejected{false}; // by a substring or prefix, so every extension is rejected, too.
+    };
+
+    path_filter(const std::vector<std::string>& substrings,
+                const std::vector<std::string>& prefixes,
+                const std::vector<std::string>& paths);
+
+    // The cursor for the empty path.
+    cursor begin() const { return _begin; }
+
+    // The cursor for the path `c` is for, with `text` appended to it.
+    cursor append(cursor c, std::string_view text) const;
+
+    // Whether the path `c` is for is rejected.
+    bool rejects(cursor c) const;
+
+private:
+    struct node {
+        std::vector<std::pair<char, std::uint32_t>> _next;
+        std::uint32_t _fail{0};
+        bool _rejects_extensions{false};
+        bool _rejects_path{false};
+    };
+
+    std::uint32_t insert(std::string_view pattern);
+    std::uint32_t child(std::uint32_t state, char c) const; // 0 (the root) if there isn't one
+    std::uint32_t step(std::uint32_t state, char c) const;
+
+    std::vector<node> _nodes;
+    cursor _begin;
+};
+
+/**************************************************************************************************/
+
+} // namespace orc
+
+/**************************************************************************************************/
@@ -0,0 +1,50 @@
+// Copyright 2026 Adobe
+// All Rights Reserved.
+//
+// NOTICE: Adobe permits you to use, modify, and distribute this file in accordance with the terms
+// of the Adobe license agreement accompanying it.
+
+#pragma once
+
+// stdc++
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+/**************************************************************************************************/
+/*
+    Progress reports are printed every `progress_interval` seconds during a scan, so a long one
+    is not silent until it is done. Each one samples the counts in `globals` (and a few others)
+    from a thread of its own, so the scan itself does nothing extra to make them. They are printed
+    to standard error, or written to `progress_file` as JSON, one report per line, for dashboards
+    to follow along with.
+
+    The estimate of the time remaining compares the bytes mapped so far with the size of the
+    inputs. It is a rough one: the inputs found by a dylib scan are not counted in their size, and
+    an input is mapped all at once, well before it has been processed.
+*/
+namespace orc {
+
+/**************************************************************************************************/
+
+class progress_reporter {
+public:
+    // Starts reporting on the scan of `inputs`, if `progress_interval` is set.
+    explicit progress_reporter(const std::vector<std::filesystem::path>& inputs);
+
+    // Stops reporting, after a last report.
+    ~progress_reporter();
+
+    progress_reporter(const progress_reporter&) = delete;
+    progress_reporter& operator=(const progress_reporter&) = delete;
+
+private:
+    struct implementation;
+    std::unique_ptr<implementation> _impl;
+};
+
+/**************************************************************************************************/
+
+} // namespace orc
+
+/**************************************************************************************************/
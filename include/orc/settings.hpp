@@ -35,17 +35,33 @@ struct settings {
 
     bool _graceful_exit{false};
     std::size_t _max_violation_count{0};
+    std::size_t _max_open_files{256};
+    std::size_t _hash_partitions{1};
     bool _forward_to_linker{true};
     log_level _log_level{log_level::silent};
     bool _standalone_mode{false};
     bool _dylib_scan_mode{false};
+    bool _debug_map_members{false};
+    bool _dylib_scan_sessions{false};
     bool _print_object_file_list{false};
     std::vector<std::string> _symbol_ignore;
+    std::vector<std::string> _architectures;
     std::vector<std::string> _violation_report;
     std::vector<std::string> _violation_ignore;
+    std::vector<std::string> _prebuilt_die_caches;
     bool _parallel_processing{true};
+    std::size_t _worker_count{0};
+    bool _pin_workers{false};
     bool _filter_redundant{true};
+    bool _skip_subtrees{true};
+    bool _accelerated_scan{false};
     std::string _relative_output_file;
+    std::string _die_cache_file;
+    std::string _daemon_socket;
+    std::size_t _daemon_cache_mb{4096};
+    std::string _stats_file;
+    std::size_t _progress_interval{0}; // seconds
+    std::string _progress_file;
     output_file_mode _output_file_mode{output_file_mode::text};
 };
 
@@ -60,6 +76,7 @@ struct globals {
     std::atomic_size_t _unique_symbol_count{0};
     std::atomic_size_t _die_processed_count{0};
     std::atomic_size_t _die_skipped_count{0};
+    std::atomic_bool _cancelled{false}; // e.g., the forwarded linker failed, so stop processing
     std::ofstream _fp;
 
 private:
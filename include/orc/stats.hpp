@@ -0,0 +1,138 @@
+// Copyright 2026 Adobe
+// All Rights Reserved.
+//
+// NOTICE: Adobe permits you to use, modify, and distribute this file in accordance with the terms
+// of the Adobe license agreement accompanying it.
+
+#pragma once
+
+// stdc++
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// application
+#include "orc/dwarf_constants.hpp"
+
+/**************************************************************************************************/
+/*
+    Stats are an optional JSON file (see the `stats_file` setting) of what a run cost: how long
+    each phase took, how much was mapped and processed, how well the string pool did, and which
+    object files took the longest. Unlike Tracy, they need nothing but the file to be written, so
+    they can be collected from every build and compared over time.
+
+    Everything here is thread safe, and costs next to nothing when stats are not enabled.
+*/
+namespace orc {
+
+/**************************************************************************************************/
+
+enum class stats_phase {
+    dylib_scan, // overlaps `register_dies`, as dylibs are registered as they are found
+    register_dies,
+    review,
+    reports,
+    output,
+    count_k,
+};
+
+bool stats_enabled();
+
+// A phase runs from the earliest `stats_phase_begin` to the latest `stats_phase_end` called on it,
+// so either may be called more than once, and from any thread.
+void stats_phase_begin(stats_phase phase);
+void stats_phase_end(stats_phase phase);
+
+// Times a phase for as long as it is in scope.
+class stats_phase_scope {
+public:
+    explicit stats_phase_scope(stats_phase phase) : _phase(phase) { stats_phase_begin(_phase); }
+    ~stats_phase_scope() { stats_phase_end(_phase); }
+
+    stats_phase_scope(const stats_phase_scope&) = delete;
+    stats_phase_scope& operator=(const stats_phase_scope&) = delete;
+
+private:
+    const stats_phase _phase;
+};
+
+// Unlike the rest of the stats, the bytes mapped are counted whether or not stats are enabled, as
+// the progress reports need them (see progress.hpp.)
+void stats_bytes_mapped(std::size_t size);
+std::size_t stats_bytes_mapped_total();
+
+// Records how long the object file took to process, for the list of the slowest ones.
+void stats_object_file(std::uint32_t ofd_index, std::chrono::steady_clock::duration duration);
+
+// Records the size of the die map, as it is at its largest (just before it is reviewed.)
+void stats_die_map(std::size_t symbol_count, std::size_t arena_bytes);
+
+// Forgets what has been recorded, as the daemon does between links. (The string pool is kept
+// between links, so its numbers are not reset.)
+void stats_reset();
+
+// Writes the stats file, if stats are enabled.
+void stats_write();
+
+/**************************************************************************************************/
+/*
+    The die counts are kept whether or not stats are enabled, as they only cost an increment of a
+    counter of the calling thread's own per die. They say which of the `skip_die` filters are doing
+    the work, and for which tags, which is what is needed to tune `symbol_ignore` and to decide
+    which filters are worth making cheaper. They are summed up in the synopsis (see `to_json` and
+    `epilogue`.) Object files found in the die cache are not read, so their dies are not counted.
+*/
+
+// Why `skip_die` passed over a die, in the order it checks for them.
+enum class skip_reason {
+    tag, // a tag ORC does not review (e.g., `variable`)
+    internal_subprogram, // a function not visible outside its compilation unit
+    path, // unnamed, or rejected by name (see `symbol_ignore`)
+    objc_class,
+    self_referential_type,
+    count_k,
+};
+
+const char* to_string(skip_reason reason);
+
+void stats_die_registered(dw::tag tag);
+void stats_die_skipped(dw::tag tag, skip_reason reason);
+
+// The number of dies in a list that was reviewed, all of one symbol.
+void stats_die_list(std::size_t length);
+
+// The number of dies processed in one object file.
+void stats_object_file_dies(std::size_t count);
+
+// A histogram with a bucket for each power of two. Bucket `i` counts the values at least `2^i`
+// (and less than `2^(i + 1)`), except bucket 0, which counts zero, too.
+using stats_histogram = std::array<std::size_t, 64>;
+
+struct stats_die_counts {
+    // Tags past the standard ones are counted together, as `tag_count_k - 1`.
+    static constexpr std::size_t tag_count_k = 0x100 + 1;
+
+    std::array<std::size_t, static_cast<std::size_t>(skip_reason::count_k)> _skipped_by_reason{0};
+    std::array<std::size_t, tag_count_k> _registered_by_tag{0};
+    std::array<std::size_t, tag_count_k> _skipped_by_tag{0};
+    stats_histogram _die_list_lengths{0};
+    stats_histogram _object_file_dies{0};
+};
+
+// Whether the counts of registered and skipped dies (all but the die list lengths) are kept. The
+// passes after the first read the same inputs again (see `hash_partitions`) so they are only
+// counted by the first.
+void stats_die_counting(bool enabled);
+
+// The sum of every thread's counts so far.
+stats_die_counts stats_die_counts_sum();
+
+// Forgets the die counts, along with the counts in `globals`.
+void stats_die_counts_reset();
+
+/**************************************************************************************************/
+
+} // namespace orc
+
+/**************************************************************************************************/
@@ -7,123 +7,323 @@
 #pragma once
 
 // stdc++
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
 #include <thread>
+#include <vector>
+
+// system
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#include <mach/thread_policy.h>
+#include <pthread.h>
+#endif
 
 // stlab
 #include <stlab/concurrency/task.hpp>
 
+// tbb
+#include <tbb/concurrent_queue.h>
+
+// application
+#include "orc/settings.hpp"
+
 namespace orc {
 
 using stlab::task;
 
-inline auto queue_size() {
-    return std::max(1u, std::thread::hardware_concurrency());
+/**************************************************************************************************/
+// The number of worker threads to start: the `worker_count` setting, or one per processor if it
+// is zero. Read once, when the task system is first used.
+inline unsigned worker_count() {
+    const unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+    const std::size_t requested = settings::instance()._worker_count;
+    return requested ? static_cast<unsigned>(requested) : hardware;
 }
 
-class notification_queue {
-    using lock_t = std::unique_lock<std::mutex>;
-
-    struct element_t {
-        unsigned _priority;
-        task<void()> _task;
-
-        template <class F>
-        element_t(F&& f, unsigned priority) : _priority{priority}, _task{std::forward<F>(f)} { }
+/**************************************************************************************************/
+// Binds the calling thread to processor `cpu` (modulo the processor count.) On Linux this is a
+// hard affinity. On macOS it is only a hint: each worker gets an affinity tag of its own, which
+// asks the scheduler to keep them apart (and is not supported at all on Apple silicon.) Failures
+// are ignored; the thread then runs wherever the scheduler puts it.
+inline void pin_this_thread(unsigned cpu) {
+    const unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+    cpu %= hardware;
+
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    (void)pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#elif defined(__APPLE__)
+    thread_affinity_policy_data_t policy{static_cast<integer_t>(cpu + 1)};
+    (void)thread_policy_set(pthread_mach_thread_np(pthread_self()), THREAD_AFFINITY_POLICY,
+                            reinterpret_cast<thread_policy_t>(&policy),
+                            THREAD_AFFINITY_POLICY_COUNT);
+#else
+    (void)cpu;
+#endif
+}
 
-        struct greater {
-            bool operator()(const element_t& a, const element_t& b) const {
-                return b._priority < a._priority;
-            }
-        };
+/**************************************************************************************************/
+// A lock-free, single-owner, multiple-thief deque of pointers. The owning thread pushes and pops
+// at the bottom (LIFO, which keeps recently spawned work hot in its cache) while any other thread
+// may steal from the top (FIFO, which takes the oldest and typically largest piece of work.)
+//
+// This is the Chase-Lev deque, with the memory orderings taken from "Correct and Efficient
+// Work-Stealing for Weak Memory Models" (Lê, Pop, Cohen, Zappa Nardelli; PPoPP 2013).
+template <class T>
+class chase_lev_deque {
+    static_assert(std::is_pointer_v<T>, "the deque only stores pointers");
+
+    struct ring {
+        explicit ring(std::int64_t capacity)
+            : _capacity{capacity}, _mask{capacity - 1}, _data{new std::atomic<T>[capacity]} {}
+
+        // The paper uses relaxed slot accesses, publishing them with fences. Acquire/release is
+        // just as cheap on the targets we care about, and keeps thread sanitizer quiet.
+        T get(std::int64_t i) const { return _data[i & _mask].load(std::memory_order_acquire); }
+        void put(std::int64_t i, T x) { _data[i & _mask].store(x, std::memory_order_release); }
+
+        std::int64_t _capacity{0};
+        std::int64_t _mask{0};
+        std::unique_ptr<std::atomic<T>[]> _data;
     };
 
-    std::vector<element_t> _q; // can't use priority queue because top() is const
-    bool _done{false};
-    std::mutex _mutex;
-    std::condition_variable _ready;
-
-    // This must be called under a lock with a non-empty _q
-    task<void()> pop_not_empty() {
-        auto result = std::move(_q.front()._task);
-        std::pop_heap(begin(_q), end(_q), element_t::greater());
-        _q.pop_back();
+    alignas(64) std::atomic<std::int64_t> _top{0};
+    alignas(64) std::atomic<std::int64_t> _bottom{0};
+    std::atomic<ring*> _ring{nullptr};
+    // Rings outgrown by the owner cannot be freed right away, because a thief may still be reading
+    // from one. They are kept here until the deque itself goes away. Only the owner touches this.
+    std::vector<std::unique_ptr<ring>> _rings;
+
+    ring* grow(ring* r, std::int64_t top, std::int64_t bottom) {
+        auto bigger = std::make_unique<ring>(r->_capacity * 2);
+        for (std::int64_t i = top; i != bottom; ++i) {
+            bigger->put(i, r->get(i));
+        }
+        ring* result = bigger.get();
+        _rings.push_back(std::move(bigger));
+        _ring.store(result, std::memory_order_release);
         return result;
     }
 
 public:
-    bool try_pop(task<void()>& x) {
-        lock_t lock{_mutex, std::try_to_lock};
-        if (!lock || _q.empty()) return false;
-        x = pop_not_empty();
-        return true;
-    }
+    enum class steal_result {
+        success,
+        empty,
+        abort, // lost a race with another thread; the deque may not be empty.
+    };
 
-    bool pop(task<void()>& x) {
-        lock_t lock{_mutex};
-        while (_q.empty() && !_done) _ready.wait(lock);
-        if (_q.empty()) return false;
-        x = pop_not_empty();
-        return true;
+    explicit chase_lev_deque(std::int64_t capacity = 1024) {
+        assert(capacity > 0 && (capacity & (capacity - 1)) == 0); // must be a power of two
+        _rings.push_back(std::make_unique<ring>(capacity));
+        _ring.store(_rings.back().get(), std::memory_order_relaxed);
     }
 
-    void done() {
-        {
-            lock_t lock{_mutex};
-            _done = true;
+    chase_lev_deque(const chase_lev_deque&) = delete;
+    chase_lev_deque& operator=(const chase_lev_deque&) = delete;
+
+    // Owner only.
+    void push(T x) {
+        const std::int64_t b = _bottom.load(std::memory_order_relaxed);
+        const std::int64_t t = _top.load(std::memory_order_acquire);
+        ring* r = _ring.load(std::memory_order_relaxed);
+        if (b - t > r->_capacity - 1) {
+            r = grow(r, t, b);
         }
-        _ready.notify_all();
+        r->put(b, x);
+        std::atomic_thread_fence(std::memory_order_release);
+        _bottom.store(b + 1, std::memory_order_relaxed);
     }
 
-    template <typename F>
-    bool try_push(F&& f, unsigned priority) {
-        {
-            lock_t lock{_mutex, std::try_to_lock};
-            if (!lock) return false;
-            _q.emplace_back(std::forward<F>(f), priority);
-            std::push_heap(begin(_q), end(_q), element_t::greater());
+    // Owner only.
+    bool pop(T& x) {
+        const std::int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+        ring* r = _ring.load(std::memory_order_relaxed);
+        _bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t t = _top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            // empty
+            _bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
         }
-        _ready.notify_one();
+
+        x = r->get(b);
+
+        if (t == b) {
+            // This is the last item, so we have to race the thieves for it.
+            const bool won = _top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                          std::memory_order_relaxed);
+            _bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+
         return true;
     }
 
-    template <typename F>
-    void push(F&& f, unsigned priority) {
-        {
-            lock_t lock{_mutex};
-            _q.emplace_back(std::forward<F>(f), priority);
-            std::push_heap(begin(_q), end(_q), element_t::greater());
+    // Any thread.
+    steal_result steal(T& x) {
+        std::int64_t t = _top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const std::int64_t b = _bottom.load(std::memory_order_acquire);
+
+        if (t >= b) return steal_result::empty;
+
+        ring* r = _ring.load(std::memory_order_acquire);
+        T result = r->get(t);
+
+        if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+            return steal_result::abort;
+        }
+
+        x = result;
+        return steal_result::success;
+    }
+
+    // Any thread. The number of items in the deque, which may be out of date by the time it is
+    // returned.
+    std::size_t size() const {
+        const std::int64_t t = _top.load(std::memory_order_relaxed);
+        const std::int64_t b = _bottom.load(std::memory_order_relaxed);
+        return b > t ? static_cast<std::size_t>(b - t) : 0;
+    }
+
+    // Any thread. Steals, retrying for as long as the deque is contended.
+    bool steal_retry(T& x) {
+        while (true) {
+            switch (steal(x)) {
+                case steal_result::success:
+                    return true;
+                case steal_result::empty:
+                    return false;
+                case steal_result::abort:
+                    break;
+            }
         }
-        _ready.notify_one();
     }
 };
 
 /**************************************************************************************************/
-
+// Each worker thread owns one work-stealing deque per priority. Tasks enqueued from inside a
+// worker (e.g., `read_macho` enqueued by `parse_file`) go to that worker's own deque, and so do
+// not contend with any other thread. Tasks enqueued from outside the pool (e.g., the main thread)
+// go to a shared, lock-free injection queue per priority. Idle workers steal from one another.
+//
+// Priority is preserved by searching all the queues at a given priority before moving on to the
+// next, lower priority.
+//
+// A worker steals from the workers after it first. When workers are pinned (see `pin_workers`),
+// worker `i` runs on processor `i`, so its first victims are the processors nearest to it, which
+// usually share its caches and its memory node.
 class priority_task_system {
-    using lock_t = std::unique_lock<std::mutex>;
+    static constexpr std::size_t priority_count_k = 3;
+    static constexpr unsigned no_worker_k = static_cast<unsigned>(-1);
+
+    using task_type = task<void()>;
+    using task_ptr = task_type*;
+
+    struct worker_queues {
+        chase_lev_deque<task_ptr> _q[priority_count_k];
+    };
+
+    struct worker_id {
+        const priority_task_system* _system{nullptr};
+        unsigned _index{no_worker_k};
+    };
+
+    static worker_id& this_worker() {
+        thread_local worker_id result;
+        return result;
+    }
 
-    const unsigned _count{queue_size()};
+    const unsigned _count{worker_count()};
 
     std::vector<std::thread> _threads;
-    std::vector<notification_queue> _q{_count};
-    std::atomic<unsigned> _index{0};
+    std::unique_ptr<worker_queues[]> _queues{new worker_queues[_count]};
+    tbb::concurrent_queue<task_ptr> _injector[priority_count_k];
+    // Workers with no work to do sleep on `_epoch`, which is bumped every time a task is
+    // enqueued. `_sleepers` lets the enqueuing thread skip the wakeup when everyone is busy.
+    std::atomic<std::uint32_t> _epoch{0};
+    std::atomic<unsigned> _sleepers{0};
     std::atomic_bool _done{false};
 
+    unsigned current_index() const {
+        const auto& id = this_worker();
+        return id._system == this ? id._index : no_worker_k;
+    }
+
+    // Finds the next task to run, on behalf of worker `i` (or `no_worker_k` for any thread outside
+    // the pool.) Returns `nullptr` if no work could be found.
+    task_ptr find_task(unsigned i) {
+        task_ptr result{nullptr};
+
+        for (std::size_t p = 0; p != priority_count_k; ++p) {
+            if (i != no_worker_k && _queues[i]._q[p].pop(result)) return result;
+            if (_injector[p].try_pop(result)) return result;
+            for (unsigned n = 0; n != _count; ++n) {
+                const unsigned victim = (i + n + 1) % _count;
+                if (victim == i) continue;
+                if (_queues[victim]._q[p].steal_retry(result)) return result;
+            }
+        }
+
+        return nullptr;
+    }
+
+    static void invoke(task_ptr f) {
+        std::unique_ptr<task_type> holder(f);
+        (*holder)();
+    }
+
+    void notify() {
+        _epoch.fetch_add(1);
+        if (_sleepers.load() != 0) {
+            _epoch.notify_one();
+        }
+    }
+
     void run(unsigned i) {
         #if STLAB_FEATURE(THREAD_NAME_POSIX)
         pthread_setname_np(pthread_self(), "adobe.orc.worker");
         #elif STLAB_FEATURE(THREAD_NAME_APPLE)
         pthread_setname_np("adobe.orc.worker");
         #endif
+
+        this_worker() = worker_id{this, i};
+
+        if (settings::instance()._pin_workers) pin_this_thread(i);
+
         while (true) {
-            task<void()> f;
+            if (task_ptr f = find_task(i)) {
+                invoke(f);
+                continue;
+            }
 
-            for (unsigned n = 0; n != _count; ++n) {
-                if (_q[(i + n) % _count].try_pop(f)) break;
+            // Announce we are about to sleep, then look one last time before doing so. Any task
+            // enqueued after the epoch is read will change it, and the wait will not block.
+            ++_sleepers;
+            const auto epoch = _epoch.load();
+            task_ptr f = find_task(i);
+            if (!f && !_done) {
+                _epoch.wait(epoch);
             }
-            if (!f && !_q[i].pop(f)) break;
+            --_sleepers;
 
-            f();
+            if (f) {
+                invoke(f);
+            } else if (_done) {
+                break;
+            }
         }
     }
 
@@ -136,34 +336,65 @@ public:
     }
 
     ~priority_task_system() {
-        for (auto& e : _q) e.done();
+        _done = true;
+        _epoch.fetch_add(1);
+        _epoch.notify_all();
         for (auto& e : _threads) e.join();
     }
 
-
-
     template <std::size_t P, typename F>
     void execute(F&& f) {
-        static_assert(P < 3, "More than 3 priorities are not known!");
-        auto i = _index++;
+        static_assert(P < priority_count_k, "More than 3 priorities are not known!");
 
-        for (unsigned n = 0; n != _count; ++n) {
-            if (_q[(i + n) % _count].try_push(std::forward<F>(f), P)) return;
+        auto* t = new task_type(std::forward<F>(f));
+
+        if (const unsigned i = current_index(); i != no_worker_k) {
+            _queues[i]._q[P].push(t);
+        } else {
+            _injector[P].push(t);
         }
 
-        _q[i % _count].push(std::forward<F>(f), P);
+        notify();
     }
 
-    bool steal() {
-        task<void()> f;
+    // For threads outside the pool that want to sleep until there may be something for them to
+    // do: read the `epoch`, check for work, and then `wait` on the epoch. The wait returns once a
+    // task has been enqueued or `wake` has been called since the epoch was read.
+    std::uint32_t epoch() const { return _epoch.load(); }
 
-        for (unsigned n = 0; n != _count; ++n) {
-            if (_q[n].try_pop(f)) break;
+    void wait(std::uint32_t epoch) {
+        ++_sleepers;
+        _epoch.wait(epoch);
+        --_sleepers;
+    }
+
+    void wake() {
+        _epoch.fetch_add(1);
+        if (_sleepers.load() != 0) {
+            _epoch.notify_all();
         }
-        if (!f) return false;
+    }
+
+    // The number of worker threads.
+    unsigned size() const { return _count; }
 
-        f();
+    // The number of tasks waiting to be run. Like `chase_lev_deque::size`, it is only a snapshot.
+    std::size_t pending() const {
+        std::size_t result{0};
+        for (std::size_t p = 0; p != priority_count_k; ++p) {
+            result += _injector[p].unsafe_size();
+            for (unsigned n = 0; n != _count; ++n) {
+                result += _queues[n]._q[p].size();
+            }
+        }
+        return result;
+    }
 
+    // Runs one pending task (if any) on the calling thread. Returns `true` if a task was run.
+    bool steal() {
+        task_ptr f = find_task(current_index());
+        if (!f) return false;
+        invoke(f);
         return true;
     }
 };
@@ -173,6 +404,9 @@ inline priority_task_system& pts() {
     return only_task_system;
 }
 
+// The number of tasks that can run at once, for sizing work to the task system.
+inline auto queue_size() { return pts().size(); }
+
 enum class executor_priority
 {
     high,
@@ -7,7 +7,11 @@
 // identity
 #include "orc/ar.hpp"
 
+// stdc++
+#include <cstdlib>
+
 // application
+#include "orc/async.hpp"
 #include "orc/str.hpp"
 #include "orc/tracy.hpp"
 
@@ -30,24 +34,31 @@ std::string read_string(freader& s, std::size_t n) {
 
 /**************************************************************************************************/
 
-void read_ar(object_ancestry&& ancestry,
-             freader& s,
-             std::istream::pos_type end_pos,
-             file_details details,
-             macho_params params) {
-    std::string magic = read_fixed_string<8>(s);
-    assert(magic == "!<arch>\n");
+namespace {
+
+/**************************************************************************************************/
+// The location of a single `.o` file within the archive. Offsets are absolute to the top of the
+// file (that is, they can be handed directly to `freader::seekg`.)
+struct ar_member {
+    std::string _name;
+    std::size_t _offset{0};
+    std::size_t _size{0};
+    std::uint64_t _modified_time{0}; // seconds since the epoch
+};
+
+/**************************************************************************************************/
+// This is the first of the two phases of archive reading. It walks the archive headers only, and
+// collects where each of the `.o` files lives. It does not read any of the member file contents.
+std::vector<ar_member> index_ar(freader& s, std::istream::pos_type end_pos) {
+    std::vector<ar_member> result;
 
-    // The .o files are stored serially within the ar file, so I am not sure how easily this can be
-    // parallelized (if at all)
     while (s.tellg() < end_pos) {
         std::string identifier = rstrip(read_fixed_string<16>(s));
-        std::string timestamp = rstrip(read_fixed_string<12>(s));
-        std::string owner_id = rstrip(read_fixed_string<6>(s));
-        std::string group_id = rstrip(read_fixed_string<6>(s));
-        std::string file_mode = rstrip(read_fixed_string<8>(s));
+        const std::uint64_t modified_time =
+            std::strtoull(rstrip(read_fixed_string<12>(s)).c_str(), nullptr, 10);
+        s.seekg(6 + 6 + 8, std::ios::cur); // owner_id, group_id, and file_mode
         std::size_t file_size = std::atoi(rstrip(read_fixed_string<10>(s)).c_str());
-        std::string end_token = read_fixed_string<2>(s);
+        s.seekg(2, std::ios::cur); // end_token
 
         // extended naming mode
         if (identifier.find("#1/") == 0) {
@@ -57,14 +68,77 @@ void read_ar(object_ancestry&& ancestry,
         }
 
         if (identifier.rfind(".o") == identifier.size() - 2) {
-            auto end_pos = s.tellg() + static_cast<std::streamoff>(file_size);
-            parse_file(identifier, ancestry, s, end_pos, params);
-            s.seekg(end_pos); // parse_file could leave the read head anywhere.
-        } else {
-            // skip to next file in the archive.
-            s.seekg(file_size, std::ios::cur);
+            result.push_back(
+                ar_member{std::move(identifier), s.tellg(), file_size, modified_time});
         }
+
+        // skip to next file in the archive.
+        s.seekg(file_size, std::ios::cur);
+    }
+
+    return result;
+}
+
+/**************************************************************************************************/
+
+} // namespace
+
+/**************************************************************************************************/
+
+void read_ar(object_ancestry&& ancestry,
+             freader& s,
+             std::istream::pos_type end_pos,
+             file_details details,
+             macho_params params) {
+    ZoneScoped;
+
+    std::string magic = read_fixed_string<8>(s);
+    assert(magic == "!<arch>\n");
+
+    // The .o files are stored serially within the ar file, but once we know where each of them
+    // is, they can be parsed independently of one another. All the tasks share the same mmapped
+    // buffer, which stays alive until the last `freader` copy referencing it goes away.
+    for (auto& member : index_ar(s, end_pos)) {
+        if (!params._ar_member.empty() && member._name != params._ar_member) continue;
+
+        orc::do_work([_member = std::move(member), _ancestry = ancestry, _s = s,
+                      _params = params]() mutable {
+            const auto member_end = static_cast<std::streamoff>(_member._offset + _member._size);
+            _s.seekg(_member._offset);
+            parse_file(_member._name, _ancestry, _s, member_end, std::move(_params));
+        });
     }
+
+    s.seekg(end_pos);
+}
+
+/**************************************************************************************************/
+
+std::optional<ar_member_path> parse_ar_member_path(const std::filesystem::path& path) {
+    const std::string filename = path.filename().string();
+    const auto open = filename.find('(');
+
+    if (open == std::string::npos || filename.back() != ')') return std::nullopt;
+
+    return ar_member_path{path.parent_path() / filename.substr(0, open),
+                          filename.substr(open + 1, filename.size() - open - 2)};
+}
+
+/**************************************************************************************************/
+
+std::unordered_map<std::string, std::uint64_t> ar_member_times(const std::filesystem::path& path) {
+    std::unordered_map<std::string, std::uint64_t> result;
+
+    if (!is_regular_file(path)) return result;
+
+    freader s(path);
+    if (s.size() < 8 || read_fixed_string<8>(s) != "!<arch>\n") return result;
+
+    for (auto& member : index_ar(s, s.size())) {
+        result.emplace(std::move(member._name), member._modified_time);
+    }
+
+    return result;
 }
 
 /**************************************************************************************************/
@@ -7,12 +7,7 @@
 // identity
 #include "orc/async.hpp"
 
-// stdc++
-#include <cassert>
-
 // application
-#include "orc/settings.hpp"
-#include "orc/task_system.hpp"
 #include "orc/tracy.hpp"
 
 /**************************************************************************************************/
@@ -21,124 +16,99 @@ namespace orc {
 
 /**************************************************************************************************/
 
-namespace {
+namespace detail {
 
 /**************************************************************************************************/
+// Work items may still be unwinding while the application tears down, so the counter is never
+// destroyed.
+work_counter& work() {
+    static work_counter& _work = *new work_counter();
+    return _work;
+}
 
-struct work_counter {
-    struct state {
-        void increment() {
-            {
-                std::lock_guard<std::mutex> lock(_m);
-                ++_n;
-            }
-            _c.notify_all();
-        }
-
-        void decrement() {
-            {
-                std::lock_guard<std::mutex> lock(_m);
-                --_n;
-            }
-            _c.notify_all();
-        }
-
-        void wait() {
-            std::unique_lock<std::mutex> lock(_m);
-            if (_n == 0) return;
-            _c.wait(lock, [&] { return _n == 0; });
-        }
-
-        std::mutex _m;
-        std::condition_variable _c;
-        std::size_t _n{0};
-    };
-
-    friend struct token;
-
-    work_counter() : _impl{std::make_shared<state>()} {}
-
-    struct token {
-        token(std::shared_ptr<state> w) : _w(std::move(w)) { _w->increment(); }
-        token(const token& t) : _w{t._w} { _w->increment(); }
-        token(token&& t) = default;
-        ~token() {
-            if (_w) _w->decrement();
-        }
-
-    private:
-        std::shared_ptr<state> _w;
-    };
-
-    auto working() { return token(_impl); }
-
-    void wait() { _impl->wait(); }
-
-private:
-    std::shared_ptr<state> _impl;
-
-    void increment() { _impl->increment(); }
-    void decrement() { _impl->decrement(); }
-};
+/**************************************************************************************************/
+// Threads in `block_on_work` sleep on the task system's epoch, which is bumped whenever a task is
+// enqueued. Bumping it here, too, is what wakes them when the last of the work is done.
+void work_target_reached() { pts().wake(); }
 
 /**************************************************************************************************/
 
-auto& work() {
-    static work_counter _work;
-    return _work;
+#if ORC_FEATURE(TRACY)
+void name_worker_thread() {
+    thread_local bool tracy_set_thread_name_k = [] {
+        TracyCSetThreadName(
+            orc::profiler::format_unique("worker %s", orc::profiler::unique_thread_name()));
+        return true;
+    }();
+    (void)tracy_set_thread_name_k;
 }
+#endif // ORC_FEATURE(TRACY)
 
 /**************************************************************************************************/
 
-} // namespace
+} // namespace detail
 
 /**************************************************************************************************/
 
-void do_work(std::function<void()> f) {
-    auto doit = [_f = std::move(f)]() {
-        // I changed my opinion on this: an unhandled background task exception should terminate
-        // the application. This mimics the behavior of an unhandled exception on the main
-        // thread. Now (like main thread exceptions) background task exceptions must be
-        // handled before they hit this point.
-        try {
-            _f();
-        } catch (const std::exception& error) {
-            const char* what = error.what();
-            (void)what; // so you can see it in the debugger.
-            assert(!"unhandled background task exception");
-            std::terminate();
-        } catch (...) {
-            assert(!"unknown unhandled background task exception");
-            std::terminate();
-        }
-    };
-
-    if (!settings::instance()._parallel_processing) {
-        doit();
-        return;
+namespace {
+
+/**************************************************************************************************/
+// Rather than sit idle while the pool finishes up, the calling thread pitches in and runs pending
+// tasks itself. This is also what keeps a wait issued from within a task from deadlocking: the
+// task will run the work it is waiting on if no other thread gets to it first.
+//
+// A task that is itself blocked here holds a token it cannot give back until it returns, so those
+// tasks are not counted against the ones that are nested in `block_on_work`.
+template <class F>
+void steal_until(F done) {
+    auto& w = detail::work();
+    const bool nested = detail::task_depth() != 0;
+
+    if (nested) {
+        w._blocked.fetch_add(1, std::memory_order_acq_rel);
+        // Other nested waiters may now be done.
+        detail::work_target_reached();
     }
 
-    static orc::task_system system;
+    while (!done()) {
+        const auto epoch = pts().epoch();
+        if (pts().steal()) continue;
+        if (done()) break;
+        pts().wait(epoch);
+    }
 
-    system([_work_token = work().working(), _doit = std::move(doit)] {
-#if ORC_FEATURE(TRACY)
-        thread_local bool tracy_set_thread_name_k = [] {
-            TracyCSetThreadName(
-                orc::profiler::format_unique("worker %s", orc::profiler::unique_thread_name()));
-            return true;
-        }();
-        (void)tracy_set_thread_name_k;
-#endif // ORC_FEATURE(TRACY)
-        _doit();
-    });
+    if (nested) w._blocked.fetch_sub(1, std::memory_order_acq_rel);
 }
 
 /**************************************************************************************************/
-// It would be groovy if this routine could do some of the work, too, while it is waiting for the
-// pool to finish up.
+
+} // namespace
+
+/**************************************************************************************************/
+
 void block_on_work() {
+    // Serially, every work item has already run by the time `do_work` returns.
+    if (!settings::instance()._parallel_processing) return;
+
     TracyMessageL("orc::block_on_work");
-    work().wait();
+
+    auto& w = detail::work();
+    const bool nested = detail::task_depth() != 0;
+
+    steal_until([&] {
+        const std::size_t n = w._n.load(std::memory_order_acquire);
+        return n == (nested ? w._blocked.load(std::memory_order_acquire) : 0);
+    });
+}
+
+/**************************************************************************************************/
+
+void work_group::block() {
+    if (!settings::instance()._parallel_processing) return;
+
+    TracyMessageL("orc::work_group::block");
+
+    steal_until([&] { return _n.load(std::memory_order_acquire) == 0; });
 }
 
 /**************************************************************************************************/
@@ -0,0 +1,336 @@
+// Copyright 2024 Adobe
+// All Rights Reserved.
+//
+// NOTICE: Adobe permits you to use, modify, and distribute this file in accordance with the terms
+// of the Adobe license agreement accompanying it.
+
+// identity
+#include "orc/daemon.hpp"
+
+// stdc++
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+// posix
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// application
+#include "orc/die_cache.hpp"
+#include "orc/orc.hpp"
+#include "orc/settings.hpp"
+#include "orc/tracy.hpp"
+
+/**************************************************************************************************/
+
+namespace orc {
+
+/**************************************************************************************************/
+
+namespace {
+
+/**************************************************************************************************/
+// The protocol is about as simple as it gets. All integers are in native byte order, as both ends
+// are on the same machine.
+//
+//     request:
+//         u32      string count
+//         string   client working directory
+//         string[] client command line arguments
+//     response:
+//         i32      exit code
+//         string   standard output
+//         string   standard error
+//         string   JSON report
+//
+// where a `string` is a u32 length followed by that many bytes.
+
+/**************************************************************************************************/
+
+class socket_fd {
+public:
+    explicit socket_fd(int fd) : _fd(fd) {}
+    socket_fd(const socket_fd&) = delete;
+    socket_fd& operator=(const socket_fd&) = delete;
+    ~socket_fd() {
+        if (_fd >= 0) ::close(_fd);
+    }
+
+    int get() const { return _fd; }
+
+private:
+    int _fd{-1};
+};
+
+/**************************************************************************************************/
+
+sockaddr_un socket_address(const std::filesystem::path& path) {
+    sockaddr_un result{};
+    result.sun_family = AF_UNIX;
+    const std::string name = path.string();
+    if (name.size() >= sizeof(result.sun_path)) {
+        throw std::runtime_error("daemon socket path is too long: " + name);
+    }
+    std::memcpy(result.sun_path, name.c_str(), name.size() + 1);
+    return result;
+}
+
+/**************************************************************************************************/
+
+void write_all(int fd, const void* data, std::size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size) {
+        const auto n = ::write(fd, p, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) throw std::runtime_error("daemon connection closed while writing");
+        p += n;
+        size -= n;
+    }
+}
+
+void read_all(int fd, void* data, std::size_t size) {
+    char* p = static_cast<char*>(data);
+    while (size) {
+        const auto n = ::read(fd, p, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) throw std::runtime_error("daemon connection closed while reading");
+        p += n;
+        size -= n;
+    }
+}
+
+template <class T>
+void write_pod(int fd, const T& x) {
+    write_all(fd, &x, sizeof(x));
+}
+
+template <class T>
+T read_pod(int fd) {
+    T result;
+    read_all(fd, &result, sizeof(result));
+    return result;
+}
+
+void write_string(int fd, std::string_view x) {
+    write_pod(fd, static_cast<std::uint32_t>(x.size()));
+    write_all(fd, x.data(), x.size());
+}
+
+std::string read_string(int fd) {
+    std::string result(read_pod<std::uint32_t>(fd), '\0');
+    read_all(fd, result.data(), result.size());
+    return result;
+}
+
+/**************************************************************************************************/
+// While a link is processed, everything written to the console goes back to the client instead.
+// Standard output and standard error are kept apart, so the client can keep them apart, too.
+class console_capture {
+public:
+    console_capture()
+        : _cout(std::cout.rdbuf(_out.rdbuf())), _cerr(std::cerr.rdbuf(_err.rdbuf())) {}
+    ~console_capture() {
+        std::cout.rdbuf(_cout);
+        std::cerr.rdbuf(_cerr);
+    }
+
+    std::string out() const { return _out.str(); }
+    std::string err() const { return _err.str(); }
+
+private:
+    std::ostringstream _out;
+    std::ostringstream _err;
+    std::streambuf* _cout{nullptr};
+    std::streambuf* _cerr{nullptr};
+};
+
+/**************************************************************************************************/
+// Whether the process on the other end of `fd` runs as the same user as this one. The socket is
+// only accessible to that user anyway; this makes sure of it.
+bool same_user_peer(int fd) {
+#if defined(__APPLE__)
+    uid_t uid{0};
+    gid_t gid{0};
+    if (::getpeereid(fd, &uid, &gid) != 0) return false;
+    return uid == ::geteuid();
+#elif defined(__linux__)
+    ucred credentials{};
+    socklen_t size = sizeof(credentials);
+    if (::getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &size) != 0) return false;
+    return credentials.uid == ::geteuid();
+#else
+    return true;
+#endif
+}
+
+/**************************************************************************************************/
+
+void serve_one(int fd, const daemon_handler& handler) {
+    ZoneScoped;
+
+    const auto count = read_pod<std::uint32_t>(fd);
+    if (count == 0) throw std::runtime_error("empty request");
+
+    const std::filesystem::path working_directory(read_string(fd));
+    std::vector<std::string> args;
+    for (std::uint32_t i = 1; i != count; ++i) {
+        args.push_back(read_string(fd));
+    }
+
+    std::filesystem::current_path(working_directory);
+
+    daemon_result result;
+    std::string output;
+    std::string errors;
+
+    {
+        console_capture capture;
+        result = handler(std::move(args));
+        output = capture.out();
+        errors = capture.err();
+    }
+
+    write_pod(fd, static_cast<std::int32_t>(result._exit_code));
+    write_string(fd, output);
+    write_string(fd, errors);
+    write_string(fd, result._json_report);
+}
+
+/**************************************************************************************************/
+
+} // namespace
+
+/**************************************************************************************************/
+
+void daemon_serve(const std::filesystem::path& socket_path, daemon_handler handler) {
+    // A client that goes away mid-response should not take the daemon down with it.
+    std::signal(SIGPIPE, SIG_IGN);
+
+    const sockaddr_un address = socket_address(socket_path);
+    socket_fd listener(::socket(AF_UNIX, SOCK_STREAM, 0));
+    if (listener.get() < 0) throw std::runtime_error("could not create the daemon socket");
+
+    // Remove the socket left behind by an earlier daemon, if any.
+    ::unlink(address.sun_path);
+
+    // Anyone who can connect can have the daemon read (and report on) any file it can, so the
+    // socket is created accessible to its owner alone. The umask covers the window between
+    // `bind` creating the socket and `chmod` settling its mode.
+    const mode_t mask = ::umask(0077);
+    const bool bound =
+        ::bind(listener.get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+    const int bind_error = errno;
+    ::umask(mask);
+
+    if (!bound || ::chmod(address.sun_path, 0600) != 0 ||
+        ::listen(listener.get(), SOMAXCONN) != 0) {
+        throw std::runtime_error("could not listen on " + socket_path.string() + " (" +
+                                 std::strerror(bound ? errno : bind_error) + ")");
+    }
+
+    // Keep the dies of every object file between links, whether or not there is a cache file.
+    die_cache_make_resident();
+
+    if (log_level_at_least(settings::log_level::info)) {
+        cout_safe([&](auto& s) {
+            s << "info: daemon listening on " << socket_path.string() << '\n';
+        });
+    }
+
+    while (true) {
+        const int fd = ::accept(listener.get(), nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(std::string("daemon could not accept a link (") +
+                                     std::strerror(errno) + ")");
+        }
+
+        socket_fd client(fd);
+
+        if (!same_user_peer(client.get())) {
+            if (log_level_at_least(settings::log_level::warning)) {
+                cerr_safe([&](auto& s) {
+                    s << "warning: daemon refused a link from another user\n";
+                });
+            }
+            continue;
+        }
+
+        try {
+            serve_one(client.get(), handler);
+        } catch (const std::exception& error) {
+            if (log_level_at_least(settings::log_level::warning)) {
+                cerr_safe([&](auto& s) {
+                    s << "warning: daemon dropped a link (" << error.what() << ")\n";
+                });
+            }
+        }
+    }
+}
+
+/**************************************************************************************************/
+
+std::optional<int> daemon_request(const std::filesystem::path& socket_path, int argc, char** argv) {
+    ZoneScoped;
+
+    const sockaddr_un address = socket_address(socket_path);
+    socket_fd server(::socket(AF_UNIX, SOCK_STREAM, 0));
+
+    const auto* address_p = reinterpret_cast<const sockaddr*>(&address);
+
+    if (server.get() < 0 || ::connect(server.get(), address_p, sizeof(address)) != 0) {
+        if (log_level_at_least(settings::log_level::verbose)) {
+            cout_safe([&](auto& s) {
+                s << "verbose: no daemon at " << socket_path.string() << "; processing locally\n";
+            });
+        }
+        return std::nullopt;
+    }
+
+    std::signal(SIGPIPE, SIG_IGN);
+
+    try {
+        write_pod(server.get(), static_cast<std::uint32_t>(argc + 1));
+        write_string(server.get(), std::filesystem::current_path().string());
+        for (int i = 0; i != argc; ++i) {
+            write_string(server.get(), argv[i]);
+        }
+
+        const auto result = read_pod<std::int32_t>(server.get());
+        const std::string output = read_string(server.get());
+        const std::string errors = read_string(server.get());
+        const std::string json_report = read_string(server.get());
+
+        // Mirrored to the output file (in text mode), as if the link were processed locally.
+        cout_safe([&](auto& s) { s << output; });
+        cerr_safe([&](auto& s) { s << errors; });
+
+        auto& output_file = globals::instance()._fp;
+        if (!json_report.empty() && output_file.is_open()) {
+            output_file << json_report;
+        }
+
+        return result;
+    } catch (const std::exception& error) {
+        // The daemon may have died while processing the link. The output it never sent can be
+        // produced again locally.
+        if (log_level_at_least(settings::log_level::warning)) {
+            cerr_safe([&](auto& s) {
+                s << "warning: " << error.what() << "; processing locally\n";
+            });
+        }
+        return std::nullopt;
+    }
+}
+
+/**************************************************************************************************/
+
+} // namespace orc
+
+/**************************************************************************************************/
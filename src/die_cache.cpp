@@ -0,0 +1,651 @@
+// Copyright 2024 Adobe
+// All Rights Reserved.
+//
+// NOTICE: Adobe permits you to use, modify, and distribute this file in accordance with the terms
+// of the Adobe license agreement accompanying it.
+
+// identity
+#include "orc/die_cache.hpp"
+
+// stdc++
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+// application
+#include "orc/hash.hpp"
+#include "orc/memory.hpp"
+#include "orc/object_file_registry.hpp"
+#include "orc/orc.hpp"
+#include "orc/settings.hpp"
+#include "orc/tracy.hpp"
+#include "orc/version.hpp"
+
+/**************************************************************************************************/
+
+namespace orc {
+
+/**************************************************************************************************/
+
+namespace {
+
+/**************************************************************************************************/
+// The cache file layout (all values are in native byte order):
+//
+//     header:
+//         char[8]  magic ("ORCDIEC\0")
+//         u32      format version
+//         u64      fingerprint (see `die_registration_fingerprint`)
+//     entries, until the end of the file:
+//         u64      object content hash
+//         u64      object size
+//         u64      payload size (in bytes)
+//         payload:
+//             u64          processed die count
+//             u64          skipped die count
+//             u32          registered die count
+//             u32          string table size (in bytes)
+//             die_record[] registered dies
+//             char[]       string table
+//
+// The string table holds each string the way the string pool lays them out in memory: a u32
+// size, a `size_t` hash, the characters, and a null terminator. A string is referred to by the
+// offset of its characters into the table, with 0 (which can never be such an offset) standing in
+// for the empty string. This lets a mapped cache file hand its strings to the pool as-is (see
+// `empool_adopt`), without copying them.
+
+constexpr char magic_k[8] = {'O', 'R', 'C', 'D', 'I', 'E', 'C', '\0'};
+constexpr std::uint32_t version_k = 3;
+constexpr std::size_t header_size_k =
+    sizeof(magic_k) + sizeof(std::uint32_t) + sizeof(std::uint64_t);
+constexpr std::size_t entry_header_size_k = 3 * sizeof(std::uint64_t);
+constexpr std::size_t payload_header_size_k = 2 * sizeof(std::uint64_t) + 2 * sizeof(std::uint32_t);
+constexpr std::size_t string_prefix_size_k = sizeof(std::uint32_t) + sizeof(std::size_t);
+
+// The offset of the die and its unit die are relative to the unit; the unit's own is relative to
+// __debug_info (see `object_file_unit_register`.)
+struct die_record {
+    std::uint64_t _hash{0};
+    std::uint64_t _fatal_attribute_hash{0};
+    std::uint64_t _cu_header_offset{0};
+    std::uint32_t _path{0};
+    std::uint32_t _location_file{0};
+    std::uint32_t _location_line{0};
+    std::uint32_t _offset{0};
+    std::uint32_t _cu_die_offset{0};
+    std::uint16_t _tag{0};
+    std::uint8_t _arch{0};
+    std::uint8_t _flags{0}; // bit 0: has_children, bit 1: has_location
+};
+
+static_assert(sizeof(die_record) == 48, "die_record is part of the cache file format.");
+static_assert(std::is_trivially_copyable_v<die_record>);
+
+/**************************************************************************************************/
+
+struct key_hash {
+    std::size_t operator()(const die_cache_key& x) const {
+        return orc::hash_combine(x._hash, x._size);
+    }
+};
+
+/**************************************************************************************************/
+
+class payload_writer {
+public:
+    template <class T>
+    void write(const T& x) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        _buffer.append(reinterpret_cast<const char*>(&x), sizeof(x));
+    }
+
+    void append(std::string_view x) { _buffer.append(x); }
+
+    std::string release() { return std::move(_buffer); }
+
+private:
+    std::string _buffer;
+};
+
+/**************************************************************************************************/
+
+class string_table_writer {
+public:
+    std::uint32_t reference(pool_string x) {
+        if (x.empty()) return 0;
+
+        const auto found = _references.find(x.view().data());
+        if (found != _references.end()) return found->second;
+
+        const std::uint32_t size = static_cast<std::uint32_t>(x.size());
+        const std::size_t hash = x.hash();
+        _table.append(reinterpret_cast<const char*>(&size), sizeof(size));
+        _table.append(reinterpret_cast<const char*>(&hash), sizeof(hash));
+        const auto result = static_cast<std::uint32_t>(_table.size());
+        _table.append(x.view());
+        _table.push_back('\0');
+
+        _references.emplace(x.view().data(), result);
+        return result;
+    }
+
+    const std::string& table() const { return _table; }
+
+private:
+    // pool_strings are unique, so their data pointers make for cheap keys.
+    std::unordered_map<const char*, std::uint32_t> _references;
+    std::string _table;
+};
+
+/**************************************************************************************************/
+
+struct cache_entry {
+    std::string_view _payload;
+    bool _prebuilt{false};
+    // Whether the payload lives in a mapped file, and so can lend its strings to the string pool.
+    bool _mapped{true};
+    // The last run (see `cache_state::_runs`) that used the entry, for a resident cache.
+    std::size_t _last_used{0};
+};
+
+using cache_index = std::unordered_map<die_cache_key, cache_entry, key_hash>;
+
+struct cache_state {
+    // The cache file and any prebuilt ones. They stay mapped for the life of the application, as
+    // the string pool adopts strings straight out of them.
+    std::vector<freader> _files;
+    // Where each entry's payload is in `_files`.
+    cache_index _index;
+    // The payloads of a resident cache that are not in any file (see `die_cache_make_resident`.)
+    std::unordered_map<die_cache_key, std::string, key_hash> _resident_payloads;
+    std::size_t _resident_size{0}; // the bytes in `_resident_payloads`
+    std::size_t _runs{0};
+    bool _resident{false};
+    bool _loaded{false};
+
+    // The entries to write out at the end of the run. Hits refer to their payload in `_files`.
+    std::mutex _m;
+    std::size_t _prebuilt_hits{0};
+    std::vector<std::pair<die_cache_key, std::string_view>> _hits;
+    std::vector<std::pair<die_cache_key, std::string>> _misses;
+};
+
+cache_state& state() {
+    static cache_state& result = *new cache_state();
+    return result;
+}
+
+/**************************************************************************************************/
+
+void warn(const std::string& message) {
+    if (!log_level_at_least(settings::log_level::warning)) return;
+    cout_safe([&](auto& s) { s << "warning: die cache: " << message << '\n'; });
+}
+
+/**************************************************************************************************/
+
+cache_index index_cache_file(freader& s, bool prebuilt) {
+    cache_index result;
+
+    if (s.size() < header_size_k) throw std::runtime_error("file is truncated");
+
+    char magic[sizeof(magic_k)];
+    s.read(magic, sizeof(magic));
+    if (std::memcmp(magic, magic_k, sizeof(magic_k)) != 0) {
+        throw std::runtime_error("not a die cache file");
+    }
+
+    if (read_pod<std::uint32_t>(s) != version_k ||
+        read_pod<std::uint64_t>(s) != die_registration_fingerprint()) {
+        // Not an error - the version or configuration changed since the cache was written.
+        if (log_level_at_least(settings::log_level::verbose)) {
+            cout_safe([&](auto& s) { s << "verbose: die cache: out of date; ignoring\n"; });
+        }
+        return result;
+    }
+
+    while (s.tellg() + entry_header_size_k <= s.size()) {
+        die_cache_key key;
+        key._hash = read_pod<std::uint64_t>(s);
+        key._size = read_pod<std::uint64_t>(s);
+        const auto payload_size = read_pod<std::uint64_t>(s);
+        const std::size_t position = s.tellg();
+
+        if (position + payload_size > s.size()) throw std::runtime_error("file is truncated");
+
+        const std::string_view payload(s.data() + position, payload_size);
+        result.emplace(key, cache_entry{payload, prebuilt});
+        s.seekg(payload_size, std::ios::cur);
+    }
+
+    return result;
+}
+
+/**************************************************************************************************/
+// Prebuilt caches come from elsewhere, so their entries are checked before anything is registered
+// from them. Any entry that does not check out is treated as a miss.
+bool valid_string_reference(std::string_view table, std::uint32_t reference) {
+    if (reference == 0) return true;
+    if (reference < string_prefix_size_k || reference >= table.size()) return false;
+    const auto size = orc::unaligned_read<std::uint32_t>(table.data() + reference -
+                                                         string_prefix_size_k);
+    return size != 0 && reference + size < table.size() && table[reference + size] == '\0';
+}
+
+bool valid_payload(std::string_view payload,
+                   std::uint32_t die_count,
+                   std::string_view records,
+                   std::string_view table) {
+    if (payload_header_size_k + records.size() + table.size() != payload.size()) return false;
+
+    for (std::uint32_t i = 0; i != die_count; ++i) {
+        const auto r = orc::unaligned_read<die_record>(records.data() + i * sizeof(die_record));
+        if (!valid_string_reference(table, r._path)) return false;
+        if (!valid_string_reference(table, r._location_file)) return false;
+    }
+
+    return true;
+}
+
+/**************************************************************************************************/
+
+pool_string adopt_string(std::string_view table, std::uint32_t reference, bool mapped) {
+    if (!reference) return pool_string();
+    const char* data = table.data() + reference;
+    if (mapped) return empool_adopt(data);
+    // The payload will be released once it is out of date, so the string has to be copied. Its
+    // hash is right there, though.
+    const auto size = orc::unaligned_read<std::uint32_t>(data - string_prefix_size_k);
+    const auto hash = orc::unaligned_read<std::size_t>(data - sizeof(std::size_t));
+    return empool(std::string_view(data, size), hash);
+}
+
+/**************************************************************************************************/
+// Keeps the entries of the last run for the next run in this process, along with those of earlier
+// runs: the daemon may be alternating between the links of several targets, and each should find
+// its unchanged objects still there. An object that changed has a new key, so its old entry goes
+// unused from then on. Entries from files stay where they are, and cost nothing to keep. The rest
+// move into `_resident_payloads`, and once those pass the `daemon_cache_mb` budget, the ones that
+// have gone unused the longest are dropped.
+void retain_entries() {
+    auto& cache = state();
+    const std::size_t run = ++cache._runs;
+
+    for (const auto& [key, payload] : cache._hits) {
+        cache._index.at(key)._last_used = run;
+    }
+
+    for (auto& [key, payload] : cache._misses) {
+        const auto found = cache._resident_payloads.try_emplace(key).first;
+        cache._resident_size -= found->second.size();
+        found->second = std::move(payload);
+        cache._resident_size += found->second.size();
+        cache._index.insert_or_assign(key, cache_entry{found->second, false, false, run});
+    }
+
+    cache._hits.clear();
+    cache._misses.clear();
+    cache._prebuilt_hits = 0;
+
+    const std::size_t budget = settings::instance()._daemon_cache_mb * 1024 * 1024;
+    if (cache._resident_size <= budget) return;
+
+    std::vector<std::pair<std::size_t, die_cache_key>> by_age; // last used, key
+    by_age.reserve(cache._resident_payloads.size());
+    for (const auto& [key, payload] : cache._resident_payloads) {
+        by_age.emplace_back(cache._index.at(key)._last_used, key);
+    }
+    std::sort(by_age.begin(), by_age.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    std::size_t evicted{0};
+    for (const auto& [last_used, key] : by_age) {
+        if (cache._resident_size <= budget) break;
+        const auto found = cache._resident_payloads.find(key);
+        cache._resident_size -= found->second.size();
+        cache._index.erase(key);
+        cache._resident_payloads.erase(found);
+        ++evicted;
+    }
+
+    if (log_level_at_least(settings::log_level::verbose)) {
+        cout_safe([&](auto& s) {
+            s << "verbose: die cache: dropped " << evicted << " object files over the "
+              << settings::instance()._daemon_cache_mb << "MB budget\n";
+        });
+    }
+}
+
+/**************************************************************************************************/
+
+void write_cache_file() {
+    ZoneScoped;
+
+    auto& cache = state();
+    const std::filesystem::path path(settings::instance()._die_cache_file);
+    // Write to a temporary file first, then move it into place, so an interrupted write (or
+    // another ORC process reading the file at the same time) never sees a partial cache.
+    std::filesystem::path temp_path(path);
+    temp_path += ".tmp";
+
+    // The same object may show up more than once in a run (e.g., in two archives.)
+    std::unordered_map<die_cache_key, bool, key_hash> written;
+
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            warn("could not write " + temp_path.string());
+            return;
+        }
+
+        auto write_entry = [&](const die_cache_key& key, std::string_view payload) {
+            const std::uint64_t payload_size = payload.size();
+            out.write(reinterpret_cast<const char*>(&key._hash), sizeof(key._hash));
+            out.write(reinterpret_cast<const char*>(&key._size), sizeof(key._size));
+            out.write(reinterpret_cast<const char*>(&payload_size), sizeof(payload_size));
+            out.write(payload.data(), payload.size());
+        };
+
+        const std::uint64_t print = die_registration_fingerprint();
+        out.write(magic_k, sizeof(magic_k));
+        out.write(reinterpret_cast<const char*>(&version_k), sizeof(version_k));
+        out.write(reinterpret_cast<const char*>(&print), sizeof(print));
+
+        for (const auto& [key, payload] : cache._hits) {
+            if (written.emplace(key, true).second) write_entry(key, payload);
+        }
+
+        for (const auto& [key, payload] : cache._misses) {
+            if (written.emplace(key, true).second) write_entry(key, payload);
+        }
+
+        if (!out) {
+            warn("could not write " + temp_path.string());
+            return;
+        }
+    }
+
+    // The old file is still mapped, but that is fine: the mapping outlives the rename.
+    std::error_code ec;
+    std::filesystem::rename(temp_path, path, ec);
+    if (ec) {
+        warn("could not replace " + path.string() + " (" + ec.message() + ")");
+        return;
+    }
+
+    if (log_level_at_least(settings::log_level::verbose)) {
+        cout_safe([&](auto& s) {
+            s << "verbose: die cache: " << cache._hits.size() << " hit(s), "
+              << cache._prebuilt_hits << " prebuilt hit(s), " << cache._misses.size()
+              << " miss(es); wrote " << written.size() << " object files to " << path.string()
+              << '\n';
+        });
+    }
+}
+
+/**************************************************************************************************/
+
+} // namespace
+
+/**************************************************************************************************/
+
+std::uint64_t die_registration_fingerprint() {
+    std::string details;
+    details += ORC_VERSION_STR();
+    details += '\0';
+    details += ORC_SHA_STR();
+    details += '\0';
+    details += std::to_string(sizeof(std::size_t));
+    details += '\0';
+    details += orc::string_hash_name(); // the hashes of stored strings are compared
+    details += '\0';
+    details += settings::instance()._skip_subtrees ? "skip_subtrees" : "";
+    details += '\0';
+    details += settings::instance()._accelerated_scan ? "accelerated_scan" : "";
+    for (const auto& symbol : settings::instance()._symbol_ignore) {
+        details += '\0';
+        details += symbol;
+    }
+    return orc::murmur3_64(details.data(), static_cast<int>(details.size()));
+}
+
+/**************************************************************************************************/
+
+bool die_cache_enabled() {
+    const auto& settings = settings::instance();
+    return state()._resident || !settings._die_cache_file.empty() ||
+           !settings._prebuilt_die_caches.empty();
+}
+
+/**************************************************************************************************/
+
+void die_cache_make_resident() { state()._resident = true; }
+
+/**************************************************************************************************/
+
+die_cache_key die_cache_key_for(const freader& s, std::size_t offset, std::size_t size) {
+    ZoneScoped;
+
+    // `murmur3` takes an `int` length, so large objects are hashed in pieces.
+    constexpr std::size_t piece_size_k = std::numeric_limits<int>::max() / 2;
+
+    die_cache_key result;
+    result._size = size;
+
+    const char* first = s.data() + offset;
+    const char* last = first + size;
+    while (first != last) {
+        const std::size_t n = std::min<std::size_t>(piece_size_k, last - first);
+        result._hash = orc::hash_combine(result._hash, orc::murmur3_64(first, static_cast<int>(n)));
+        first += n;
+    }
+
+    return result;
+}
+
+/**************************************************************************************************/
+
+void die_cache_load() {
+    if (!die_cache_enabled()) return;
+
+    ZoneScoped;
+
+    const auto& settings = settings::instance();
+    auto& cache = state();
+
+    // A resident cache only reads its files once; after that it already has everything in them
+    // that is still of use.
+    if (cache._resident && cache._loaded) return;
+    cache._loaded = true;
+
+    auto load = [&](const std::filesystem::path& path, bool prebuilt) {
+        std::error_code ec;
+        if (!std::filesystem::exists(path, ec) || std::filesystem::file_size(path, ec) == 0) {
+            if (prebuilt) warn("could not find " + path.string());
+            return;
+        }
+
+        try {
+            freader file(path);
+            if (!file) throw std::runtime_error("could not map the file");
+            cache_index index = index_cache_file(file, prebuilt);
+            const std::size_t count = index.size();
+            // Entries already in the index (that is, from a file loaded earlier) take precedence.
+            cache._index.merge(index);
+            cache._files.push_back(std::move(file));
+
+            if (log_level_at_least(settings::log_level::verbose)) {
+                cout_safe([&](auto& s) {
+                    s << "verbose: die cache: " << count << " object files in " << path.string()
+                      << '\n';
+                });
+            }
+        } catch (const std::exception& error) {
+            warn(std::string("could not read ") + path.string() + " (" + error.what() + ")");
+        }
+    };
+
+    // The cache file comes first, so its (more recent) entries win.
+    if (!settings._die_cache_file.empty()) load(settings._die_cache_file, false);
+
+    for (const auto& path : settings._prebuilt_die_caches) {
+        load(path, true);
+    }
+}
+
+/**************************************************************************************************/
+
+bool die_cache_register(const die_cache_key& key, std::uint32_t ofd_index) {
+    auto& cache = state();
+    const auto found = cache._index.find(key);
+    if (found == cache._index.end()) return false;
+
+    ZoneScoped;
+
+    const std::string_view payload = found->second._payload;
+    const char* p = payload.data();
+
+    if (payload.size() < payload_header_size_k) return false;
+
+    const auto processed_count = orc::unaligned_read<std::uint64_t>(p);
+    const auto skipped_count = orc::unaligned_read<std::uint64_t>(p + sizeof(std::uint64_t));
+    const auto die_count = orc::unaligned_read<std::uint32_t>(p + 2 * sizeof(std::uint64_t));
+    const auto table_size =
+        orc::unaligned_read<std::uint32_t>(p + 2 * sizeof(std::uint64_t) + sizeof(std::uint32_t));
+
+    const std::size_t records_size = std::size_t(die_count) * sizeof(die_record);
+    if (payload_header_size_k + records_size + table_size != payload.size()) return false;
+
+    const std::string_view records(p + payload_header_size_k, records_size);
+    const std::string_view table(records.data() + records_size, table_size);
+
+    if (found->second._prebuilt && !valid_payload(payload, die_count, records, table)) {
+        warn("ignoring a malformed prebuilt entry");
+        return false;
+    }
+
+    // The dies of a unit are together, so the unit only has to be registered once.
+    std::optional<std::pair<std::uint64_t, std::uint32_t>> unit; // header offset, index
+
+    for (std::uint32_t i = 0; i != die_count; ++i) {
+        const auto r = orc::unaligned_read<die_record>(records.data() + i * sizeof(die_record));
+
+        if (!unit || unit->first != r._cu_header_offset) {
+            unit.emplace(r._cu_header_offset, object_file_unit_register(r._cu_header_offset));
+        }
+
+        die d;
+        d._path = adopt_string(table, r._path, found->second._mapped);
+        d._hash = r._hash;
+        d._fatal_attribute_hash = r._fatal_attribute_hash;
+        d._offset = r._offset;
+        d._cu_index = unit->second;
+        d._cu_die_offset = r._cu_die_offset;
+        d._tag = static_cast<dw::tag>(r._tag);
+        d._arch = static_cast<arch>(r._arch);
+        d._has_children = r._flags & 0x01;
+        if (r._flags & 0x02) {
+            d.set_definition_location(
+                location{adopt_string(table, r._location_file, found->second._mapped),
+                         r._location_line});
+        }
+        d._ofd_index = ofd_index;
+
+        register_die(std::move(d));
+    }
+
+    globals::instance()._die_processed_count += processed_count;
+    globals::instance()._die_skipped_count += skipped_count;
+
+    std::lock_guard<std::mutex> lock(cache._m);
+    if (found->second._prebuilt) {
+        // No need to copy these into the cache file; the prebuilt file will be there next time.
+        ++cache._prebuilt_hits;
+    } else {
+        cache._hits.emplace_back(key, payload);
+    }
+
+    return true;
+}
+
+/**************************************************************************************************/
+
+void die_cache_store(const die_cache_key& key,
+                     const std::vector<die>& dies,
+                     std::size_t processed_count,
+                     std::size_t skipped_count) {
+    if (!state()._resident && settings::instance()._die_cache_file.empty()) return;
+
+    ZoneScoped;
+
+    string_table_writer strings;
+    std::vector<die_record> records;
+    records.reserve(dies.size());
+
+    for (const auto& d : dies) {
+        die_record r;
+        r._hash = d._hash;
+        r._fatal_attribute_hash = d._fatal_attribute_hash;
+        r._path = strings.reference(d._path);
+        if (d._has_location) {
+            r._location_file = strings.reference(d._location_file);
+            r._location_line = d._location_line;
+        }
+        r._offset = d._offset;
+        r._cu_header_offset = object_file_unit_offset(d._cu_index);
+        r._cu_die_offset = d._cu_die_offset;
+        r._tag = static_cast<std::uint16_t>(d._tag);
+        r._arch = static_cast<std::uint8_t>(d._arch);
+        r._flags = (d._has_children ? 0x01 : 0) | (d._has_location ? 0x02 : 0);
+        records.push_back(r);
+    }
+
+    payload_writer w;
+
+    w.write(static_cast<std::uint64_t>(processed_count));
+    w.write(static_cast<std::uint64_t>(skipped_count));
+    w.write(static_cast<std::uint32_t>(records.size()));
+    w.write(static_cast<std::uint32_t>(strings.table().size()));
+    w.append(std::string_view(reinterpret_cast<const char*>(records.data()),
+                              records.size() * sizeof(die_record)));
+    w.append(strings.table());
+
+    auto& cache = state();
+    std::lock_guard<std::mutex> lock(cache._m);
+    cache._misses.emplace_back(key, w.release());
+}
+
+/**************************************************************************************************/
+
+void die_cache_save() {
+    auto& cache = state();
+
+    if (!settings::instance()._die_cache_file.empty()) write_cache_file();
+
+    if (cache._resident) {
+        retain_entries();
+    } else {
+        die_cache_discard();
+    }
+}
+
+/**************************************************************************************************/
+
+void die_cache_discard() {
+    auto& cache = state();
+    cache._hits.clear();
+    cache._misses.clear();
+    cache._prebuilt_hits = 0;
+}
+
+/**************************************************************************************************/
+
+} // namespace orc
+
+/**************************************************************************************************/
@@ -0,0 +1,406 @@
+// Copyright 2026 Adobe
+// All Rights Reserved.
+//
+// NOTICE: Adobe permits you to use, modify, and distribute this file in accordance with the terms
+// of the Adobe license agreement accompanying it.
+
+// identity
+#include "orc/die_index.hpp"
+
+// stdc++
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// application
+#include "orc/die_cache.hpp"
+#include "orc/memory.hpp"
+#include "orc/object_file_registry.hpp"
+#include "orc/orc.hpp"
+#include "orc/parse_file.hpp"
+#include "orc/settings.hpp"
+#include "orc/tracy.hpp"
+
+/**************************************************************************************************/
+
+namespace orc {
+
+/**************************************************************************************************/
+
+namespace {
+
+/**************************************************************************************************/
+// The index file layout (all values are in native byte order):
+//
+//     header:
+//         char[8]  magic ("ORCDIEX\0")
+//         u32      format version
+//         u64      fingerprint (see `die_registration_fingerprint`)
+//         u64      object file count (as counted by the scan, for the synopsis)
+//         u64      processed die count
+//         u64      skipped die count
+//     object files:
+//         u32      count
+//         per object file:
+//             u32      the object file it is an alias of (its own index if it isn't an alias)
+//             u64      offset
+//             u8       format
+//             u8       arch
+//             u8       is 64 bit
+//             u8       needs byteswap
+//             u32      ancestor count
+//             u64[]    ancestors
+//     dies:
+//         u64          count
+//         die_record[] dies
+//     string table, until the end of the file
+//
+// Object files are referred to by their position in the index. Strings are referred to by their
+// offset into the string table, where each is a u32 size followed by its characters, with 0
+// standing in for the empty string. (Unlike the die cache, an index can be larger than 4GB, so the
+// references are 64 bits.)
+
+constexpr char magic_k[8] = {'O', 'R', 'C', 'D', 'I', 'E', 'X', '\0'};
+constexpr std::uint32_t version_k = 2;
+
+// The offset of the die and its unit die are relative to the unit; the unit's own is relative to
+// __debug_info (see `object_file_unit_register`.)
+struct die_record {
+    std::uint64_t _hash{0};
+    std::uint64_t _fatal_attribute_hash{0};
+    std::uint64_t _path{0};
+    std::uint64_t _location_file{0};
+    std::uint64_t _cu_header_offset{0};
+    std::uint32_t _location_line{0};
+    std::uint32_t _ofd_index{0};
+    std::uint32_t _offset{0};
+    std::uint32_t _cu_die_offset{0};
+    std::uint16_t _tag{0};
+    std::uint8_t _arch{0};
+    std::uint8_t _flags{0}; // bit 0: has_children, bit 1: has_location
+    std::uint32_t _reserved{0};
+};
+
+static_assert(sizeof(die_record) == 64, "die_record is part of the index file format.");
+static_assert(std::is_trivially_copyable_v<die_record>);
+
+/**************************************************************************************************/
+
+class string_table_writer {
+public:
+    std::uint64_t reference(pool_string x) {
+        if (x.empty()) return 0;
+
+        const auto found = _references.find(x.view().data());
+        if (found != _references.end()) return found->second;
+
+        const std::uint32_t size = static_cast<std::uint32_t>(x.size());
+        const auto result = static_cast<std::uint64_t>(_table.size() + sizeof(size));
+        _table.append(reinterpret_cast<const char*>(&size), sizeof(size));
+        _table.append(x.view());
+
+        _references.emplace(x.view().data(), result);
+        return result;
+    }
+
+    const std::string& table() const { return _table; }
+
+private:
+    // pool_strings are unique, so their data pointers make for cheap keys.
+    std::unordered_map<const char*, std::uint64_t> _references;
+    // Offset 0 is the size of the first string, so it is never a reference.
+    std::string _table;
+};
+
+/**************************************************************************************************/
+
+template <class T>
+void write_pod(std::ostream& out, const T& x) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    out.write(reinterpret_cast<const char*>(&x), sizeof(x));
+}
+
+/**************************************************************************************************/
+// Reads what it is told to out of an index, and throws if the index is too short for it.
+class index_reader {
+public:
+    explicit index_reader(const freader& s) : _s(s) {}
+
+    template <class T>
+    T read() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        return orc::unaligned_read<T>(take(sizeof(T)));
+    }
+
+    const char* take(std::size_t size) {
+        if (size > _s.size() - _position) throw std::runtime_error("die index is truncated");
+        const char* result = _s.data() + _position;
+        _position += size;
+        return result;
+    }
+
+    std::string_view rest() const {
+        return std::string_view(_s.data() + _position, _s.size() - _position);
+    }
+
+private:
+    const freader& _s;
+    std::size_t _position{0};
+};
+
+pool_string read_string(std::string_view table, std::uint64_t reference) {
+    if (!reference) return pool_string();
+
+    if (reference < sizeof(std::uint32_t) || reference > table.size()) {
+        throw std::runtime_error("die index has a bad string reference");
+    }
+
+    const auto size =
+        orc::unaligned_read<std::uint32_t>(table.data() + reference - sizeof(std::uint32_t));
+
+    if (size > table.size() - reference) {
+        throw std::runtime_error("die index has a bad string reference");
+    }
+
+    return empool(table.substr(reference, size));
+}
+
+/**************************************************************************************************/
+
+} // namespace
+
+/**************************************************************************************************/
+
+void die_index_write(const std::filesystem::path& path) {
+    ZoneScoped;
+
+    const std::size_t object_count = object_file_count();
+    string_table_writer strings;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("could not write die index " + path.string());
+
+    const auto& g = globals::instance();
+    out.write(magic_k, sizeof(magic_k));
+    write_pod(out, version_k);
+    write_pod(out, die_registration_fingerprint());
+    write_pod(out, static_cast<std::uint64_t>(g._object_file_count));
+    write_pod(out, static_cast<std::uint64_t>(g._die_processed_count));
+    write_pod(out, static_cast<std::uint64_t>(g._die_skipped_count));
+
+    std::vector<std::uint32_t> alias_of(object_count);
+    for (std::size_t i = 0; i != object_count; ++i) {
+        alias_of[i] = static_cast<std::uint32_t>(i);
+    }
+    for (std::size_t i = 0; i != object_count; ++i) {
+        for (const auto alias : object_file_aliases(i)) {
+            alias_of[alias] = static_cast<std::uint32_t>(i);
+        }
+    }
+
+    write_pod(out, static_cast<std::uint32_t>(object_count));
+
+    for (std::size_t i = 0; i != object_count; ++i) {
+        const auto& ofd = object_file_fetch(i);
+        write_pod(out, alias_of[i]);
+        write_pod(out, static_cast<std::uint64_t>(ofd._details._offset));
+        write_pod(out, static_cast<std::uint8_t>(ofd._details._format));
+        write_pod(out, static_cast<std::uint8_t>(ofd._details._arch));
+        write_pod(out, static_cast<std::uint8_t>(ofd._details._is_64_bit));
+        write_pod(out, static_cast<std::uint8_t>(ofd._details._needs_byteswap));
+        const auto names = ofd._ancestry.names();
+        write_pod(out, static_cast<std::uint32_t>(names.size()));
+
+        bool first = true;
+        for (const auto& ancestor : names) {
+            // The top-level file is reopened by the merge to fetch attributes, from wherever it
+            // is run.
+            const pool_string name =
+                first ? empool(std::filesystem::absolute(ancestor.allocate_path()).string())
+                      : ancestor;
+            write_pod(out, strings.reference(name));
+            first = false;
+        }
+    }
+
+    // The count is patched in once the dies have been written.
+    const auto count_position = out.tellp();
+    std::uint64_t die_count{0};
+    write_pod(out, die_count);
+
+    for_each_registered_die([&](const die& d) {
+        die_record r;
+        r._hash = d._hash;
+        r._fatal_attribute_hash = d._fatal_attribute_hash;
+        r._path = strings.reference(d._path);
+        if (d._has_location) {
+            r._location_file = strings.reference(d._location_file);
+            r._location_line = d._location_line;
+        }
+        r._ofd_index = d._ofd_index;
+        r._offset = d._offset;
+        r._cu_header_offset = object_file_unit_offset(d._cu_index);
+        r._cu_die_offset = d._cu_die_offset;
+        r._tag = static_cast<std::uint16_t>(d._tag);
+        r._arch = static_cast<std::uint8_t>(d._arch);
+        r._flags = (d._has_children ? 0x01 : 0) | (d._has_location ? 0x02 : 0);
+        write_pod(out, r);
+        ++die_count;
+    });
+
+    out.write(strings.table().data(), strings.table().size());
+
+    out.seekp(count_position);
+    write_pod(out, die_count);
+
+    if (!out) throw std::runtime_error("could not write die index " + path.string());
+
+    if (log_level_at_least(settings::log_level::info)) {
+        cout_safe([&](auto& s) {
+            s << "info: wrote " << die_count << " dies from " << object_count
+              << " object files to " << path.string() << '\n';
+        });
+    }
+}
+
+/**************************************************************************************************/
+
+void die_index_read(const std::filesystem::path& path) {
+    ZoneScoped;
+
+    freader s(path);
+    if (!s) throw std::runtime_error("could not read die index " + path.string());
+
+    index_reader r(s);
+
+    if (std::memcmp(r.take(sizeof(magic_k)), magic_k, sizeof(magic_k)) != 0) {
+        throw std::runtime_error(path.string() + " is not a die index");
+    }
+
+    // Dies registered under different filters would be merged into results no one scan gives.
+    if (r.read<std::uint32_t>() != version_k ||
+        r.read<std::uint64_t>() != die_registration_fingerprint()) {
+        throw std::runtime_error(path.string() +
+                                 " was written by a different build of ORC, or with different "
+                                 "symbol_ignore, skip_subtrees, or accelerated_scan settings");
+    }
+
+    const auto scanned_object_count = r.read<std::uint64_t>();
+    const auto processed_count = r.read<std::uint64_t>();
+    const auto skipped_count = r.read<std::uint64_t>();
+
+    struct object_file {
+        std::uint32_t _alias_of{0};
+        file_details _details;
+        std::vector<std::uint64_t> _ancestors;
+    };
+
+    // Each object file takes at least its fixed-width fields, so a count larger than what is left
+    // could only come from a truncated or corrupt index.
+    constexpr std::size_t min_object_file_size_k =
+        2 * sizeof(std::uint32_t) + sizeof(std::uint64_t) + 4 * sizeof(std::uint8_t);
+    const auto object_file_count = r.read<std::uint32_t>();
+    if (object_file_count > r.rest().size() / min_object_file_size_k) {
+        throw std::runtime_error("die index is truncated");
+    }
+
+    std::vector<object_file> object_files(object_file_count);
+
+    for (auto& ofd : object_files) {
+        ofd._alias_of = r.read<std::uint32_t>();
+        ofd._details._offset = r.read<std::uint64_t>();
+        ofd._details._format = static_cast<file_details::format>(r.read<std::uint8_t>());
+        ofd._details._arch = static_cast<arch>(r.read<std::uint8_t>());
+        ofd._details._is_64_bit = r.read<std::uint8_t>();
+        ofd._details._needs_byteswap = r.read<std::uint8_t>();
+        const auto ancestor_count = r.read<std::uint32_t>();
+        if (ancestor_count > r.rest().size() / sizeof(std::uint64_t)) {
+            throw std::runtime_error("die index is truncated");
+        }
+        ofd._ancestors.resize(ancestor_count);
+        for (auto& ancestor : ofd._ancestors) {
+            ancestor = r.read<std::uint64_t>();
+        }
+    }
+
+    const auto die_count = r.read<std::uint64_t>();
+    if (die_count > r.rest().size() / sizeof(die_record)) {
+        throw std::runtime_error("die index is truncated");
+    }
+    const char* records = r.take(die_count * sizeof(die_record));
+    const std::string_view table = r.rest();
+
+    // The object files are registered anew, so they get indices of their own.
+    std::vector<std::uint32_t> ofd_indices;
+    ofd_indices.reserve(object_files.size());
+
+    for (auto& ofd : object_files) {
+        object_ancestry ancestry;
+        for (const auto ancestor : ofd._ancestors) {
+            ancestry.emplace_back(read_string(table, ancestor));
+        }
+        ofd_indices.push_back(static_cast<std::uint32_t>(
+            object_file_register(std::move(ancestry), std::move(ofd._details))));
+    }
+
+    for (std::size_t i = 0; i != object_files.size(); ++i) {
+        const auto alias_of = object_files[i]._alias_of;
+        if (alias_of == i) continue;
+        if (alias_of >= object_files.size()) {
+            throw std::runtime_error("die index has a bad object file reference");
+        }
+        object_file_add_alias(ofd_indices[alias_of], ofd_indices[i]);
+    }
+
+    // Each unit is registered once, however many dies it has.
+    std::unordered_map<std::uint64_t, std::uint32_t> units; // header offset -> index
+
+    for (std::uint64_t i = 0; i != die_count; ++i) {
+        const auto record = orc::unaligned_read<die_record>(records + i * sizeof(die_record));
+
+        if (record._ofd_index >= ofd_indices.size()) {
+            throw std::runtime_error("die index has a bad object file reference");
+        }
+
+        die d;
+        d._path = read_string(table, record._path);
+        d._hash = record._hash;
+        d._fatal_attribute_hash = record._fatal_attribute_hash;
+        d._ofd_index = ofd_indices[record._ofd_index];
+        d._offset = record._offset;
+        auto [unit, inserted] = units.try_emplace(record._cu_header_offset);
+        if (inserted) unit->second = object_file_unit_register(record._cu_header_offset);
+        d._cu_index = unit->second;
+        d._cu_die_offset = record._cu_die_offset;
+        d._tag = static_cast<dw::tag>(record._tag);
+        d._arch = static_cast<arch>(record._arch);
+        d._has_children = record._flags & 0x01;
+        if (record._flags & 0x02) {
+            d.set_definition_location(
+                location{read_string(table, record._location_file), record._location_line});
+        }
+
+        register_die(std::move(d));
+    }
+
+    auto& g = globals::instance();
+    g._object_file_count += scanned_object_count;
+    g._die_processed_count += processed_count;
+    g._die_skipped_count += skipped_count;
+
+    if (log_level_at_least(settings::log_level::verbose)) {
+        cout_safe([&](auto& s) {
+            s << "verbose: read " << die_count << " dies from " << object_files.size()
+              << " object files in " << path.string() << '\n';
+        });
+    }
+}
+
+/**************************************************************************************************/
+
+} // namespace orc
+
+/**************************************************************************************************/
@@ -8,16 +8,25 @@
 #include "orc/dwarf.hpp"
 
 // stdc++
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <limits>
 #include <list>
+#include <memory>
+#include <optional>
 #include <unordered_map>
 #include <vector>
 
 // application
+#include "orc/async.hpp"
 #include "orc/dwarf_structs.hpp"
 #include "orc/features.hpp"
 #include "orc/object_file_registry.hpp"
 #include "orc/orc.hpp"
+#include "orc/path_filter.hpp"
 #include "orc/settings.hpp"
+#include "orc/stats.hpp"
 #include "orc/tracy.hpp"
 
 /**************************************************************************************************/
@@ -28,6 +37,14 @@
 
 namespace {
 
+/**************************************************************************************************/
+// `die` stores its offsets in 32 bits, relative to its compilation unit, to keep it within a cache
+// line. The length of a (32-bit DWARF) unit is itself 32 bits, so these always fit.
+std::uint32_t unit_relative(std::size_t x) {
+    assert(x <= std::numeric_limits<std::uint32_t>::max());
+    return static_cast<std::uint32_t>(x);
+}
+
 /**************************************************************************************************/
 
 std::uint32_t form_length(dw::form f, freader& s) {
@@ -148,6 +165,86 @@ std::uint32_t form_length(dw::form f, freader& s) {
     }
 }
 
+/**************************************************************************************************/
+// The forms `process_form` passes over without looking at (they fall to its `default` case), and
+// that are the same length wherever they appear. Returns 0 for every other form. The lengths match
+// `form_length`.
+std::uint32_t fixed_passover_length(dw::form f) {
+    switch (f) {
+        case dw::form::data16:
+            return 16;
+        case dw::form::ref_sig8:
+        case dw::form::ref_sup8:
+            return 8;
+        case dw::form::ref_sup4:
+        case dw::form::strp_sup:
+        case dw::form::line_strp:
+        case dw::form::strx3:
+        case dw::form::strx4:
+        case dw::form::addrx3:
+        case dw::form::addrx4:
+        case dw::form::gnu_ref_alt:
+        case dw::form::gnu_strp_alt:
+            return 4;
+        case dw::form::strx2:
+        case dw::form::addrx2:
+            return 2;
+        case dw::form::strx1:
+        case dw::form::addrx1:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/**************************************************************************************************/
+// The length of a form's value when it is the same in every die, or nothing if the value has to be
+// read to know. Unlike `form_length` (which the passover machinery depends on), these are the
+// lengths the DWARF spec gives.
+std::optional<std::uint32_t> fixed_form_length(dw::form f) {
+    switch (f) {
+        case dw::form::flag_present:
+        case dw::form::implicit_const:
+            return 0;
+        case dw::form::data1:
+        case dw::form::ref1:
+        case dw::form::flag:
+        case dw::form::strx1:
+        case dw::form::addrx1:
+            return 1;
+        case dw::form::data2:
+        case dw::form::ref2:
+        case dw::form::strx2:
+        case dw::form::addrx2:
+            return 2;
+        case dw::form::strx3:
+        case dw::form::addrx3:
+            return 3;
+        case dw::form::data4:
+        case dw::form::ref4:
+        case dw::form::strp:
+        case dw::form::sec_offset:
+        case dw::form::ref_sup4:
+        case dw::form::strp_sup:
+        case dw::form::line_strp:
+        case dw::form::strx4:
+        case dw::form::addrx4:
+        case dw::form::gnu_ref_alt:
+        case dw::form::gnu_strp_alt:
+            return 4;
+        case dw::form::addr: // as `process_form` assumes
+        case dw::form::data8:
+        case dw::form::ref8:
+        case dw::form::ref_sig8:
+        case dw::form::ref_sup8:
+            return 8;
+        case dw::form::data16:
+            return 16;
+        default:
+            return std::nullopt;
+    }
+}
+
 /**************************************************************************************************/
 
 struct section {
@@ -161,14 +258,33 @@ struct section {
 // An abbreviation (abbreviated 'abbrev' througout a lot of the DWARF spec) is a template of sorts.
 // Think of it like a cookie cutter that needs to get stamped on some dough to make an actual
 // cookie. Only in this case instead of a cookie, it'll make a DIE (DWARF Information Entry.)
+//
+// Each abbrev is compiled (once, when it is read) into a plan for decoding the dies stamped from
+// it. The plan is a series of steps, each either decoding one attribute, or passing over a run of
+// attributes ORC does not look at. When all the attributes in such a run are the same size in
+// every die, the read head skips the whole run at once.
 struct abbrev {
+    struct step {
+        std::uint32_t _first{0}; // index into `_attributes`
+        std::uint32_t _count{0}; // number of attributes in the step; > 1 only for passovers
+        std::uint32_t _skip{0}; // bytes the passover run takes up in the die
+        bool _passover{false};
+    };
+
+    static constexpr std::size_t variable_size_k = std::numeric_limits<std::size_t>::max();
+
     std::size_t _g{0};
     std::uint32_t _code{0};
     dw::tag _tag{0};
     bool _has_children{false};
     std::vector<attribute> _attributes;
+    std::vector<step> _plan;
+    std::size_t _fixed_size{0}; // bytes of every die's attributes, or `variable_size_k`
 
     void read(freader& s);
+
+private:
+    void compile();
 };
 
 void abbrev::read(freader& s) {
@@ -182,6 +298,34 @@ void abbrev::read(freader& s) {
         if (entry._name == dw::at::none) break;
         _attributes.push_back(std::move(entry));
     }
+    compile();
+}
+
+void abbrev::compile() {
+    for (std::uint32_t i = 0, count = static_cast<std::uint32_t>(_attributes.size()); i != count;
+         ++i) {
+        const auto& attribute = _attributes[i];
+        const std::uint32_t length = fixed_passover_length(attribute._form);
+
+        // Fatal attributes are decoded no matter their form, so `process_form` can complain if it
+        // does not know how to read them.
+        if (length == 0 || fatal_attribute(attribute._name)) {
+            _plan.push_back(step{i, 1, 0, false});
+        } else if (!_plan.empty() && _plan.back()._passover) {
+            ++_plan.back()._count;
+            _plan.back()._skip += length;
+        } else {
+            _plan.push_back(step{i, 1, length, true});
+        }
+
+        if (_fixed_size == variable_size_k) continue;
+
+        if (const auto fixed = fixed_form_length(attribute._form)) {
+            _fixed_size += *fixed;
+        } else {
+            _fixed_size = variable_size_k;
+        }
+    }
 }
 
 /**************************************************************************************************/
@@ -408,11 +552,164 @@ bool skip_tagged_die(const die& d) {
     return std::find(first, last, d._tag) != last;
 }
 
+/**************************************************************************************************/
+// Whether a die of this tag defines a type that could be registered (see `skip_subtree`.)
+bool defines_type(dw::tag tag) {
+    switch (tag) {
+        case dw::tag::class_type:
+        case dw::tag::structure_type:
+        case dw::tag::union_type:
+        case dw::tag::enumeration_type:
+        case dw::tag::typedef_:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**************************************************************************************************/
+// The paths `skip_die` rejects by name, matched as the path is being built (see
+// `path_identifier_set`) so a rejected one is never built in full, let alone empooled. The
+// `symbol_ignore` setting is settled by the time this is first needed.
+const orc::path_filter& skip_filter() {
+    static const orc::path_filter result = [] {
+        std::vector<std::string> ignored;
+        for (const auto& symbol : settings::instance()._symbol_ignore) {
+            ignored.push_back("::[u]::" + symbol);
+        }
+
+        return orc::path_filter(
+            {
+                // Symbols with __ in them are reserved, so are not user-defined.
+                "::__",
+                // lambdas are ephemeral and can't cause (hopefully) an ODRV
+                "lambda",
+            },
+            {
+                // There are some symbols that are owned by the compiler and/or OS vendor (read:
+                // Apple) that have been observed to conflict. We skip them for our purposes, as we
+                // have no control over them.
+                "::[u]::objc_object",
+            },
+            ignored);
+    }();
+
+    return result;
+}
+
 /**************************************************************************************************/
 
 enum class process_mode {
     complete,
     single,
+    identity, // like `complete`, but see `is_identity_attribute`
+};
+
+/**************************************************************************************************/
+// The attributes needed to name a die, and to decide whether it is skipped (see `skip_die` and
+// `skip_subtree`). While processing all the dies, these are the only ones decoded up front; the
+// rest wait until the die is known to be registered. Most dies are not, so most of the rest are
+// never decoded at all.
+bool is_identity_attribute(dw::at name) {
+    switch (name) {
+        case dw::at::name:
+        case dw::at::linkage_name:
+        case dw::at::type:
+        case dw::at::import_:
+        case dw::at::abstract_origin:
+        case dw::at::specification:
+        case dw::at::external:
+        case dw::at::apple_runtime_class:
+        case dw::at::sibling:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**************************************************************************************************/
+// The evaluation stack of `evaluate_exprloc`. Location expressions are short, so it is fixed in
+// size and never allocates.
+class expression_stack {
+public:
+    static constexpr std::size_t capacity_k = 64;
+
+    bool empty() const { return _size == 0; }
+    bool full() const { return _size == capacity_k; }
+    std::size_t size() const { return _size; }
+
+    std::int64_t back() const {
+        assert(!empty());
+        return _values[_size - 1];
+    }
+
+    void push_back(std::int64_t x) {
+        assert(!full());
+        _values[_size++] = x;
+    }
+
+    void pop_back() {
+        assert(!empty());
+        --_size;
+    }
+
+private:
+    std::array<std::int64_t, capacity_k> _values;
+    std::size_t _size{0};
+};
+
+/**************************************************************************************************/
+// Every string in `__debug_str`, by offset. Shared by every thread processing the same object file.
+struct debug_str_table {
+    std::vector<std::uint32_t> _offsets; // sorted
+    std::vector<pool_string> _strings; // parallel to `_offsets`
+};
+
+/**************************************************************************************************/
+// Memoizes `resolve_type`, mapping the offset of a type's die to its name. This is found on every
+// type attribute, so it is a flat, open-addressed table: one probe is usually one cache line, and
+// nothing is allocated per entry.
+class type_cache {
+    static constexpr std::size_t empty_k = std::numeric_limits<std::size_t>::max();
+
+    struct entry {
+        std::size_t _offset{empty_k};
+        pool_string _name;
+    };
+
+    std::vector<entry> _entries{std::vector<entry>(256)}; // size must be a power of two
+    std::size_t _size{0};
+
+    std::size_t slot_for(std::size_t offset) const {
+        // Fibonacci hashing spreads the (clustered) die offsets over the table.
+        const std::size_t mask = _entries.size() - 1;
+        std::size_t n = (offset * 0x9e3779b97f4a7c15ull) >> 32 & mask;
+        while (_entries[n]._offset != offset && _entries[n]._offset != empty_k) {
+            n = (n + 1) & mask;
+        }
+        return n;
+    }
+
+    void grow() {
+        std::vector<entry> old(_entries.size() * 2);
+        std::swap(old, _entries);
+        for (const auto& e : old) {
+            if (e._offset != empty_k) _entries[slot_for(e._offset)] = e;
+        }
+    }
+
+public:
+    const pool_string* find(std::size_t offset) const {
+        const auto& e = _entries[slot_for(offset)];
+        return e._offset == offset ? &e._name : nullptr;
+    }
+
+    void insert(std::size_t offset, pool_string name) {
+        if ((_size + 1) * 4 > _entries.size() * 3) grow();
+        auto& e = _entries[slot_for(offset)];
+        if (e._offset == empty_k) ++_size;
+        e = entry{offset, name};
+    }
 };
 
 /**************************************************************************************************/
@@ -432,11 +729,21 @@ struct dwarf::implementation {
     bool register_sections_done();
 
     void report_die_processing_failure(std::size_t die_absolute_offset, std::string&& error);
-    void process_all_dies();
+    die_counts process_all_dies(std::vector<die>* registered);
+    die_counts process_units(std::size_t first, std::size_t last, std::vector<die>* registered);
+    std::vector<std::size_t> unit_offsets();
+    std::unique_ptr<implementation> fork() const;
     void post_process_compilation_unit_die(const die& die, const attribute_sequence& attributes);
     void post_process_die_attributes(attribute_sequence& attributes);
 
     bool skip_die(die& d, const attribute_sequence& attributes);
+    void complete_die(std::size_t die_address, attribute_sequence& attributes);
+    bool skip_subtree(const die& d, const attribute_sequence& attributes);
+    bool skip_descendants(bool (*stop)(dw::tag) = nullptr);
+    bool descend_toward(std::size_t target, const attribute_sequence& attributes);
+    void read_accelerator_table(const section& table, std::vector<std::size_t>& offsets);
+    void read_accelerator_tables();
+    void skip_form(dw::form form);
 
     die_pair fetch_one_die(std::size_t die_offset,
                            std::size_t cu_header_offset,
@@ -449,19 +756,20 @@ struct dwarf::implementation {
     std::uint32_t read32();
     std::uint32_t read16();
     std::uint32_t read8();
-    std::uint32_t read_uleb();
-    std::int32_t read_sleb();
+    std::uint64_t read_uleb();
+    std::int64_t read_sleb();
 
     void read_abbreviations();
     void read_lines(std::size_t header_offset);
     const abbrev& find_abbreviation(std::uint32_t code) const;
 
+    void preload_debug_str();
     pool_string read_debug_str(std::size_t offset);
 
     void path_identifier_push();
     void path_identifier_set(pool_string name);
     void path_identifier_pop();
-    std::string qualified_symbol_name(const die& d, const attribute_sequence& attributes) const;
+    pool_string qualified_symbol_name(const die& d, const attribute_sequence& attributes) const;
 
     pool_string make_path_canonical(pool_string candidate);
     attribute process_attribute(const attribute& attr,
@@ -478,26 +786,43 @@ struct dwarf::implementation {
     attribute_sequence offset_to_attribute_sequence(std::size_t offset);
 
     pool_string resolve_type(attribute type);
+    pool_string resolve_type_name(attribute type,
+                                  const attribute_sequence& attributes,
+                                  dw::tag tag);
 
     die_pair abbreviation_to_die(std::size_t die_address, process_mode mode);
 
     freader _s;
     file_details _details;
     std::vector<abbrev> _abbreviations;
+    std::vector<std::uint32_t> _abbreviation_index; // code -> 1 + index in `_abbreviations`, or 0
     std::vector<pool_string> _path;
+    // `_path`, flattened to "::a::b::c" as it changes: `_qualified_lengths[i]` is the length of
+    // the flattened path up to and including `_path[i]`.
+    std::string _qualified_path;
+    std::vector<std::size_t> _qualified_lengths;
+    std::vector<orc::path_filter::cursor> _filter_cursors; // `skip_filter`, for each in `_path`
+    std::size_t _empty_identifiers{0}; // in `_path`
     std::vector<pool_string> _decl_files;
-    std::unordered_map<std::size_t, pool_string> _type_cache;
+    type_cache _type_cache;
     std::unordered_map<std::size_t, pool_string> _debug_str_cache;
+    std::shared_ptr<const debug_str_table> _debug_str_table; // see `preload_debug_str`
+    // Sorted absolute offsets of the dies listed in the accelerator tables, when scanning through
+    // them. See `read_accelerator_tables`.
+    std::shared_ptr<const std::vector<std::size_t>> _accelerated_offsets;
     pool_string _last_typedef_name; // for unnamed structs - see https://github.com/adobe/orc/issues/84
     cu_header _cu_header;
     std::size_t _cu_header_offset{0}; // offset of the compilation unit header. Relative to __debug_info.
     std::size_t _cu_die_offset{0}; // offset of the `compile_unit` die. Relative to start of `debug_info`
+    std::uint32_t _cu_index{0}; // of the unit being processed; see `object_file_unit_register`
     pool_string _cu_compilation_directory;
     std::uint32_t _ofd_index{0}; // index to the obj_registry in macho.cpp
     section _debug_abbrev;
     section _debug_info;
     section _debug_line;
     section _debug_str;
+    section _apple_names;
+    section _apple_types;
     bool _ready{false};
 };
 
@@ -516,9 +841,9 @@ std::uint32_t dwarf::implementation::read16() { return read<std::uint16_t>(); }
 
 std::uint32_t dwarf::implementation::read8() { return read<std::uint8_t>(); }
 
-std::uint32_t dwarf::implementation::read_uleb() { return uleb128(_s); }
+std::uint64_t dwarf::implementation::read_uleb() { return uleb128(_s); }
 
-std::int32_t dwarf::implementation::read_sleb() { return sleb128(_s); }
+std::int64_t dwarf::implementation::read_sleb() { return sleb128(_s); }
 
 /**************************************************************************************************/
 
@@ -537,6 +862,10 @@ void dwarf::implementation::register_section(const std::string& name,
         _debug_abbrev = section{offset, size};
     } else if (name == "__debug_line") {
         _debug_line = section{offset, size};
+    } else if (name == "__apple_names") {
+        _apple_names = section{offset, size};
+    } else if (name == "__apple_types") {
+        _apple_types = section{offset, size};
     }
 }
 
@@ -557,6 +886,16 @@ void dwarf::implementation::read_abbreviations() {
             _abbreviations.push_back(std::move(a));
         }
     });
+
+    // Abbreviation codes usually run densely from 1, so most can be found by indexing. Codes too
+    // sparse for that are left to the binary search in `find_abbreviation`.
+    const std::size_t index_limit = 4 * _abbreviations.size() + 64;
+    for (std::size_t i = 0; i != _abbreviations.size(); ++i) {
+        const std::uint32_t code = _abbreviations[i]._code;
+        if (code >= index_limit) continue;
+        if (code >= _abbreviation_index.size()) _abbreviation_index.resize(code + 1, 0);
+        _abbreviation_index[code] = static_cast<std::uint32_t>(i + 1);
+    }
 }
 
 /**************************************************************************************************/
@@ -590,6 +929,10 @@ void dwarf::implementation::read_lines(std::size_t header_offset) {
 /**************************************************************************************************/
 
 const abbrev& dwarf::implementation::find_abbreviation(std::uint32_t code) const {
+    if (code < _abbreviation_index.size()) {
+        if (const auto index = _abbreviation_index[code]) return _abbreviations[index - 1];
+    }
+
     auto found = std::lower_bound(_abbreviations.begin(), _abbreviations.end(), code,
                                   [](const auto& x, const auto& code) { return x._code < code; });
     if (found == _abbreviations.end() || found->_code != code) {
@@ -600,6 +943,117 @@ const abbrev& dwarf::implementation::find_abbreviation(std::uint32_t code) const
 
 /**************************************************************************************************/
 
+// When every die is processed, nearly every string in `__debug_str` ends up being read, so they
+// are all empooled up front in one pass over the section. The section is a run of NUL-terminated
+// strings; `memchr` finds the end of each many bytes at a time. Single die processing (see
+// `fetch_one_die`) only needs a handful of the strings, so it does not come through here, and
+// reads them lazily instead. Neither does an accelerated scan (see `read_accelerator_tables`.)
+void dwarf::implementation::preload_debug_str() {
+    ZoneScoped;
+
+    auto table = std::make_shared<debug_str_table>();
+    const char* first = _s.data() + _debug_str._offset;
+    const char* const last = first + _debug_str._size;
+    const char* p = first;
+
+    while (p < last) {
+        const char* end = static_cast<const char*>(std::memchr(p, 0, last - p));
+        if (!end) end = last;
+        table->_offsets.push_back(static_cast<std::uint32_t>(p - first));
+        table->_strings.push_back(empool(std::string_view(p, end - p)));
+        p = end + 1;
+    }
+
+    ZoneValue(table->_offsets.size());
+
+    _debug_str_table = std::move(table);
+}
+
+/**************************************************************************************************/
+// The Apple accelerator tables (`__apple_names` for functions and variables, `__apple_types` for
+// types) are hash tables from a name to the dies with it. Rather than look names up, this walks
+// every entry of the table and collects the die offsets. See
+// https://llvm.org/docs/SourceLevelDebugging.html#accelerator-tables
+void dwarf::implementation::read_accelerator_table(const section& table,
+                                                   std::vector<std::size_t>& offsets) {
+    constexpr std::uint32_t magic_k = 0x48415348; // 'HASH'
+    constexpr std::uint16_t atom_die_offset_k = 1;
+
+    _s.seekg(table._offset);
+
+    if (read32() != magic_k) return;
+
+    (void)read16(); // version
+    (void)read16(); // hash function
+    const std::uint32_t bucket_count = read32();
+    const std::uint32_t hash_count = read32();
+    const std::uint32_t header_data_length = read32();
+    const std::size_t header_data = _s.tellg();
+    const std::uint32_t die_offset_base = read32();
+    const std::uint32_t atom_count = read32();
+
+    std::vector<std::pair<std::uint16_t, dw::form>> atoms; // type, form
+    for (std::uint32_t i = 0; i != atom_count; ++i) {
+        const auto type = static_cast<std::uint16_t>(read16());
+        atoms.emplace_back(type, static_cast<dw::form>(read16()));
+    }
+
+    _s.seekg(header_data + header_data_length);
+    _s.seekg(sizeof(std::uint32_t) * (bucket_count + hash_count), std::ios::cur); // buckets, hashes
+    const std::size_t data_offsets = _s.tellg();
+
+    for (std::uint32_t i = 0; i != hash_count; ++i) {
+        _s.seekg(data_offsets + i * sizeof(std::uint32_t));
+        _s.seekg(table._offset + read32());
+
+        // Each hash has a list of the names with it, ended by a zero string offset.
+        while (read32() != 0) {
+            const std::uint32_t die_count = read32();
+
+            for (std::uint32_t j = 0; j != die_count; ++j) {
+                for (const auto& [type, form] : atoms) {
+                    if (type != atom_die_offset_k) {
+                        skip_form(form);
+                    } else if (form == dw::form::data4) {
+                        offsets.push_back(_debug_info._offset + die_offset_base + read32());
+                    } else {
+                        return; // Not a form any producer uses; leave the table be.
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**************************************************************************************************/
+// When the `accelerated_scan` setting is on and the file has accelerator tables (as dSYMs do),
+// only the dies listed in them (and the subtrees beneath them) are processed. The rest of the
+// dies are either skipped over, or (as ancestors of listed dies) read just far enough to keep the
+// path right.
+void dwarf::implementation::read_accelerator_tables() {
+    ZoneScoped;
+
+    if (!settings::instance()._accelerated_scan) return;
+    if (!_apple_names.valid() || !_apple_types.valid()) return;
+
+    auto offsets = std::make_shared<std::vector<std::size_t>>();
+
+    temp_seek(_s, 0, std::ios::cur, [&] {
+        read_accelerator_table(_apple_types, *offsets);
+        read_accelerator_table(_apple_names, *offsets);
+    });
+
+    std::sort(offsets->begin(), offsets->end());
+    offsets->erase(std::unique(offsets->begin(), offsets->end()), offsets->end());
+
+    ZoneValue(offsets->size());
+
+    if (!offsets->empty()) _accelerated_offsets = std::move(offsets);
+}
+
+/**************************************************************************************************/
+
+
 #define ORC_PRIVATE_FEATURE_DEBUG_STR_CACHE() (ORC_PRIVATE_FEATURE_TRACY() && 0)
 
 pool_string dwarf::implementation::read_debug_str(std::size_t offset) {
@@ -623,10 +1077,16 @@ pool_string dwarf::implementation::read_debug_str(std::size_t offset) {
     const auto update_zone = [&] { tracy::Profiler::PlotData(plot_name_k, hit_s / total_s * 100); };
 #endif // ORC_FEATURE(DEBUG_STR_CACHE)
 
-    // I tried an implementation that loaded the whole debug_str section into the string pool on
-    // the first debug string read. The big problem with that technique is that the single die
-    // processing mode becomes very expensive, as it only needs a handful of debug strings but
-    // ends up loading all of them. Perhaps we could pivot the technique based on the process mode?
+    if (_debug_str_table) {
+        const auto& offsets = _debug_str_table->_offsets;
+        const auto found = std::lower_bound(offsets.begin(), offsets.end(), offset);
+        if (found != offsets.end() && *found == offset) {
+            return _debug_str_table->_strings[found - offsets.begin()];
+        }
+        // The offset lands in the middle of a string (linkers may share one string's tail with
+        // another.) That string's suffix is read the lazy way.
+    }
+
     if (const auto found = _debug_str_cache.find(offset); found != _debug_str_cache.end()) {
 #if ORC_FEATURE(DEBUG_STR_CACHE)
         ++hit_s;
@@ -646,22 +1106,48 @@ pool_string dwarf::implementation::read_debug_str(std::size_t offset) {
 
 /**************************************************************************************************/
 
-void dwarf::implementation::path_identifier_push() { _path.push_back(pool_string()); }
+void dwarf::implementation::path_identifier_push() {
+    _path.push_back(pool_string());
+    _qualified_lengths.push_back(_qualified_path.size());
+    _filter_cursors.push_back(_filter_cursors.empty() ? skip_filter().begin()
+                                                      : _filter_cursors.back());
+    ++_empty_identifiers;
+}
 
 /**************************************************************************************************/
 
 void dwarf::implementation::path_identifier_set(pool_string name) {
     assert(!_path.empty());
+
+    _empty_identifiers -= _path.back().empty();
+    _empty_identifiers += name.empty();
     _path.back() = name;
+
+    // Only the last identifier changed, so everything before it can stay.
+    _qualified_path.resize(_qualified_lengths.size() > 1 ? _qualified_lengths.end()[-2] : 0);
+    auto cursor = _filter_cursors.size() > 1 ? _filter_cursors.end()[-2] : skip_filter().begin();
+    if (!name.empty()) {
+        _qualified_path += "::";
+        _qualified_path += name.view();
+        cursor = skip_filter().append(skip_filter().append(cursor, "::"), name.view());
+    }
+    _qualified_lengths.back() = _qualified_path.size();
+    _filter_cursors.back() = cursor;
 }
 
 /**************************************************************************************************/
 
-void dwarf::implementation::path_identifier_pop() { _path.pop_back(); }
+void dwarf::implementation::path_identifier_pop() {
+    _empty_identifiers -= _path.back().empty();
+    _path.pop_back();
+    _qualified_lengths.pop_back();
+    _qualified_path.resize(_qualified_lengths.empty() ? 0 : _qualified_lengths.back());
+    _filter_cursors.pop_back();
+}
 
 /**************************************************************************************************/
 
-std::string dwarf::implementation::qualified_symbol_name(
+pool_string dwarf::implementation::qualified_symbol_name(
     const die& d, const attribute_sequence& attributes) const {
 #if ORC_FEATURE(PROFILE_DIE_DETAILS)
     ZoneScoped;
@@ -680,25 +1166,27 @@ std::string dwarf::implementation::qualified_symbol_name(
 
     for (const auto& at : qualified_attributes) {
         if (attributes.has_string(at)) {
-            return "::[u]::" + attributes.string(at).allocate_string();
+            constexpr std::string_view prefix_k("::[u]::");
+            const auto name = attributes.string(at).view();
+            thread_local std::string result;
+            result.assign(prefix_k);
+            result += name;
+            if (skip_filter().rejects(skip_filter().append(skip_filter().begin(), result))) {
+                return pool_string();
+            }
+            return empool(result);
         }
     }
 
-    // preprocess the path. If any identifier in the path is the empty string,
-    // then it's talking about an anonymous/unnamed symbol, which at this time
-    // we do not register. In such a case, if we find one, return an empty string
-    // for the whole path so we can skip over this die at registration time.
-    for (const auto& identifier : _path) {
-        if (identifier.empty()) {
-            return std::string();
-        }
-    }
+    // If any identifier in the path is the empty string, then it's talking about an
+    // anonymous/unnamed symbol, which at this time we do not register. In such a case, return an
+    // empty string for the whole path so we can skip over this die at registration time. The same
+    // goes for paths `skip_filter` rejects, which are never empooled.
+    if (_empty_identifiers || skip_filter().rejects(_filter_cursors.back())) return pool_string();
 
-    std::string result;
-    for (const auto& identifier : _path) {
-        result += "::" + identifier.allocate_string();
-    }
-    return result;
+    // The path is kept flattened as it changes (see `path_identifier_set`), so there's nothing left
+    // to build.
+    return empool(_qualified_path);
 }
 
 /**************************************************************************************************/
@@ -880,7 +1368,7 @@ pool_string dwarf::implementation::die_identifier(const die& d,
 /**************************************************************************************************/
 
 attribute_value dwarf::implementation::evaluate_exprloc(std::uint32_t expression_size) {
-    std::vector<std::int64_t> stack;
+    expression_stack stack;
     const auto end = _s.tellg() + expression_size;
 
     // There are some exprlocs that cannot be deciphered, probably because we don't have as much
@@ -899,7 +1387,14 @@ attribute_value dwarf::implementation::evaluate_exprloc(std::uint32_t expression
         return result;
     };
 
-    auto stack_push = [&_stack = stack](auto value) { _stack.push_back(value); };
+    // An expression deep enough to fill the stack is passed over, like any other we can't evaluate.
+    auto stack_push = [&_stack = stack, &passover](auto value) {
+        if (_stack.full()) {
+            passover = true;
+        } else {
+            _stack.push_back(value);
+        }
+    };
 
     // REVISIT (fosterbrereton) : The DWARF specification describes a multi-register stack machine
     // whose registers imitate (or are?!) the registers present on architecture for which this code
@@ -1374,49 +1869,104 @@ pool_string dwarf::implementation::resolve_type(attribute type) {
     ZoneScoped;
 #endif // ORC_FEATURE(PROFILE_DIE_DETAILS)
 
-    std::size_t reference = type.reference();
-    auto found = _type_cache.find(reference);
-    if (found != _type_cache.end()) {
-        // std::cout << "memoized " << hex_print(reference) << ": " << found->second << '\n';
-        return found->second;
+    const std::size_t reference = type.reference();
+    if (const auto found = _type_cache.find(reference)) return *found;
+
+    // `const` types put "const " in front of the name of the type they modify, and pointer types
+    // put "*" after it. So however a run of them is nested, the result is some number of "const "
+    // prefixes, then the name of the type at the bottom of the run, then some number of "*"
+    // suffixes. Counting them on the way down means the name is built (and empooled) once, rather
+    // than once per level.
+    std::size_t const_count{0};
+    std::size_t pointer_count{0};
+    pool_string base;
+    die die;
+    attribute_sequence attributes;
+    std::tie(die, attributes) = offset_to_die_pair(reference);
+
+    while (true) {
+        if (die._tag == dw::tag::const_type) {
+            ++const_count;
+        } else if (die._tag == dw::tag::pointer_type) {
+            ++pointer_count;
+        } else {
+            base = resolve_type_name(type, attributes, die._tag);
+            _type_cache.insert(type.reference(), base);
+            break;
+        }
+
+        if (!attributes.has(dw::at::type)) break; // e.g., `const void` or `void*`
+
+        type = attributes.get(dw::at::type);
+        if (const auto found = _type_cache.find(type.reference())) {
+            base = *found;
+            break;
+        }
+
+        std::tie(die, attributes) = offset_to_die_pair(type.reference());
     }
 
+    pool_string result = base;
+
+    if (const_count || pointer_count) {
+        constexpr std::string_view const_k("const ");
+        const auto base_view = base.view();
+        const std::size_t size = const_count * const_k.size() + base_view.size() + pointer_count;
+
+        // Most names fit on the stack.
+        std::array<char, 256> buffer;
+        std::string overflow;
+        char* p = buffer.data();
+        if (size > buffer.size()) {
+            overflow.resize(size);
+            p = overflow.data();
+        }
+
+        char* q = p;
+        for (std::size_t i = 0; i != const_count; ++i) {
+            q = std::copy(const_k.begin(), const_k.end(), q);
+        }
+        q = std::copy(base_view.begin(), base_view.end(), q);
+        q = std::fill_n(q, pointer_count, '*');
+
+        result = empool(std::string_view(p, size));
+    }
+
+    _type_cache.insert(reference, result);
+    return result;
+}
+
+/**************************************************************************************************/
+// The name of a type that is neither `const` nor a pointer. `type` is the attribute that refers to
+// it; `attributes` and `tag` are its own.
+pool_string dwarf::implementation::resolve_type_name(attribute type,
+                                                     const attribute_sequence& attributes,
+                                                     dw::tag tag) {
     auto recurse = [&](auto& attributes) {
         if (!attributes.has(dw::at::type)) return pool_string();
         return resolve_type(attributes.get(dw::at::type));
     };
 
-    pool_string result;
-    die die;
-    attribute_sequence attributes;
-    std::tie(die, attributes) = offset_to_die_pair(reference);
-
-    if (die._tag == dw::tag::const_type) {
-        result = empool("const " + recurse(attributes).allocate_string());
-    } else if (die._tag == dw::tag::pointer_type) {
-        result = empool(recurse(attributes).allocate_string() + "*");
-    } else if (die._tag == dw::tag::typedef_) {
+    if (tag == dw::tag::typedef_) {
         if (const auto maybe_type = recurse(attributes)) {
-            result = maybe_type;
+            return maybe_type;
         } else if (attributes.has_string(dw::at::name)) {
-            result = attributes.string(dw::at::name);
-        } else {
-            // `result` will be empty if we hit this in release
-            // builds. It's bad, but not UB, so the program can
-            // continue from here (though the results will be
-            // untrustworthy).
-            assert(!"Got a typedef with no name?");
+            return attributes.string(dw::at::name);
         }
+        // The result will be empty if we hit this in release
+        // builds. It's bad, but not UB, so the program can
+        // continue from here (though the results will be
+        // untrustworthy).
+        assert(!"Got a typedef with no name?");
     } else if (attributes.has_string(dw::at::type)) {
-        result = type.string();
+        return type.string();
     } else if (attributes.has_reference(dw::at::type)) {
-        result = recurse(attributes);
+        return recurse(attributes);
     } else if (attributes.has_string(dw::at::name)) {
-        result = attributes.string(dw::at::name);
+        return attributes.string(dw::at::name);
     }
 
-    // std::cout << "cached " << hex_print(reference) << ": " << result << '\n';
-    return _type_cache[reference] = result;
+    return pool_string();
 }
 
 /**************************************************************************************************/
@@ -1429,9 +1979,7 @@ die_pair dwarf::implementation::abbreviation_to_die(std::size_t die_address, pro
     die die;
     attribute_sequence attributes;
 
-    die._offset = die_address - _debug_info._offset;
-    die._cu_die_offset = _cu_die_offset;
-    die._cu_header_offset = _cu_header_offset;
+    die._offset = unit_relative(die_address - _debug_info._offset - _cu_header_offset);
     die._arch = _details._arch;
 
     std::size_t abbrev_code = read_uleb();
@@ -1443,25 +1991,85 @@ die_pair dwarf::implementation::abbreviation_to_die(std::size_t die_address, pro
     die._tag = a._tag;
     die._has_children = a._has_children;
 
-    // Can we get rid of this memory allocation? This happens a lot...
+    // Only allocates for abbreviations with more attributes than fit inline.
     attributes.reserve(a._attributes.size());
 
-    std::transform(a._attributes.begin(), a._attributes.end(), std::back_inserter(attributes),
-                   [&](const auto& x) {
-                       // If the attribute is nonfatal, we'll pass over it in `process_attribute`.
-                       return process_attribute(x, die._offset, mode);
-                   });
+    // Units are always decoded completely; `post_process_compilation_unit_die` needs them to be.
+    const bool defer = mode == process_mode::identity && a._tag != dw::tag::compile_unit &&
+                       a._tag != dw::tag::partial_unit;
+
+    for (const auto& step : a._plan) {
+        if (!step._passover && defer && !is_identity_attribute(a._attributes[step._first]._name)) {
+            // Left for `complete_die`, and passed over until then.
+            attribute deferred = a._attributes[step._first];
+            skip_form(deferred._form);
+            deferred._value.passover();
+            attributes.push_back(std::move(deferred));
+            continue;
+        }
+
+        if (!step._passover) {
+            // If the attribute is nonfatal, we may pass over it in `process_attribute`.
+            attributes.push_back(process_attribute(a._attributes[step._first], die._offset, mode));
+            continue;
+        }
+
+        for (std::uint32_t i = 0; i != step._count; ++i) {
+            attribute passed = a._attributes[step._first + i];
+            passed._value.passover();
+            attributes.push_back(std::move(passed));
+        }
+        _s.seekg(step._skip, std::ios::cur);
+    }
 
-    if (mode == process_mode::complete) {
+    if (mode != process_mode::single) {
         // These statements must be kept in sync with the ones dealing with issue 84 below.
         // See https://github.com/adobe/orc/issues/84
         path_identifier_set(die_identifier(die, attributes));
-        die._path = empool(std::string_view(qualified_symbol_name(die, attributes)));
+        die._path = qualified_symbol_name(die, attributes);
     }
 
     return std::make_tuple(std::move(die), std::move(attributes));
 }
 
+/**************************************************************************************************/
+// The second half of decoding a die read with `process_mode::identity`: this reads the die at
+// `die_address` again, and decodes the attributes that were deferred the first time, in place. The
+// read head is left where it was, at the end of the die.
+void dwarf::implementation::complete_die(std::size_t die_address,
+                                         attribute_sequence& attributes) {
+#if ORC_FEATURE(PROFILE_DIE_DETAILS)
+    ZoneScoped;
+#endif // ORC_FEATURE(PROFILE_DIE_DETAILS)
+
+    const auto die_end = _s.tellg();
+    const auto offset = unit_relative(die_address - _debug_info._offset - _cu_header_offset);
+
+    _s.seekg(die_address);
+
+    const auto& a = find_abbreviation(static_cast<std::uint32_t>(read_uleb()));
+
+    if (a._tag == dw::tag::compile_unit || a._tag == dw::tag::partial_unit) {
+        _s.seekg(die_end); // nothing was deferred
+        return;
+    }
+
+    auto deferred = attributes.begin();
+
+    for (const auto& step : a._plan) {
+        if (step._passover) {
+            _s.seekg(step._skip, std::ios::cur);
+        } else if (is_identity_attribute(a._attributes[step._first]._name)) {
+            skip_form(a._attributes[step._first]._form);
+        } else {
+            deferred[step._first] =
+                process_attribute(a._attributes[step._first], offset, process_mode::complete);
+        }
+    }
+
+    assert(_s.tellg() == die_end);
+}
+
 /**************************************************************************************************/
 
 bool dwarf::implementation::register_sections_done() {
@@ -1478,7 +2086,7 @@ bool dwarf::implementation::register_sections_done() {
     //     The first entry in the sequence is the primary source file whose file name exactly
     //     matches that given in the DW_AT_name attribute in the compilation unit debugging
     //     information entry.
-    _decl_files.push_back(object_file_ancestry(_ofd_index)._ancestors[0]);
+    _decl_files.push_back(object_file_ancestry(_ofd_index).front());
 
     // Once we've loaded all the necessary DWARF sections, now we start piecing the details
     // together.
@@ -1505,6 +2113,7 @@ bool dwarf::implementation::skip_die(die& d, const attribute_sequence& attribute
 #if ORC_FEATURE(PROFILE_DIE_DETAILS)
         ZoneTextL("skipping: tagged die");
 #endif // ORC_FEATURE(PROFILE_DIE_DETAILS)
+        orc::stats_die_skipped(d._tag, orc::skip_reason::tag);
         return true;
     }
 
@@ -1515,42 +2124,17 @@ bool dwarf::implementation::skip_die(die& d, const attribute_sequence& attribute
 #if ORC_FEATURE(PROFILE_DIE_DETAILS)
         ZoneTextL("skipping: non-external subprogram");
 #endif // ORC_FEATURE(PROFILE_DIE_DETAILS)
+        orc::stats_die_skipped(d._tag, orc::skip_reason::internal_subprogram);
         return true;
     }
 
-    // Empty path means the die (or an ancestor) is anonymous/unnamed. No need to register
-    // them.
+    // Empty path means the die (or an ancestor) is anonymous/unnamed, or that its path is one
+    // `skip_filter` rejects (see `qualified_symbol_name`). No need to register them.
     if (d._path.empty()) {
 #if ORC_FEATURE(PROFILE_DIE_DETAILS)
-        ZoneTextL("skipping: empty path");
-#endif // ORC_FEATURE(PROFILE_DIE_DETAILS)
-        return true;
-    }
-
-    // Symbols with __ in them are reserved, so are not user-defined. No need to register
-    // them.
-    if (d._path.view().find("::__") != std::string::npos) {
-#if ORC_FEATURE(PROFILE_DIE_DETAILS)
-        ZoneTextL("skipping: non-user-defined (reserved) symbol");
-#endif // ORC_FEATURE(PROFILE_DIE_DETAILS)
-        return true;
-    }
-
-    // There are some symbols that are owned by the compiler and/or OS vendor (read: Apple)
-    // that have been observed to conflict. We skip them for our purposes, as we have no
-    // control over them.
-    if (d._path.view().find("::[u]::objc_object") == 0) {
-#if ORC_FEATURE(PROFILE_DIE_DETAILS)
-        ZoneTextL("skipping: vendor- or compiler-defined symbol");
-#endif // ORC_FEATURE(PROFILE_DIE_DETAILS)
-        return true;
-    }
-
-    // lambdas are ephemeral and can't cause (hopefully) an ODRV
-    if (d._path.view().find("lambda") != std::string::npos) {
-#if ORC_FEATURE(PROFILE_DIE_DETAILS)
-        ZoneTextL("skipping: lambda");
+        ZoneTextL("skipping: empty or filtered path");
 #endif // ORC_FEATURE(PROFILE_DIE_DETAILS)
+        orc::stats_die_skipped(d._tag, orc::skip_reason::path);
         return true;
     }
 
@@ -1559,15 +2143,7 @@ bool dwarf::implementation::skip_die(die& d, const attribute_sequence& attribute
 #if ORC_FEATURE(PROFILE_DIE_DETAILS)
         ZoneTextL("skipping: apple runtime class");
 #endif // ORC_FEATURE(PROFILE_DIE_DETAILS)
-        return true;
-    }
-
-    // If the symbol is listed in the symbol_ignore list, we're done here.
-    std::string_view symbol = d._path.view();
-    if (symbol.size() > 7 && sorted_has(settings::instance()._symbol_ignore, symbol.substr(7))) {
-#if ORC_FEATURE(PROFILE_DIE_DETAILS)
-        ZoneTextL("skipping: on symbol_ignore list");
-#endif // ORC_FEATURE(PROFILE_DIE_DETAILS)
+        orc::stats_die_skipped(d._tag, orc::skip_reason::objc_class);
         return true;
     }
 
@@ -1579,6 +2155,7 @@ bool dwarf::implementation::skip_die(die& d, const attribute_sequence& attribute
 #if ORC_FEATURE(PROFILE_DIE_DETAILS)
             ZoneTextL("skipping: self-referential type");
 #endif // ORC_FEATURE(PROFILE_DIE_DETAILS)
+            orc::stats_die_skipped(d._tag, orc::skip_reason::self_referential_type);
             return true;
         }
     }
@@ -1588,9 +2165,149 @@ bool dwarf::implementation::skip_die(die& d, const attribute_sequence& attribute
     TracyMessageL("odr_used");
     ZoneColor(tracy::Color::ColorType::Green);
 #endif // ORC_FEATURE(PROFILE_DIE_DETAILS)
+    orc::stats_die_registered(d._tag);
     return false;
 }
 
+/**************************************************************************************************/
+// Some dies can have nothing worth registering beneath them. The biggest by far are the bodies of
+// functions that are not visible outside their compilation unit (which, for the purposes of
+// `skip_die`, includes out-of-line definitions of member functions): their parameters, locals,
+// lexical blocks, and inlined call sites. A body can still define types of its own, though (say,
+// a local class in an inline member function), which are as subject to the ODR as any other, so
+// a body is only skipped if it defines none. Finding out means walking the body by abbreviation
+// (the `DW_AT_sibling` jump can't be taken, as it would step over any types), and a body that does
+// define a type is then walked a second time, die by die. Dies that are skipped for their own
+// sake, or for a rejected scope, take the jump if they have one. If `d` is to be skipped, this
+// moves past all of its descendants, so the read head is left at its next sibling, and returns
+// true.
+bool dwarf::implementation::skip_subtree(const die& d, const attribute_sequence& attributes) {
+#if ORC_FEATURE(PROFILE_DIE_DETAILS)
+    ZoneScoped;
+#endif // ORC_FEATURE(PROFILE_DIE_DETAILS)
+
+    if (!settings::instance()._skip_subtrees || !d._skippable) return false;
+
+    const bool hidden_subprogram =
+        d._tag == dw::tag::subprogram && !has_flag_attribute(attributes, dw::at::external);
+    const bool skipped_tag = d._tag != dw::tag::compile_unit &&
+                             d._tag != dw::tag::partial_unit && skip_tagged_die(d);
+    // Every path beneath a rejected scope (like a reserved namespace) is rejected, too.
+    const bool filtered_scope = _filter_cursors.back()._rejected;
+
+    if (!hidden_subprogram && !skipped_tag && !filtered_scope) return false;
+
+    if (!skipped_tag && !filtered_scope) {
+        const std::size_t children = _s.tellg();
+        if (skip_descendants(defines_type)) return true;
+        _s.seekg(children);
+        return false;
+    }
+
+    // The producer may have left us the way to the next sibling.
+    if (attributes.has_reference(dw::at::sibling)) {
+        _s.seekg(_debug_info._offset + attributes.reference(dw::at::sibling));
+        return true;
+    }
+
+    skip_descendants();
+
+    return true;
+}
+
+/**************************************************************************************************/
+// When scanning through the accelerator tables, this decides whether the die that was just read,
+// which has children, is an ancestor of the listed die at `target`. If it is, the read head is
+// left at its first child, and this returns true. Otherwise the read head is moved past its
+// descendants.
+bool dwarf::implementation::descend_toward(std::size_t target,
+                                           const attribute_sequence& attributes) {
+    if (attributes.has_reference(dw::at::sibling)) {
+        const std::size_t sibling = _debug_info._offset + attributes.reference(dw::at::sibling);
+        if (target < sibling) return true;
+        _s.seekg(sibling);
+        return false;
+    }
+
+    const std::size_t children = _s.tellg();
+    skip_descendants();
+    if (target >= _s.tellg()) return false;
+    _s.seekg(children);
+    return true;
+}
+
+/**************************************************************************************************/
+// Moves the read head past the descendants of the die that was just read, without decoding them,
+// and returns true. If `stop` is given, it is asked about the tag of each descendant first; if it
+// says to stop, the read head is left somewhere among the descendants, and this returns false.
+bool dwarf::implementation::skip_descendants(bool (*stop)(dw::tag)) {
+    for (std::size_t depth = 1; depth != 0;) {
+        const auto code = static_cast<std::uint32_t>(read_uleb());
+
+        if (code == 0) {
+            --depth;
+            continue;
+        }
+
+        const auto& a = find_abbreviation(code);
+
+        if (stop && stop(a._tag)) return false;
+
+        if (a._fixed_size != abbrev::variable_size_k) {
+            _s.seekg(a._fixed_size, std::ios::cur);
+        } else {
+            for (const auto& attribute : a._attributes) {
+                skip_form(attribute._form);
+            }
+        }
+
+        if (a._has_children) ++depth;
+    }
+
+    return true;
+}
+
+/**************************************************************************************************/
+
+void dwarf::implementation::skip_form(dw::form form) {
+    if (const auto fixed = fixed_form_length(form)) {
+        _s.seekg(*fixed, std::ios::cur);
+        return;
+    }
+
+    switch (form) {
+        case dw::form::ref_addr: {
+            _s.seekg(_cu_header._version == 2 ? 8 : 4, std::ios::cur); // as `process_form` reads
+        } break;
+        case dw::form::string: {
+            (void)_s.read_c_string_view();
+        } break;
+        case dw::form::block1: {
+            _s.seekg(read8(), std::ios::cur);
+        } break;
+        case dw::form::block2: {
+            _s.seekg(read16(), std::ios::cur);
+        } break;
+        case dw::form::block4: {
+            _s.seekg(read32(), std::ios::cur);
+        } break;
+        case dw::form::block:
+        case dw::form::exprloc: {
+            _s.seekg(read_uleb(), std::ios::cur);
+        } break;
+        case dw::form::indirect: {
+            skip_form(static_cast<dw::form>(read_uleb()));
+        } break;
+        case dw::form::sdata: {
+            (void)read_sleb();
+        } break;
+        default: {
+            // Every other form is a single LEB128 value (`udata`, `ref_udata`, `strx`, etc.)
+            (void)read_uleb();
+        } break;
+    }
+}
+
 /**************************************************************************************************/
 
 void dwarf::implementation::report_die_processing_failure(std::size_t die_address,
@@ -1614,25 +2331,180 @@ void dwarf::implementation::report_die_processing_failure(std::size_t die_addres
 
 /**************************************************************************************************/
 
-void dwarf::implementation::process_all_dies() {
-    if (!_ready && !register_sections_done()) return;
+// The offsets (within the file) of every unit header in `__debug_info`, followed by the end of the
+// section. Each header starts with the length of its unit, so this doesn't read any dies.
+std::vector<std::size_t> dwarf::implementation::unit_offsets() {
+    std::vector<std::size_t> result;
+    const std::size_t section_end = _debug_info._offset + _debug_info._size;
+
+    for (std::size_t offset = _debug_info._offset; offset < section_end;) {
+        result.push_back(offset);
+        const auto length = temp_seek(_s, offset, [&] {
+            return read_pod<std::uint32_t>(_s, _details._needs_byteswap);
+        });
+        if (length >= 0xfffffff0) break; // DWARF64; `cu_header::read` will complain.
+        offset += sizeof(std::uint32_t) + length;
+    }
+
+    result.push_back(section_end);
+    return result;
+}
+
+/**************************************************************************************************/
+// A copy of this implementation, ready to process the units of the same file, that shares nothing
+// with it that either will change.
+std::unique_ptr<dwarf::implementation> dwarf::implementation::fork() const {
+    auto result = std::make_unique<implementation>(_ofd_index, copy(_s), copy(_details));
+    result->_abbreviations = _abbreviations;
+    result->_abbreviation_index = _abbreviation_index;
+    result->_decl_files = _decl_files;
+    result->_debug_str_table = _debug_str_table;
+    result->_accelerated_offsets = _accelerated_offsets;
+    result->_debug_abbrev = _debug_abbrev;
+    result->_debug_info = _debug_info;
+    result->_debug_line = _debug_line;
+    result->_debug_str = _debug_str;
+    result->_ready = true;
+    return result;
+}
+
+/**************************************************************************************************/
+
+die_counts dwarf::implementation::process_all_dies(std::vector<die>* registered) {
+    if (!_ready && !register_sections_done()) return die_counts();
     assert(_ready);
 
-    auto section_begin = _debug_info._offset;
-    auto section_end = section_begin + _debug_info._size;
+    read_accelerator_tables();
+
+    // With the accelerator tables, most dies are never read, and neither are most strings; the
+    // few that are needed are read lazily (see `read_debug_str`.)
+    if (!_accelerated_offsets) preload_debug_str();
+
+    // Units are independent of one another, so when one file has a lot of DWARF (as a dSYM does)
+    // its units are split into ranges that are processed in parallel, each by its own fork of
+    // this implementation. Object files are usually a single unit, and are left alone.
+    constexpr std::size_t parallel_threshold_k = 16 * 1024 * 1024; // bytes of `__debug_info`
+    constexpr std::size_t range_size_k = 4 * 1024 * 1024; // bytes of units per range, at least
+
+    std::vector<std::size_t> offsets;
+    if (settings::instance()._parallel_processing && _debug_info._size >= parallel_threshold_k) {
+        offsets = unit_offsets();
+    }
+
+    if (offsets.size() <= 2) {
+        const auto result =
+            process_units(_debug_info._offset, _debug_info._offset + _debug_info._size, registered);
+        globals::instance()._die_processed_count += result._processed;
+        globals::instance()._die_skipped_count += result._skipped;
+        return result;
+    }
+
+    ZoneScopedN("process_all_dies (parallel)");
+
+    // Split the units into ranges of at least `range_size_k` bytes.
+    std::vector<std::pair<std::size_t, std::size_t>> ranges;
+    for (std::size_t i = 0; i + 1 < offsets.size();) {
+        std::size_t j = i + 1;
+        while (j + 1 < offsets.size() && offsets[j] - offsets[i] < range_size_k) {
+            ++j;
+        }
+        ranges.emplace_back(offsets[i], offsets[j]);
+        i = j;
+    }
 
-    _s.seekg(section_begin);
+    ZoneValue(ranges.size());
+
+    std::vector<die_counts> counts(ranges.size());
+    std::vector<std::vector<die>> registered_ranges(registered ? ranges.size() : 0);
+    std::vector<std::exception_ptr> errors(ranges.size());
+
+    const auto process_range = [&](implementation& impl, std::size_t i) {
+        try {
+            counts[i] = impl.process_units(ranges[i].first, ranges[i].second,
+                                           registered ? &registered_ranges[i] : nullptr);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    };
+
+    orc::work_group group;
+
+    for (std::size_t i = 1; i != ranges.size(); ++i) {
+        group.do_work([&, i, _impl = std::shared_ptr<implementation>(fork())] {
+            process_range(*_impl, i);
+        });
+    }
+
+    process_range(*this, 0);
+
+    // This waits on the other ranges alone (running pending work meanwhile), so the file is let go
+    // as soon as they are done, not once everything else in the queue is.
+    group.block();
+
+    die_counts result;
+    for (std::size_t i = 0; i != ranges.size(); ++i) {
+        if (errors[i]) std::rethrow_exception(errors[i]);
+        result._processed += counts[i]._processed;
+        result._skipped += counts[i]._skipped;
+        if (registered) {
+            registered->insert(registered->end(), registered_ranges[i].begin(),
+                               registered_ranges[i].end());
+        }
+    }
+
+    globals::instance()._die_processed_count += result._processed;
+    globals::instance()._die_skipped_count += result._skipped;
+
+    return result;
+}
+
+/**************************************************************************************************/
+// Processes the units between the file offsets `first` and `last`, which must be unit boundaries.
+die_counts dwarf::implementation::process_units(std::size_t first,
+                                                std::size_t last,
+                                                std::vector<die>* registered) {
+    _s.seekg(first);
 
     // Have a nonempty stack in the path
     path_identifier_push();
 
-    dies dies;
+    std::size_t die_count{0};
+    std::size_t skip_count{0};
+
+    // When scanning through the accelerator tables, `next_target` is the next listed die to be
+    // processed, and `target_depth` is the size of the path at the listed die being processed (or
+    // zero, when between them.)
+    std::vector<std::size_t>::const_iterator next_target;
+    std::vector<std::size_t>::const_iterator last_target;
+    std::size_t target_depth{0};
+
+    if (_accelerated_offsets) {
+        next_target = std::lower_bound(_accelerated_offsets->begin(), _accelerated_offsets->end(),
+                                       first);
+        last_target = _accelerated_offsets->end();
+    }
+
+    while (_s.tellg() < last) {
+        // Nothing more gets registered once processing has been cancelled.
+        if (globals::instance()._cancelled) break;
 
-    while (_s.tellg() < section_end) {
         _cu_header_offset = _s.tellg() - _debug_info._offset;
 
         _cu_header.read(_s, _details._needs_byteswap);
 
+        const std::size_t unit_end = _debug_info._offset + _cu_header_offset +
+                                     sizeof(std::uint32_t) + _cu_header._length;
+
+        // A unit with nothing listed in it isn't read at all.
+        if (_accelerated_offsets && (next_target == last_target || *next_target >= unit_end)) {
+            _s.seekg(unit_end);
+            continue;
+        }
+
+        _cu_index = object_file_unit_register(_cu_header_offset);
+        // Until the unit die is read (see `post_process_compilation_unit_die`.)
+        _cu_die_offset = _cu_header_offset;
+
         // process dies one at a time, recording things like addresses along the way.
         while (true) {
 #if ORC_FEATURE(PROFILE_DIE_DETAILS)
@@ -1645,7 +2517,7 @@ void dwarf::implementation::process_all_dies() {
 
             try {
                 std::tie(die, attributes) =
-                    abbreviation_to_die(die_address, process_mode::complete);
+                    abbreviation_to_die(die_address, process_mode::identity);
             } catch (const std::exception& error) {
                 // `report_die_processing_failure` will rethrow
                 report_die_processing_failure(die_address, error.what());
@@ -1654,8 +2526,8 @@ void dwarf::implementation::process_all_dies() {
                 report_die_processing_failure(die_address, "unknown");
             }
 
-            die._cu_header_offset = _cu_header_offset;
-            die._cu_die_offset = _cu_die_offset;
+            die._cu_index = _cu_index;
+            die._cu_die_offset = unit_relative(_cu_die_offset - _cu_header_offset);
 
 #if ORC_FEATURE(PROFILE_DIE_DETAILS)
             const char* tag_str = to_string(die._tag);
@@ -1672,6 +2544,8 @@ void dwarf::implementation::process_all_dies() {
             if (die._tag == dw::tag::none) {
                 path_identifier_pop();
 
+                if (_path.size() == target_depth) target_depth = 0;
+
                 if (_path.size() == 1) {
                     break; // end of the compilation unit
                 }
@@ -1693,6 +2567,8 @@ void dwarf::implementation::process_all_dies() {
 
             post_process_die_attributes(attributes);
 
+            bool named_by_typedef{false};
+
             // See https://github.com/adobe/orc/issues/84
             // This code accounts for unnamed structs that are part of
             // a typedef expression. In such case the typedef actually adds a name
@@ -1713,20 +2589,59 @@ void dwarf::implementation::process_all_dies() {
 
                 // These two statements must be in sync with the ones in `abbreviation_to_die`
                 path_identifier_set(die_identifier(die, attributes));
-                die._path = empool(std::string_view(qualified_symbol_name(die, attributes)));
+                die._path = qualified_symbol_name(die, attributes);
 
                 _last_typedef_name = pool_string(); // reset it to avoid misuse
+                named_by_typedef = true;
             }
 
-            if (die._has_children) {
-                path_identifier_push();
+            if (_accelerated_offsets && target_depth == 0 && die._tag != dw::tag::compile_unit &&
+                die._tag != dw::tag::partial_unit) {
+                while (next_target != last_target && *next_target < die_address) {
+                    ++next_target;
+                }
+
+                // Nothing else in this unit is listed, so the rest of it can go.
+                if (next_target == last_target || *next_target >= unit_end) {
+                    while (_path.size() > 1) {
+                        path_identifier_pop();
+                    }
+                    _s.seekg(unit_end);
+                    break;
+                }
+
+                // Unnamed structures are not listed, but get their names from the typedef that
+                // came before them (see above), and are processed as though they had been.
+                if (*next_target == die_address || named_by_typedef) {
+                    target_depth = _path.size();
+                } else {
+                    if (die._has_children && descend_toward(*next_target, attributes)) {
+                        path_identifier_push();
+                    }
+                    continue;
+                }
             }
 
             die._skippable = skip_die(die, attributes);
             die._ofd_index = _ofd_index;
-            die._hash = die_hash(die, attributes);
-            die._fatal_attribute_hash = fatal_attribute_hash(attributes);
-            die._location = derive_definition_location(attributes);
+
+            // Everything from here on is only needed for dies that are registered.
+            if (!die._skippable) {
+                complete_die(die_address, attributes);
+                post_process_die_attributes(attributes);
+
+                die._hash = die_hash(die, attributes);
+                die._fatal_attribute_hash = fatal_attribute_hash(attributes);
+                die.set_definition_location(derive_definition_location(attributes));
+            }
+
+            // A die whose children are skipped has nothing pushed for them, as the null entry
+            // that would pop it is skipped, too.
+            if (die._has_children && !skip_subtree(die, attributes)) {
+                path_identifier_push();
+            }
+
+            if (_path.size() == target_depth) target_depth = 0;
 
 #if ORC_FEATURE(PROFILE_DIE_DETAILS)
             auto path_view = die._path.view();
@@ -1743,20 +2658,25 @@ void dwarf::implementation::process_all_dies() {
             ZoneTextL(msg);
 #endif // ORC_FEATURE(PROFILE_DIE_DETAILS)
 
-            dies.emplace_back(std::move(die));
+            ++die_count;
+
+            if (die._skippable) {
+                ++skip_count;
+            } else {
+                if (registered) registered->push_back(die);
+                orc::register_die(std::move(die));
+            }
         }
     }
 
-    dies.shrink_to_fit();
-
-    orc::register_dies(std::move(dies));
+    return die_counts{die_count, skip_count};
 }
 
 /**************************************************************************************************/
 
 void dwarf::implementation::post_process_compilation_unit_die(
     const die& die, const attribute_sequence& attributes) {
-    _cu_die_offset = die._offset;
+    _cu_die_offset = _cu_header_offset + die._offset;
 
     // Spec (section 3.1.1) says that compilation and partial units may specify which
     // __debug_line subsection they want to draw their decl_files list from. This also
@@ -1788,13 +2708,16 @@ void dwarf::implementation::post_process_compilation_unit_die(
 
 /**************************************************************************************************/
 
+// This is done once after each half of the decode (see `complete_die`). An attribute is resolved
+// by whichever half has it decoded, and not again by the other.
 void dwarf::implementation::post_process_die_attributes(attribute_sequence& attributes) {
-    if (attributes.has(dw::at::type)) {
+    if (attributes.has_reference(dw::at::type) && !attributes.has_string(dw::at::type)) {
         auto& attribute = attributes.get(dw::at::type);
         attribute._value.string(resolve_type(attribute));
     }
 
-    if (attributes.has(dw::at::containing_type)) {
+    if (attributes.has_reference(dw::at::containing_type) &&
+        !attributes.has_string(dw::at::containing_type)) {
         auto& attribute = attributes.get(dw::at::containing_type);
         attribute._value.string(resolve_type(attribute));
     }
@@ -1813,7 +2736,10 @@ die_pair dwarf::implementation::fetch_one_die(std::size_t die_offset,
 
     _cu_header_offset = cu_header_offset;
 
-    if (cu_die_offset != die_offset) {
+    // The compilation unit die's details (e.g., its decl files) are already loaded if the previous
+    // die fetched was from the same unit. (`_cu_die_offset` starts out as 0, which is always the
+    // offset of a unit header, never a die.)
+    if (cu_die_offset != die_offset && cu_die_offset != _cu_die_offset) {
         // This loads some state into the dwarf::implementation that makes the `abbreviation_to_die`
         // call more meaningful for the original die we are trying to fetch.
         die_pair cu_pair = fetch_one_die(cu_die_offset, cu_header_offset, cu_die_offset);
@@ -1842,7 +2768,11 @@ void dwarf::register_section(std::string name, std::size_t offset, std::size_t s
     _impl->register_section(std::move(name), offset, size);
 }
 
-void dwarf::process_all_dies() { _impl->process_all_dies(); }
+die_counts dwarf::process_all_dies(std::vector<die>* registered) {
+    const auto result = _impl->process_all_dies(registered);
+    orc::stats_object_file_dies(result._processed);
+    return result;
+}
 
 die_pair dwarf::fetch_one_die(std::size_t die_offset,
                               std::size_t cu_header_offset,
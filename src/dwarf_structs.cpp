@@ -9,8 +9,14 @@
 
 // stdc++
 #include <filesystem>
+#include <mutex>
+#include <unordered_map>
+
+// tbb
+#include <tbb/concurrent_vector.h>
 
 // application
+#include "orc/memory.hpp"
 #include "orc/object_file_registry.hpp"
 #include "orc/parse_file.hpp"
 
@@ -134,9 +140,116 @@ std::ostream& operator<<(std::ostream& s, const attribute_sequence& x) {
 
 /**************************************************************************************************/
 
+namespace {
+
+/**************************************************************************************************/
+// Node 0 is the empty ancestry, which is the root of the tree. Nodes are only ever added, and the
+// vector does not move them when it grows, so they can be read without taking the lock.
+class ancestry_tree {
+public:
+    struct node {
+        pool_string _name;
+        std::uint32_t _parent{0};
+        std::uint32_t _size{0};
+    };
+
+    ancestry_tree() { _nodes.emplace_back(); }
+
+    const node& operator[](std::uint32_t id) const { return _nodes[id]; }
+
+    std::uint32_t child(std::uint32_t parent, pool_string name) {
+        // pool_strings are unique, so their data pointers make for cheap keys.
+        const key k{parent, name.view().data()};
+
+        std::lock_guard<std::mutex> lock(_m);
+        const auto found = _children.find(k);
+        if (found != _children.end()) return found->second;
+
+        const auto result = static_cast<std::uint32_t>(_nodes.size());
+        _nodes.push_back(node{name, parent, _nodes[parent]._size + 1});
+        _children.emplace(k, result);
+        return result;
+    }
+
+private:
+    using key = std::pair<std::uint32_t, const char*>;
+
+    struct key_hash {
+        std::size_t operator()(const key& x) const {
+            return orc::hash_combine(x.first, reinterpret_cast<std::uintptr_t>(x.second));
+        }
+    };
+
+    std::mutex _m;
+    tbb::concurrent_vector<node> _nodes;
+    std::unordered_map<key, std::uint32_t, key_hash> _children;
+};
+
+auto& global_ancestry_tree() {
+    static decltype(auto) tree_s = orc::make_leaky<ancestry_tree>();
+    return tree_s;
+}
+
+// Compares the names of two ancestries of the same size, from the top-level file down.
+int compare_names(std::uint32_t x, std::uint32_t y) {
+    if (x == y) return 0;
+    const auto& tree = global_ancestry_tree();
+    const auto& a = tree[x];
+    const auto& b = tree[y];
+    if (const int result = compare_names(a._parent, b._parent)) return result;
+    return a._name.view().compare(b._name.view());
+}
+
+/**************************************************************************************************/
+
+} // namespace
+
+/**************************************************************************************************/
+
+std::size_t object_ancestry::size() const { return global_ancestry_tree()[_id]._size; }
+
+pool_string object_ancestry::front() const {
+    assert(!empty());
+    const auto& tree = global_ancestry_tree();
+    std::uint32_t id = _id;
+    while (tree[id]._parent) {
+        id = tree[id]._parent;
+    }
+    return tree[id]._name;
+}
+
+pool_string object_ancestry::back() const {
+    assert(!empty());
+    return global_ancestry_tree()[_id]._name;
+}
+
+std::vector<pool_string> object_ancestry::names() const {
+    const auto& tree = global_ancestry_tree();
+    std::vector<pool_string> result(size());
+    std::uint32_t id = _id;
+    for (auto name = result.rbegin(); name != result.rend(); ++name) {
+        *name = tree[id]._name;
+        id = tree[id]._parent;
+    }
+    return result;
+}
+
+void object_ancestry::emplace_back(pool_string&& ancestor) {
+    _id = global_ancestry_tree().child(_id, std::move(ancestor));
+}
+
+bool object_ancestry::operator<(const object_ancestry& rhs) const {
+    const std::size_t x = size();
+    const std::size_t y = rhs.size();
+    if (x != y) return x < y;
+    return compare_names(_id, rhs._id) < 0;
+}
+
+/**************************************************************************************************/
+
 std::ostream& operator<<(std::ostream& s, const object_ancestry& x) {
     bool first = true;
-    for (const auto& ancestor : x) {
+    for (const auto& ancestor : x.names()) {
         if (first) {
             first = false;
         } else {
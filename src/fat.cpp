@@ -11,6 +11,12 @@
 #include <mach-o/loader.h>
 #include <mach-o/fat.h>
 
+// application
+#include "orc/async.hpp"
+#include "orc/orc.hpp" // for cout_safe
+#include "orc/settings.hpp"
+#include "orc/tracy.hpp"
+
 /**************************************************************************************************/
 
 namespace {
@@ -34,6 +40,18 @@ const char* cputype_to_string(cpu_type_t cputype) {
     return "arch.unknown";
 }
 
+/**************************************************************************************************/
+// Returns `true` if the user has asked for this architecture to be scanned. An empty
+// `architectures` list in the settings means every architecture is scanned.
+bool scan_architecture(cpu_type_t cputype) {
+    const auto& architectures = settings::instance()._architectures;
+    if (architectures.empty()) return true;
+    constexpr std::string_view prefix_k = "arch.";
+    const std::string_view name =
+        std::string_view(cputype_to_string(cputype)).substr(prefix_k.size());
+    return sorted_has(architectures, name);
+}
+
 /**************************************************************************************************/
 
 } // namespace
@@ -54,7 +72,6 @@ void read_fat(object_ancestry&& ancestry,
     assert(header.magic == FAT_MAGIC || header.magic == FAT_MAGIC_64);
     const bool is_64_bit = header.magic == FAT_MAGIC_64;
 
-    // REVISIT: (fbrereto) opportunity to parallelize here.
     for (std::size_t i = 0; i < header.nfat_arch; ++i) {
         std::size_t offset{0};
         std::size_t size{0};
@@ -86,9 +103,24 @@ void read_fat(object_ancestry&& ancestry,
             cputype = arch.cputype;
         }
 
-        temp_seek(s, offset, [&] {
-            parse_file(cputype_to_string(cputype), ancestry, s,
-                       s.tellg() + static_cast<std::streamoff>(size), params);
+        if (!scan_architecture(cputype)) {
+            if (log_level_at_least(settings::log_level::verbose)) {
+                cout_safe([&](auto& s) {
+                    s << "verbose: skipping " << cputype_to_string(cputype) << " slice of "
+                      << ancestry << '\n';
+                });
+            }
+            continue;
+        }
+
+        // Each slice is an independent Mach-O file, so they can all be parsed at the same time.
+        // The tasks share the mmapped buffer behind `s`.
+        orc::do_work([_ancestry = ancestry, _s = s, _params = params, offset, size,
+                      cputype]() mutable {
+            ZoneScopedN("read_fat_slice");
+            _s.seekg(offset);
+            parse_file(cputype_to_string(cputype), _ancestry, _s,
+                       static_cast<std::streamoff>(offset + size), std::move(_params));
         });
     }
 }
@@ -8,6 +8,7 @@
 #include "orc/hash.hpp"
 
 // application
+#include "orc/features.hpp"
 #include "orc/memory.hpp"
 
 /**************************************************************************************************/
@@ -58,6 +59,104 @@ FORCE_INLINE uint64_t fmix64(uint64_t k) {
 
 /**************************************************************************************************/
 
+#if ORC_FEATURE(FAST_STRING_HASH)
+
+/**************************************************************************************************/
+// An implementation of wyhash (final version 4) by Wang Yi, released into the public domain, since
+// modified and used here. Most of the strings ORC hashes are under 64 bytes, where wyhash's few
+// 64x64->128 bit multiplies beat both MurmurHash3 and the SIMD hashes (whose setup costs more than
+// the string does.) Longer strings are consumed 48 bytes at a time in three independent lanes,
+// which keeps the multipliers busy much like a vector unit would.
+
+FORCE_INLINE void wymum(std::uint64_t& a, std::uint64_t& b) {
+#if defined(_MSC_VER)
+    a = _umul128(a, b, &b);
+#else
+    const __uint128_t r = static_cast<__uint128_t>(a) * b;
+    a = static_cast<std::uint64_t>(r);
+    b = static_cast<std::uint64_t>(r >> 64);
+#endif
+}
+
+FORCE_INLINE std::uint64_t wymix(std::uint64_t a, std::uint64_t b) {
+    wymum(a, b);
+    return a ^ b;
+}
+
+FORCE_INLINE std::uint64_t wyr8(const std::uint8_t* p) {
+    return orc::unaligned_read<std::uint64_t>(p);
+}
+
+FORCE_INLINE std::uint64_t wyr4(const std::uint8_t* p) {
+    return orc::unaligned_read<std::uint32_t>(p);
+}
+
+// Reads 1 to 3 bytes.
+FORCE_INLINE std::uint64_t wyr3(const std::uint8_t* p, std::size_t k) {
+    return (std::uint64_t(p[0]) << 16) | (std::uint64_t(p[k >> 1]) << 8) | p[k - 1];
+}
+
+constexpr std::uint64_t wyp_k[4] = {
+    BIG_CONSTANT(0x2d358dccaa6c78a5),
+    BIG_CONSTANT(0x8bb84b93962eacc9),
+    BIG_CONSTANT(0x4b33a62ed433d4a3),
+    BIG_CONSTANT(0x4d5a2da51de1aa47),
+};
+
+std::uint64_t wyhash(const void* key, std::size_t len, std::uint64_t seed = 0) {
+    const std::uint8_t* p = static_cast<const std::uint8_t*>(key);
+    seed ^= wymix(seed ^ wyp_k[0], wyp_k[1]);
+    std::uint64_t a;
+    std::uint64_t b;
+
+    if (len <= 16) {
+        if (len >= 4) {
+            // Two (possibly overlapping) pairs of 4-byte reads cover all 4 to 16 bytes.
+            const std::size_t d = (len >> 3) << 2;
+            a = (wyr4(p) << 32) | wyr4(p + d);
+            b = (wyr4(p + len - 4) << 32) | wyr4(p + len - 4 - d);
+        } else if (len > 0) {
+            a = wyr3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        std::size_t i = len;
+        if (i >= 48) {
+            std::uint64_t see1 = seed;
+            std::uint64_t see2 = seed;
+            do {
+                seed = wymix(wyr8(p) ^ wyp_k[1], wyr8(p + 8) ^ seed);
+                see1 = wymix(wyr8(p + 16) ^ wyp_k[2], wyr8(p + 24) ^ see1);
+                see2 = wymix(wyr8(p + 32) ^ wyp_k[3], wyr8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i >= 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = wymix(wyr8(p) ^ wyp_k[1], wyr8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        // The last 16 bytes, which may overlap the ones already hashed.
+        a = wyr8(p + i - 16);
+        b = wyr8(p + i - 8);
+    }
+
+    a ^= wyp_k[1];
+    b ^= seed;
+    wymum(a, b);
+    return wymix(a ^ wyp_k[0] ^ len, b ^ wyp_k[1]);
+}
+
+/**************************************************************************************************/
+
+#endif // ORC_FEATURE(FAST_STRING_HASH)
+
+/**************************************************************************************************/
+
 } // namespace
 
 /**************************************************************************************************/
@@ -155,6 +254,24 @@ murmur_hash murmur3(const void* key, int len, uint32_t seed) {
 
 /**************************************************************************************************/
 
+std::size_t string_hash(const void* key, std::size_t len) {
+#if ORC_FEATURE(FAST_STRING_HASH)
+    return wyhash(key, len);
+#else
+    return murmur3_64(key, static_cast<int>(len));
+#endif
+}
+
+const char* string_hash_name() {
+#if ORC_FEATURE(FAST_STRING_HASH)
+    return "wyhash4";
+#else
+    return "murmur3";
+#endif
+}
+
+/**************************************************************************************************/
+
 } // namespace orc
 
 /**************************************************************************************************/
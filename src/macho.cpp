@@ -8,7 +8,15 @@
 #include "orc/macho.hpp"
 
 // stdc++
+#include <map>
+#include <mutex>
+#include <optional>
+#include <set>
 #include <sstream>
+#include <unordered_map>
+
+// system
+#include <sys/stat.h>
 
 // mach-o
 #include <mach-o/loader.h>
@@ -19,11 +27,15 @@
 #include <tbb/concurrent_map.h>
 
 // application
+#include "orc/ar.hpp"
 #include "orc/async.hpp"
+#include "orc/die_cache.hpp"
 #include "orc/dwarf.hpp"
+#include "orc/hash.hpp"
 #include "orc/object_file_registry.hpp"
 #include "orc/orc.hpp" // for cerr_safe
 #include "orc/settings.hpp"
+#include "orc/stats.hpp"
 #include "orc/str.hpp"
 #include "orc/tracy.hpp"
 
@@ -65,10 +77,18 @@ struct macho_reader {
 
     bool register_dies_mode() const { return _params._mode == macho_reader_mode::register_dies; }
     bool derive_dylibs_mode() const { return _params._mode == macho_reader_mode::derive_dylibs; }
-    // bool odrv_reporting_mode() const { return _params._mode == macho_reader_mode::odrv_reporting; }
+    bool odrv_reporting_mode() const { return _params._mode == macho_reader_mode::odrv_reporting; }
 
     void derive_dependencies();
 
+    // Applies `a` to the DWARF sections ORC reads, e.g., to let their pages go once the dies in
+    // them have all been processed.
+    void advise_dwarf_sections(freader::advice a) const;
+
+    // Whether an object file with the same contents as this one, which takes up `size` bytes, has
+    // already been registered. If so, this one is recorded as its alias.
+    bool deduplicate(std::size_t size) const;
+
 private:
     void populate_dwarf();
     void read_load_command();
@@ -85,6 +105,7 @@ private:
     const macho_params _params;
     std::vector<std::string> _unresolved_dylibs;
     std::vector<std::string> _rpaths;
+    std::vector<std::pair<std::size_t, std::size_t>> _dwarf_sections; // offset, size
     struct dwarf _dwarf; // must be last
 };
 
@@ -109,8 +130,52 @@ void macho_reader::read_lc_segment_64_section() {
 
     if (rstrip(section.segname) != "__DWARF") return;
 
-    _dwarf.register_section(rstrip(section.sectname), _details._offset + section.offset,
-                            section.size);
+    const auto name = rstrip(section.sectname);
+    const std::size_t offset = _details._offset + section.offset;
+
+    _dwarf.register_section(name, offset, section.size);
+
+    // These are the sections the dwarf reads. When processing all the dies, each is read from
+    // front to back; otherwise only a few dies are looked at.
+    if (name != "__debug_info" && name != "__debug_abbrev" && name != "__debug_str" &&
+        name != "__debug_line") {
+        return;
+    }
+
+    _dwarf_sections.emplace_back(offset, section.size);
+
+    if (register_dies_mode()) {
+        _s.advise(freader::advice::sequential, offset, section.size);
+        _s.advise(freader::advice::willneed, offset, section.size);
+    } else if (odrv_reporting_mode()) {
+        _s.advise(freader::advice::random, offset, section.size);
+    }
+}
+
+/**************************************************************************************************/
+
+void macho_reader::advise_dwarf_sections(freader::advice a) const {
+    for (const auto& [offset, size] : _dwarf_sections) {
+        _s.advise(a, offset, size);
+    }
+}
+
+/**************************************************************************************************/
+
+// Object files are told apart by their size, and a hash of the DWARF sections ORC reads. (The
+// other sections, like code, can't change what gets registered.)
+bool macho_reader::deduplicate(std::size_t size) const {
+    if (_dwarf_sections.empty()) return false;
+
+    ZoneScoped;
+
+    std::uint64_t fingerprint{0};
+    for (const auto& [offset, section_size] : _dwarf_sections) {
+        fingerprint =
+            orc::hash_combine(fingerprint, orc::string_hash(_s.data() + offset, section_size));
+    }
+
+    return object_file_deduplicate(fingerprint, size, _ofd_index) != _ofd_index;
 }
 
 /**************************************************************************************************/
@@ -173,6 +238,39 @@ void macho_reader::read_lc_rpath() {
     _s.seekg(padding, std::ios::cur);
 }
 
+/**************************************************************************************************/
+// Warns of the object files in a debug map that were modified after the binary was linked, whose
+// debug information may not match the binary any longer. Missing files are not warned of here.
+void warn_modified_object_files(
+    const std::vector<std::pair<std::filesystem::path, std::uint64_t>>& modified_times) {
+    // Every member of an archive is found in the same archive, so each one is only read once.
+    std::unordered_map<std::string, std::unordered_map<std::string, std::uint64_t>> archives;
+
+    for (const auto& [path, linked_time] : modified_times) {
+        std::optional<std::uint64_t> current_time;
+
+        if (auto member = parse_ar_member_path(path)) {
+            auto found = archives.find(member->_archive.string());
+            if (found == archives.end()) {
+                found = archives.emplace(member->_archive.string(),
+                                         ar_member_times(member->_archive)).first;
+            }
+            if (auto time = found->second.find(member->_member); time != found->second.end()) {
+                current_time = time->second;
+            }
+        } else if (struct stat info; stat(path.c_str(), &info) == 0) {
+            current_time = static_cast<std::uint64_t>(info.st_mtime);
+        }
+
+        if (!current_time || *current_time == linked_time) continue;
+
+        cerr_safe([&](auto& s) {
+            s << "warning: " << path.string()
+              << " was modified after it was linked; its debug information may be stale\n";
+        });
+    }
+}
+
 /**************************************************************************************************/
 /*
     This is specifically in relation to the dylib scanning mode, where we're looking at a final
@@ -194,45 +292,54 @@ void macho_reader::read_lc_rpath() {
 */
 void macho_reader::read_stabs(std::uint32_t symbol_count, std::uint32_t string_offset) {
     std::vector<std::filesystem::path> additional_object_files;
+    std::vector<std::pair<std::filesystem::path, std::uint64_t>> modified_times;
+    const bool members_only = settings::instance()._debug_map_members;
 
     while (symbol_count--) {
         std::uint32_t entry_string_offset{0};
+        std::uint64_t modified_time{0};
 
         if (_details._is_64_bit) {
             auto entry = read_pod<nlist_64>(_s);
             if (entry.n_type != N_OSO) continue;
             entry_string_offset = entry.n_un.n_strx;
+            modified_time = entry.n_value;
         } else {
             auto entry = read_pod<struct nlist>(_s);
             if (entry.n_type != N_OSO) continue;
             entry_string_offset = entry.n_un.n_strx;
+            modified_time = entry.n_value;
         }
 
-        // TODO: Comparing the modified file time ensures the object file has not changed
-        // since the application binary was linked. We should compare this time given to
-        // us against the modified time of the file on-disk.
-        // const auto modified_time = entry.n_value;
-
         std::filesystem::path path =
             temp_seek(_s, _details._offset + string_offset + entry_string_offset,
                       [&]() { return _s.read_c_string_view(); });
 
+        // The modified time of the object file, when the application binary was linked. (It is
+        // zero if the linker was asked not to record it.)
+        if (modified_time) modified_times.emplace_back(path, modified_time);
+
         // Some entries have been observed to contain the `.o` file as a parenthetical to the
-        // `.a` file that contains it. e.g., `/path/to/bar.a(foo.o)`. For our purposes we'll
-        // trim off the parenthetical and include the entire `.a` file. Although this could
-        // introduce extra symbols, they are likely to be included by other STAB entries
-        // anyhow.
+        // `.a` file that contains it. e.g., `/path/to/bar.a(foo.o)`. Unless `debug_map_members`
+        // is set, we'll trim off the parenthetical and include the entire `.a` file. Although
+        // this could introduce extra symbols, they are likely to be included by other STAB
+        // entries anyhow.
         //
         // TL;DR: If the filename has an open parentheses in it, remove it and all that
         // comes after it.
-        std::string filename = path.filename().string();
-        if (const auto pos = filename.find('('); pos != std::string::npos) {
-            path = path.parent_path() / filename.substr(0, pos);
+        if (!members_only) {
+            if (auto member = parse_ar_member_path(path)) {
+                path = std::move(member->_archive);
+            }
         }
 
         additional_object_files.push_back(std::move(path));
     }
 
+    if (log_level_at_least(settings::log_level::warning)) {
+        warn_modified_object_files(modified_times);
+    }
+
     _params._register_dependencies(std::move(additional_object_files));
 }
 
@@ -326,7 +433,7 @@ void macho_reader::derive_dependencies() {
     // For executables, `@loader_path` and `@executable_path` mean the same thing.
 
     const std::filesystem::path loader_path =
-        object_file_ancestry(_ofd_index)._ancestors[0].allocate_path().parent_path();
+        object_file_ancestry(_ofd_index).front().allocate_path().parent_path();
 
     std::vector<std::filesystem::path> resolved_dylibs;
     for (const auto& raw_dylib : _unresolved_dylibs) {
@@ -388,7 +495,7 @@ void read_macho(object_ancestry&& ancestry,
                 file_details details,
                 macho_params params) {
     orc::do_work([_ancestry = std::move(ancestry), _s = std::move(s), _details = std::move(details),
-                  _params = std::move(params)]() mutable {
+                  _params = std::move(params), end_pos]() mutable {
         ZoneScopedN("read_macho");
 #if ORC_FEATURE(TRACY)
         std::stringstream ss;
@@ -399,11 +506,37 @@ void read_macho(object_ancestry&& ancestry,
 
         std::uint32_t ofd_index =
             static_cast<std::uint32_t>(object_file_register(std::move(_ancestry), copy(_details)));
+
+        const std::size_t size = static_cast<std::size_t>(end_pos) - _details._offset;
+        const bool use_die_cache =
+            _params._mode == macho_reader_mode::register_dies && orc::die_cache_enabled();
+        orc::die_cache_key cache_key;
+
+        if (use_die_cache) {
+            cache_key = orc::die_cache_key_for(_s, _details._offset, size);
+            if (orc::die_cache_register(cache_key, ofd_index)) {
+                ++globals::instance()._object_file_count;
+                return;
+            }
+        }
+
         macho_reader macho(ofd_index, std::move(_s), std::move(_details), std::move(_params));
 
         if (macho.register_dies_mode()) {
             ++globals::instance()._object_file_count;
-            macho.dwarf().process_all_dies();
+            if (macho.deduplicate(size)) return;
+            const auto start = std::chrono::steady_clock::now();
+            if (use_die_cache) {
+                std::vector<die> registered;
+                const auto counts = macho.dwarf().process_all_dies(&registered);
+                orc::die_cache_store(cache_key, registered, counts._processed, counts._skipped);
+            } else {
+                macho.dwarf().process_all_dies();
+            }
+            // Everything needed from the file is in the string pool and the die map now, so
+            // there's no sense in its pages crowding out those of the files yet to be processed.
+            macho.advise_dwarf_sections(freader::advice::dontneed);
+            orc::stats_object_file(ofd_index, std::chrono::steady_clock::now() - start);
         } else if (macho.derive_dylibs_mode()) {
             macho.derive_dependencies();
         } else {
@@ -417,7 +550,7 @@ void read_macho(object_ancestry&& ancestry,
 
 dwarf dwarf_from_macho(std::uint32_t ofd_index, macho_params params) {
     const auto& entry = object_file_fetch(ofd_index);
-    freader s(entry._ancestry.begin()->allocate_path());
+    freader s(entry._ancestry.front().allocate_path());
 
     s.seekg(entry._details._offset);
 
@@ -429,127 +562,129 @@ dwarf dwarf_from_macho(std::uint32_t ofd_index, macho_params params) {
 namespace {
 
 /**************************************************************************************************/
-// Append `src` to the end of `dst` by destructively moving the items out of `src`.
-// Preconditions:
-//     - `dst` and `src` are not the same container.
-// Postconditions:
-//     - All elements in `src` will be moved-from.
-//     - `src` itself will still be valid, even if the elements within it are not.
-template <typename C>
-void move_append(C& dst, C&& src) {
-    dst.insert(dst.end(), std::move_iterator(src.begin()), std::move_iterator(src.end()));
-}
-
-/**************************************************************************************************/
-
-std::vector<std::filesystem::path> make_sorted_unique(std::vector<std::filesystem::path>&& files) {
-    // eliminate duplicate object files, if any. The discovered order of these things shouldn't
-    // matter for the purposes of additional dylib scans or the ODR scan at the end.
-    std::sort(files.begin(), files.end());
-    auto new_end = std::unique(files.begin(), files.end());
-    files.erase(new_end, files.end());
-    return files;
-}
-
-/**************************************************************************************************/
-// For an incoming `input_path`, this scans just that input and returns any dylibs it depends on.
-// It does not scan those dylibs for additional dependencies. It also does not include `input_path`
-// as one of the returned dependencies.
-std::vector<std::filesystem::path> derive_immediate_dylibs(
-    const std::filesystem::path& executable_path, const std::filesystem::path& input_path) {
-    ZoneScoped;
-
-    // `input_path` is not `loader_path` because it points to the binary to be scanned.
-    // Therefore, `loader_path` should be the directory that contains `input_path`.
-    if (!exists(input_path)) {
-        if (log_level_at_least(settings::log_level::verbose)) {
-            cerr_safe([&](auto& s) {
-                s << "verbose: file " << input_path.string() << " does not exist\n";
+// A walk of the dependency graphs of the root binaries. Each binary is scanned for what it depends
+// upon (the dylibs it loads, and the object files in its debug map) as a work item of its own, and
+// whatever that scan finds is scanned in turn, so the scans of a whole graph overlap one another.
+// Each binary is also handed to `_found` the first time the walk reaches it, and without waiting
+// for the walk to finish, so it can be processed while the rest of the graph is discovered.
+class dylib_walk {
+public:
+    explicit dylib_walk(macho_found_callback found) : _found(std::move(found)) {}
+
+    // Each root binary will be the `executable_path` for its tree of dependencies.
+    void add_root(const std::filesystem::path& binary) {
+        if (log_level_at_least(settings::log_level::info)) {
+            cout_safe([&](auto& s) {
+                s << "info: scanning for dependencies of " << binary.filename() << "\n";
             });
         }
-        return std::vector<std::filesystem::path>();
-    }
 
-#if ORC_FEATURE(TRACY)
-    const auto path_annot = input_path.string();
-    ZoneText(path_annot.c_str(), path_annot.size());
-#endif // ORC_FEATURE(TRACY)
+        visit(binary.parent_path(), binary);
+    }
 
-    TracyLockable(std::mutex, dylib_result_mutex);
-    std::vector<std::filesystem::path> result;
-    freader input(input_path);
-    macho_params params;
-    params._mode = macho_reader_mode::derive_dylibs;
-    params._executable_path = executable_path;
-    params._register_dependencies = [&](std::vector<std::filesystem::path>&& p) {
-        ZoneScopedN("register_dependencies");
-        if (p.empty()) return;
-        std::lock_guard m(dylib_result_mutex);
-        move_append(result, std::move(p));
-    };
-
-    parse_file(input_path.string(), object_ancestry(), input, input.size(), std::move(params));
+    // Only meaningful once the walk is done (see `macho_derive_dylibs`.)
+    std::size_t found_count() const {
+        std::lock_guard m(_mutex);
+        return _found_paths.size();
+    }
 
-    orc::block_on_work();
+    // Every binary reachable from `binary`, itself included. A binary shared with another root is
+    // only scanned once for the two of them when they share an `executable_path`, so this follows
+    // the dependencies the scans recorded rather than whatever a root happened to scan itself.
+    // Only meaningful once the walk is done.
+    std::vector<std::filesystem::path> closure(const std::filesystem::path& binary) const {
+        std::lock_guard m(_mutex);
+        const auto executable_path = binary.parent_path();
+        std::set<std::filesystem::path> reached{binary};
+        std::vector<std::filesystem::path> pending{binary};
+
+        while (!pending.empty()) {
+            const auto found = _dependencies.find(std::make_pair(executable_path, pending.back()));
+            pending.pop_back();
+            if (found == _dependencies.end()) continue;
+
+            for (const auto& dependency : found->second) {
+                if (reached.insert(dependency).second) pending.push_back(dependency);
+            }
+        }
 
-    return make_sorted_unique(std::move(result));
-}
+        return std::vector<std::filesystem::path>(reached.begin(), reached.end());
+    }
 
-/**************************************************************************************************/
+private:
+    void visit(const std::filesystem::path& executable_path, std::filesystem::path binary) {
+        bool first_found{false};
+
+        {
+            std::lock_guard m(_mutex);
+            // A binary's dependencies are found relative to its root's `executable_path`, so a
+            // binary shared by two roots is scanned once from each.
+            if (!_scanned.emplace(executable_path, binary).second) return;
+            first_found = _found_paths.insert(binary).second;
+        }
 
-std::vector<std::filesystem::path> derive_all_dylibs(const std::filesystem::path& binary) {
-    ZoneScoped;
+        if (first_found) _found(binary);
 
-    const auto executable_path = binary.parent_path();
-    std::vector<std::filesystem::path> scanned;
-    std::vector<std::filesystem::path> pass(1, binary);
+        // An archive member from a debug map is an object file, which has no dependencies of its
+        // own to scan for.
+        if (parse_ar_member_path(binary)) return;
 
-    if (log_level_at_least(settings::log_level::info)) {
-        cout_safe([&](auto& s) {
-            s << "info: scanning for dependencies of " << binary.filename() << "\n";
+        orc::do_work([this, executable_path, _binary = std::move(binary)] {
+            scan(executable_path, _binary);
         });
     }
 
-    while (true) {
-        std::vector<std::filesystem::path> pass_dependencies;
+    void scan(const std::filesystem::path& executable_path, const std::filesystem::path& input_path) {
+        ZoneScoped;
 
-        for (const auto& dependency : pass) {
-            move_append(pass_dependencies, derive_immediate_dylibs(executable_path, dependency));
+        // `input_path` is not `loader_path` because it points to the binary to be scanned.
+        // Therefore, `loader_path` should be the directory that contains `input_path`.
+        if (!exists(input_path)) {
+            if (log_level_at_least(settings::log_level::verbose)) {
+                cerr_safe([&](auto& s) {
+                    s << "verbose: file " << input_path.string() << " does not exist\n";
+                });
+            }
+            return;
         }
 
-        // The set of binaries scanned in this pass get appended to `scanned`
-        move_append(scanned, std::move(pass));
-        scanned = make_sorted_unique(std::move(scanned));
-
-        // clean up the set of dependencies found in this pass.
-        pass_dependencies = make_sorted_unique(std::move(pass_dependencies));
-
-        // for the _next_ pass, we only want to scan files that are new,
-        // those that are in `pass_dependencies` and _not_ in `scanned`.
-        // If that set of files is empty, then we have found all our
-        // dependencies, and can stop.
-        pass = std::vector<std::filesystem::path>(); // ensure `pass` is valid and empty.
-        std::set_difference(pass_dependencies.begin(), pass_dependencies.end(),
-                            scanned.begin(), scanned.end(), std::back_inserter(pass));
-
-        if (pass.empty()) {
-            break;
-        }
+#if ORC_FEATURE(TRACY)
+        const auto path_annot = input_path.string();
+        ZoneText(path_annot.c_str(), path_annot.size());
+#endif // ORC_FEATURE(TRACY)
 
-        if (log_level_at_least(settings::log_level::info)) {
-            cout_safe([&](auto& s) {
-                s << "info: scanning " << pass.size() << " more dependencies...\n";
-            });
-        }
-    }
+        freader input(input_path);
+        macho_params params;
+        params._mode = macho_reader_mode::derive_dylibs;
+        params._executable_path = executable_path;
+        // The reader may call this after `scan` has returned, so it holds its own copy of the path.
+        params._register_dependencies = [this, executable_path, input_path](
+                                            std::vector<std::filesystem::path>&& p) {
+            ZoneScopedN("register_dependencies");
+            {
+                std::lock_guard m(_mutex);
+                auto& dependencies = _dependencies[std::make_pair(executable_path, input_path)];
+                dependencies.insert(dependencies.end(), p.begin(), p.end());
+            }
+            for (auto& dependency : p) {
+                visit(executable_path, std::move(dependency));
+            }
+            // The last binary to report its dependencies marks the end of the scan.
+            orc::stats_phase_end(orc::stats_phase::dylib_scan);
+        };
 
-    if (log_level_at_least(settings::log_level::info)) {
-        cout_safe(
-            [&](auto& s) { s << "info: found " << scanned.size() << " total dependencies\n"; });
+        parse_file(input_path.string(), object_ancestry(), input, input.size(), std::move(params));
     }
 
-    return scanned;
-}
+    const macho_found_callback _found;
+    mutable std::mutex _mutex;
+    std::set<std::pair<std::filesystem::path, std::filesystem::path>> _scanned; // root, binary
+    std::set<std::filesystem::path> _found_paths;
+    // root, binary -> what the binary depends upon
+    std::map<std::pair<std::filesystem::path, std::filesystem::path>,
+             std::vector<std::filesystem::path>>
+        _dependencies;
+};
 
 /**************************************************************************************************/
 
@@ -557,22 +692,41 @@ std::vector<std::filesystem::path> derive_all_dylibs(const std::filesystem::path
 
 /**************************************************************************************************/
 
-std::vector<std::filesystem::path> macho_derive_dylibs(
-    const std::vector<std::filesystem::path>& binaries) {
-    std::vector<std::filesystem::path> result;
+std::vector<std::vector<std::filesystem::path>> macho_derive_dylibs(
+    const std::vector<std::filesystem::path>& binaries, macho_found_callback found) {
+    ZoneScoped;
 
     // For the purpose of the executable_path/loader_path relationships, we treat each binary
     // as independent of the others. That is, each root binary will be the `executable_path` for
     // its tree of dependencies.
     //
-    // Then, yes, we smash them all together and treat them as one large binary with all its
-    // dependencies. Otherwise we'd have to add a way to conduct multiple ORC scans per session,
-    // which the app is not set up to do. We did warn the user we would do this, though.
+    // Every binary found is handed to `found` once, however many roots depend on it. Unless the
+    // roots are reviewed one closure at a time (see the `dylib_scan_sessions` setting), they are
+    // then treated as one large binary with all its dependencies. We did warn the user we would
+    // do this, though.
+    dylib_walk walk(std::move(found));
+
+    orc::stats_phase_begin(orc::stats_phase::dylib_scan);
+
     for (const auto& binary : binaries) {
-        move_append(result, derive_all_dylibs(binary));
+        walk.add_root(binary);
+    }
+
+    // This waits on the scans, and on any work `found` started, too.
+    orc::block_on_work();
+
+    if (log_level_at_least(settings::log_level::info)) {
+        cout_safe([&](auto& s) {
+            s << "info: found " << walk.found_count() << " total dependencies\n";
+        });
     }
 
-    return make_sorted_unique(std::move(result));
+    std::vector<std::vector<std::filesystem::path>> result;
+    result.reserve(binaries.size());
+    for (const auto& binary : binaries) {
+        result.push_back(walk.closure(binary));
+    }
+    return result;
 }
 
 /**************************************************************************************************/
@@ -7,6 +7,7 @@
 // stdc++
 #include <array>
 #include <csignal>
+#include <cstring>
 #include <cxxabi.h>
 #include <filesystem>
 #include <fstream>
@@ -14,9 +15,16 @@
 #include <mutex>
 #include <numeric>
 #include <set>
+#include <sstream>
 #include <thread>
 #include <unordered_map>
 
+// system
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
 // stlab
 #include <stlab/concurrency/default_executor.hpp>
 #include <stlab/concurrency/future.hpp>
@@ -30,10 +38,15 @@
 #include <tbb/concurrent_unordered_map.h>
 
 // application
+#include "orc/async.hpp"
+#include "orc/daemon.hpp"
 #include "orc/features.hpp"
+#include "orc/object_file_registry.hpp"
 #include "orc/orc.hpp"
 #include "orc/parse_file.hpp"
+#include "orc/progress.hpp"
 #include "orc/settings.hpp"
+#include "orc/stats.hpp"
 #include "orc/str.hpp"
 #include "orc/string_pool.hpp"
 #include "orc/task_system.hpp"
@@ -42,6 +55,10 @@
 
 /**************************************************************************************************/
 
+extern char** environ; // the forwarded linker gets ORC's environment
+
+/**************************************************************************************************/
+
 namespace {
 
 /**************************************************************************************************/
@@ -167,13 +184,27 @@ void process_orc_configuration(const char* bin_path_string) {
 
     app_settings._graceful_exit = derive_configuration("graceful_exit", settings, false);
     app_settings._max_violation_count = derive_configuration("max_error_count", settings, std::size_t(0));
+    app_settings._max_open_files = derive_configuration("max_open_files", settings, std::size_t(256));
+    app_settings._hash_partitions = derive_configuration("hash_partitions", settings, std::size_t(1));
     app_settings._forward_to_linker = derive_configuration("forward_to_linker", settings, true);
     app_settings._standalone_mode = derive_configuration("standalone_mode", settings, false);
     app_settings._dylib_scan_mode = derive_configuration("dylib_scan_mode", settings, false);
+    app_settings._debug_map_members = derive_configuration("debug_map_members", settings, false);
+    app_settings._dylib_scan_sessions = derive_configuration("dylib_scan_sessions", settings, false);
     app_settings._parallel_processing = derive_configuration("parallel_processing", settings, true);
+    app_settings._worker_count = derive_configuration("worker_count", settings, std::size_t(0));
+    app_settings._pin_workers = derive_configuration("pin_workers", settings, false);
     app_settings._filter_redundant = derive_configuration("filter_redundant", settings, true);
+    app_settings._skip_subtrees = derive_configuration("skip_subtrees", settings, true);
+    app_settings._accelerated_scan = derive_configuration("accelerated_scan", settings, false);
     app_settings._print_object_file_list = derive_configuration("print_object_file_list", settings, false);
     app_settings._relative_output_file = derive_configuration("relative_output_file", settings, std::string());
+    app_settings._die_cache_file = derive_configuration("die_cache_file", settings, std::string());
+    app_settings._daemon_socket = derive_configuration("daemon_socket", settings, std::string());
+    app_settings._daemon_cache_mb = derive_configuration("daemon_cache_mb", settings, std::size_t(4096));
+    app_settings._stats_file = derive_configuration("stats_file", settings, std::string());
+    app_settings._progress_interval = derive_configuration("progress_interval", settings, std::size_t(0));
+    app_settings._progress_file = derive_configuration("progress_file", settings, std::string());
 
     const std::string log_level = derive_configuration("log_level", settings, std::string("warning"));
     const std::string output_file = derive_configuration("output_file", settings, std::string());
@@ -233,8 +264,10 @@ void process_orc_configuration(const char* bin_path_string) {
     };
 
     app_settings._symbol_ignore = read_string_list("symbol_ignore");
+    app_settings._architectures = read_string_list("architectures");
     app_settings._violation_report = read_string_list("violation_report");
     app_settings._violation_ignore = read_string_list("violation_ignore");
+    app_settings._prebuilt_die_caches = read_string_list("prebuilt_die_caches");
 
     if (!app_settings._violation_report.empty() &&
         !app_settings._violation_ignore.empty()) {
@@ -319,8 +352,10 @@ bool direct_input_file(const std::string_view& p) {
 } // namespace
 
 /**************************************************************************************************/
-
-cmdline_results process_command_line(int argc, char** argv) {
+// If `open_output` is false, the output file named by the arguments (see `relative_output_file`)
+// is left alone: the daemon processes a client's link with this, as the client already has that
+// file open, and is writing to it.
+cmdline_results process_command_line(int argc, char** argv, bool open_output = true) {
     cmdline_results result;
 
     if (log_level_at_least(settings::log_level::verbose)) {
@@ -338,6 +373,7 @@ cmdline_results process_command_line(int argc, char** argv) {
         }
 
         if (settings::instance()._dylib_scan_mode &&
+            !settings::instance()._dylib_scan_sessions &&
             result._file_object_list.size() != 1 &&
             log_level_at_least(settings::log_level::warning)) {
             cout_safe([&](auto& s) {
@@ -356,7 +392,7 @@ cmdline_results process_command_line(int argc, char** argv) {
             if (arg == "-o" || arg == "--output") {
                 std::string filename(argv[++i]);
 
-                if (!settings::instance()._relative_output_file.empty()) {
+                if (open_output && !settings::instance()._relative_output_file.empty()) {
                     open_output_file(filename, settings::instance()._relative_output_file);
                 }
 
@@ -447,6 +483,47 @@ cmdline_results process_command_line(int argc, char** argv) {
 
 /**************************************************************************************************/
 
+// The largest value of a histogram bucket (see `stats_histogram`.)
+std::size_t bucket_limit(std::size_t i) { return (std::size_t(2) << i) - 1; }
+
+void print_histogram(std::ostream& s, const orc::stats_histogram& histogram) {
+    for (std::size_t i = 0; i != histogram.size(); ++i) {
+        if (!histogram[i]) continue;
+        const std::size_t first = i ? std::size_t(1) << i : 0;
+        s << "    " << first << "-" << bucket_limit(i) << ": " << histogram[i] << '\n';
+    }
+}
+
+// The die counts (see `stats_die_counts`), which are in the synopsis of JSON output, too.
+void print_die_counts() {
+    const auto counts = orc::stats_die_counts_sum();
+
+    cout_safe([&](auto& s) {
+        s << "  dies skipped, by reason:\n";
+        for (std::size_t i = 0; i != counts._skipped_by_reason.size(); ++i) {
+            s << "    " << to_string(static_cast<orc::skip_reason>(i)) << ": "
+              << counts._skipped_by_reason[i] << '\n';
+        }
+
+        s << "  dies registered / skipped, by tag:\n";
+        for (std::size_t i = 0; i != orc::stats_die_counts::tag_count_k; ++i) {
+            const auto registered = counts._registered_by_tag[i];
+            const auto skipped = counts._skipped_by_tag[i];
+            if (!registered && !skipped) continue;
+            const bool other = i == orc::stats_die_counts::tag_count_k - 1;
+            s << "    " << (other ? "other" : to_string(static_cast<dw::tag>(i))) << ": "
+              << registered << " / " << skipped << '\n';
+        }
+
+        s << "  die list lengths:\n";
+        print_histogram(s, counts._die_list_lengths);
+        s << "  dies per object file:\n";
+        print_histogram(s, counts._object_file_dies);
+    });
+}
+
+/**************************************************************************************************/
+
 auto epilogue(bool exception) {
     const auto& g = globals::instance();
 
@@ -475,6 +552,10 @@ auto epilogue(bool exception) {
               << format_pct(g._die_skipped_count, g._die_processed_count) << ")\n"
               << "  " << g._unique_symbol_count << " unique symbols\n";
         });
+
+        if (log_level_at_least(settings::log_level::info)) {
+            print_die_counts();
+        }
     }
 
     if (exception) {
@@ -495,8 +576,135 @@ auto interrupt_callback_handler(int signum) {
 
 /**************************************************************************************************/
 
-void maybe_forward_to_linker(int argc, char** argv, const cmdline_results& cmdline) {
-    if (!settings::instance()._forward_to_linker) return;
+// The linker ORC forwards to, run as a child process alongside the ORC scan. The linker's output is
+// streamed as it is written, a line at a time, so it doesn't interleave with ORC's mid-line. If the
+// linker fails, ORC processing is cancelled: there's no use in scanning the inputs of a failed link.
+class forwarded_linker {
+public:
+    forwarded_linker(const std::filesystem::path& executable_path,
+                     std::vector<std::string>&& arguments) {
+        int out[2];
+        int err[2];
+
+        if (pipe(out) != 0 || pipe(err) != 0) {
+            throw std::runtime_error("Could not forward to linker: pipe() failed");
+        }
+
+        // The child only keeps the ends it has `dup2`ed onto its stdout and stderr.
+        for (int fd : {out[0], out[1], err[0], err[1]}) {
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, out[1], STDOUT_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, err[1], STDERR_FILENO);
+
+        std::vector<char*> argv;
+        for (auto& argument : arguments) {
+            argv.push_back(argument.data());
+        }
+        argv.push_back(nullptr);
+
+        const int spawned = posix_spawn(&_pid, executable_path.c_str(), &actions, nullptr,
+                                        argv.data(), environ);
+
+        posix_spawn_file_actions_destroy(&actions);
+        close(out[1]);
+        close(err[1]);
+
+        if (spawned != 0) {
+            close(out[0]);
+            close(err[0]);
+            throw std::runtime_error("Could not forward to linker: " + executable_path.string() +
+                                     " (" + std::strerror(spawned) + ")");
+        }
+
+        _stdout_thread = std::thread([fd = out[0]] {
+            stream_lines(fd, [](const std::string& line) { cout_safe([&](auto& s) { s << line; }); });
+        });
+        _stderr_thread = std::thread([fd = err[0]] {
+            stream_lines(fd, [](const std::string& line) { cerr_safe([&](auto& s) { s << line; }); });
+        });
+        _wait_thread = std::thread([this] { wait(); });
+    }
+
+    ~forwarded_linker() { (void)join(); }
+
+    // Waits for the linker, and returns its exit code.
+    int join() {
+        for (auto* thread : {&_wait_thread, &_stdout_thread, &_stderr_thread}) {
+            if (thread->joinable()) thread->join();
+        }
+
+        return _exit_code;
+    }
+
+private:
+    template <class F>
+    static void stream_lines(int fd, F emit) {
+        std::array<char, 4096> buffer;
+        std::string line;
+
+        while (true) {
+            const ssize_t n = read(fd, buffer.data(), buffer.size());
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+
+            for (ssize_t i = 0; i != n; ++i) {
+                line += buffer[i];
+                if (buffer[i] != '\n') continue;
+                emit(line);
+                line.clear();
+            }
+        }
+
+        if (!line.empty()) emit(line);
+
+        close(fd);
+    }
+
+    void wait() {
+        int status{0};
+
+        while (waitpid(_pid, &status, 0) < 0) {
+            if (errno != EINTR) {
+                _exit_code = EXIT_FAILURE;
+                globals::instance()._cancelled = true;
+                return;
+            }
+        }
+
+        if (WIFEXITED(status)) {
+            _exit_code = WEXITSTATUS(status);
+        } else {
+            _exit_code = WIFSIGNALED(status) ? 128 + WTERMSIG(status) : EXIT_FAILURE;
+        }
+
+        if (_exit_code == 0) return;
+
+        globals::instance()._cancelled = true;
+
+        if (log_level_at_least(settings::log_level::verbose)) {
+            cout_safe([&](auto& s) {
+                s << "verbose: linker failed (" << _exit_code << "); ORC processing cancelled\n";
+            });
+        }
+    }
+
+    pid_t _pid{0};
+    int _exit_code{0};
+    std::thread _stdout_thread;
+    std::thread _stderr_thread;
+    std::thread _wait_thread;
+};
+
+/**************************************************************************************************/
+// Starts the linker, if ORC is to forward to one, which runs while ORC processes the link.
+std::unique_ptr<forwarded_linker> maybe_forward_to_linker(int argc,
+                                                          char** argv,
+                                                          const cmdline_results& cmdline) {
+    if (!settings::instance()._forward_to_linker) return nullptr;
 
     std::filesystem::path executable_path =
         rstrip(exec("xcode-select -p")) + "/Toolchains/XcodeDefault.xctoolchain/usr/bin/";
@@ -522,7 +730,7 @@ void maybe_forward_to_linker(int argc, char** argv, const cmdline_results& cmdli
             });
         }
 
-        return;
+        return nullptr;
     }
 
     if (!exists(executable_path)) {
@@ -532,88 +740,230 @@ void maybe_forward_to_linker(int argc, char** argv, const cmdline_results& cmdli
             [&](auto& s) { s << "verbose: forwarding to " + executable_path.string() + "\n"; });
     }
 
-    std::string arguments = executable_path.string();
+    // The arguments go to the linker as they are, so (unlike through a shell) the ones with spaces
+    // in them need no escaping.
+    std::vector<std::string> arguments(1, executable_path.string());
     for (std::size_t i{1}; i < argc; ++i) {
-        // Gotta re-add the escape characters into our params that have spaces in them.
-        arguments += std::string(" ") + join(split(argv[i], " "), "\\ ");
+        arguments.emplace_back(argv[i]);
     }
 
-    // REVISIT: (fbrereto) We may need to capture/forward stderr here as well.
-    // Also, if the execution of the linker ended in a failure, we need to bubble
-    // that up immediately, and preempt ORC processing.
-    cout_safe([&](auto& s) { s << exec(arguments.c_str()); });
+    return std::make_unique<forwarded_linker>(executable_path, std::move(arguments));
 }
 
 /**************************************************************************************************/
 
-} // namespace
+// Reports are formatted a wave at a time, each one by a worker of its own, as formatting one
+// (demangling its symbol, and looking up the ancestries of its object files) is much more work than
+// writing it. The wave is then written with one locked write, in the order of the reports.
+void print_reports(const std::vector<odrv_report>& reports) {
+    const std::size_t wave_size = orc::queue_size() * 16;
+    std::vector<std::string> formatted;
+
+    for (std::size_t first = 0; first < reports.size(); first += wave_size) {
+        const std::size_t last = std::min(reports.size(), first + wave_size);
+        formatted.assign(last - first, std::string());
+
+        for (std::size_t i = first; i != last; ++i) {
+            orc::do_work([&, i] {
+                std::stringstream ss;
+                ss << reports[i]; // important to NOT add the '\n', because lots of reports are
+                                  // empty, and it creates a lot of blank lines
+                formatted[i - first] = std::move(ss).str();
+            });
+        }
 
-/**************************************************************************************************/
+        orc::block_on_work();
 
-int main(int argc, char** argv) try {
-    orc::profiler::initialize();
+        std::string wave;
+        for (const auto& report : formatted) {
+            wave += report;
+        }
 
-    signal(SIGINT, interrupt_callback_handler);
+        cout_safe([&](auto& s) { s << wave; });
+    }
+}
 
-    process_orc_configuration(argv[0]);
+/**************************************************************************************************/
+// Emits the reports (which are already filtered, and cut off at the limit) and the synopsis.
+int report_violations(std::vector<odrv_report>&& violations, std::ostream* json_out) {
+    const auto& settings = settings::instance();
+    auto& globals = globals::instance();
+    const auto max_odrv_count = settings._max_violation_count;
+    const bool json_mode = settings._output_file_mode == settings::output_file_mode::json;
 
-    cmdline_results cmdline = process_command_line(argc, argv);
+    globals._odrv_count = violations.size();
 
-    if (settings::instance()._print_object_file_list) {
-        for (const auto& input_path : cmdline._file_object_list) {
-            cout_safe([&](auto& s) { s << input_path.string() << '\n'; });
+    if (max_odrv_count > 0 && globals._odrv_count >= max_odrv_count) {
+        if (log_level_at_least(settings::log_level::warning)) {
+            cout_safe([&](auto& s) { s << "warning: ODRV limit reached\n"; });
         }
+    }
 
-        return EXIT_SUCCESS;
+    {
+        orc::stats_phase_scope output_phase(orc::stats_phase::output);
+
+        if (json_mode && json_out) {
+            orc::to_json(*json_out, violations);
+        }
+
+        print_reports(violations);
     }
 
-    maybe_forward_to_linker(argc, argv, cmdline);
+    orc::stats_write();
 
+    return epilogue(false);
+}
+
+/**************************************************************************************************/
+
+int process_and_report(cmdline_results&& cmdline, std::ostream* json_out) {
     if (cmdline._file_object_list.empty()) {
         return epilogue(false);
     }
 
-    std::vector<odrv_report> reports = orc_process(std::move(cmdline._file_object_list));
     std::vector<odrv_report> violations;
-    std::vector<std::string> filtered_categories;
-    const auto& settings = settings::instance();
+
+    {
+        orc::progress_reporter progress(cmdline._file_object_list);
+        violations = orc_process(std::move(cmdline._file_object_list));
+    }
+
+    // The forwarded linker failed, and its exit code is the one that matters (see `main`.)
+    if (globals::instance()._cancelled) return EXIT_FAILURE;
+
+    return report_violations(std::move(violations), json_out);
+}
+
+/**************************************************************************************************/
+// `orc --emit-index <index> <arguments...>` registers the dies of the inputs named by the
+// arguments (read as they always are, but never forwarded to the linker) and writes them to a die
+// index. `orc --merge <index...>` reviews the dies of the indices, and reports on them as if it
+// had scanned their inputs itself. See die_index.hpp.
+int emit_index(int argc, char** argv) {
+    std::vector<char*> arguments(1, argv[0]);
+    arguments.insert(arguments.end(), argv + 3, argv + argc);
+
+    cmdline_results cmdline =
+        process_command_line(static_cast<int>(arguments.size()), arguments.data());
+
+    {
+        orc::progress_reporter progress(cmdline._file_object_list);
+        orc_emit_index(std::move(cmdline._file_object_list), argv[2]);
+    }
+
+    orc::stats_write();
+
+    return EXIT_SUCCESS;
+}
+
+int merge_indices(int argc, char** argv) {
+    const std::vector<std::filesystem::path> index_paths(argv + 2, argv + argc);
+    auto& output_file = globals::instance()._fp;
+    return report_violations(orc_merge(index_paths),
+                             output_file.is_open() ? &output_file : nullptr);
+}
+
+/**************************************************************************************************/
+// Each link the daemon processes starts from a clean slate, save for what it keeps on purpose
+// (see daemon.hpp). Each link registers its object files anew, so the last link's are forgotten;
+// the dies the daemon keeps are given the new indices as they are used (see `die_cache.hpp`.)
+orc::daemon_result process_daemon_link(std::vector<std::string>&& args) {
+    orc_reset();
+    object_file_registry_clear();
+
     auto& globals = globals::instance();
-    const auto max_odrv_count = settings._max_violation_count;
-    const bool json_mode = settings._output_file_mode == settings::output_file_mode::json;
+    globals._object_file_count = 0;
+    globals._odrv_count = 0;
+    globals._unique_symbol_count = 0;
+    globals._die_processed_count = 0;
+    globals._die_skipped_count = 0;
+    globals._cancelled = false;
+    orc::stats_die_counts_reset();
+    orc::stats_reset();
+
+    std::vector<char*> argv;
+    for (auto& arg : args) {
+        argv.push_back(arg.data());
+    }
 
-    for (const auto& report : reports) {
-        if (!emit_report(report)) {
-            filtered_categories.push_back(report.filtered_categories());
-            continue;
-        }
+    orc::daemon_result result;
+    std::ostringstream json_report;
+
+    try {
+        // The client writes the output file.
+        cmdline_results cmdline =
+            process_command_line(static_cast<int>(argv.size()), argv.data(), false);
+        result._exit_code = process_and_report(std::move(cmdline), &json_report);
+    } catch (const std::exception& error) {
+        cerr_safe([&](auto& s) { s << "Fatal error: " << error.what() << '\n'; });
+        result._exit_code = epilogue(true);
+    } catch (...) {
+        cerr_safe([&](auto& s) { s << "Fatal error: unknown\n"; });
+        result._exit_code = epilogue(true);
+    }
 
-        violations.push_back(report);
+    result._json_report = json_report.str();
+
+    return result;
+}
 
-        // Administrivia
-        ++globals._odrv_count;
+/**************************************************************************************************/
 
-        if (max_odrv_count > 0 && globals._odrv_count >= max_odrv_count) {
-            if (log_level_at_least(settings::log_level::warning)) {
-                cout_safe([&](auto& s) { s << "warning: ODRV limit reached\n"; });
-            }
-            break;
+} // namespace
+
+/**************************************************************************************************/
+
+int main(int argc, char** argv) try {
+    orc::profiler::initialize();
+
+    signal(SIGINT, interrupt_callback_handler);
+
+    process_orc_configuration(argv[0]);
+
+    if (argc == 2 && std::string_view(argv[1]) == "--daemon") {
+        const auto& socket_path = settings::instance()._daemon_socket;
+        if (socket_path.empty()) {
+            throw std::runtime_error("`--daemon` requires the `daemon_socket` setting");
         }
+        orc::daemon_serve(socket_path, process_daemon_link);
     }
 
-    assert(globals._odrv_count == violations.size());
+    if (argc > 2 && std::string_view(argv[1]) == "--emit-index") {
+        return emit_index(argc, argv);
+    }
 
-    if (json_mode && globals._fp.is_open()) {
-        globals._fp << orc::to_json(violations);
+    if (argc > 2 && std::string_view(argv[1]) == "--merge") {
+        return merge_indices(argc, argv);
     }
 
-    for (const auto& report : violations) {
-        cout_safe([&](auto& s) {
-            s << report; // important to NOT add the '\n', because lots of reports are empty, and it
-                         // creates a lot of blank lines
-        });
+    cmdline_results cmdline = process_command_line(argc, argv);
+
+    if (settings::instance()._print_object_file_list) {
+        for (const auto& input_path : cmdline._file_object_list) {
+            cout_safe([&](auto& s) { s << input_path.string() << '\n'; });
+        }
+
+        return EXIT_SUCCESS;
     }
 
-    return epilogue(false);
+    // The linker and ORC read the same inputs, but neither needs the other, so they run at the
+    // same time. A failed link is reported by the linker's exit code, whatever ORC found.
+    auto linker = maybe_forward_to_linker(argc, argv, cmdline);
+    const auto joined = [&](int result) {
+        if (!linker) return result;
+        const int linker_result = linker->join();
+        return linker_result != 0 ? linker_result : result;
+    };
+
+    if (!settings::instance()._daemon_socket.empty() && !cmdline._file_object_list.empty()) {
+        if (auto result = orc::daemon_request(settings::instance()._daemon_socket, argc, argv)) {
+            return joined(*result);
+        }
+    }
+
+    auto& output_file = globals::instance()._fp;
+    return joined(
+        process_and_report(std::move(cmdline), output_file.is_open() ? &output_file : nullptr));
 } catch (const std::exception& error) {
     cerr_safe([&](auto& s) { s << "Fatal error: " << error.what() << '\n'; });
     return epilogue(true);
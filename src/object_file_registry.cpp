@@ -7,6 +7,16 @@
 // identity
 #include "orc/object_file_registry.hpp"
 
+// stdc++
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
 // tbb
 #include <tbb/concurrent_vector.h>
 
@@ -23,6 +33,42 @@ tbb::concurrent_vector<object_file_descriptor>& obj_registry() {
 
 /**************************************************************************************************/
 
+struct content_key {
+    std::uint64_t _fingerprint{0};
+    std::uint64_t _size{0};
+
+    friend bool operator==(const content_key& x, const content_key& y) {
+        return x._fingerprint == y._fingerprint && x._size == y._size;
+    }
+};
+
+struct content_key_hash {
+    std::size_t operator()(const content_key& x) const { return x._fingerprint ^ x._size; }
+};
+
+struct alias_registry {
+    std::mutex _mutex;
+    std::unordered_map<content_key, std::size_t, content_key_hash> _first; // contents -> index
+    std::unordered_map<std::size_t, std::vector<std::size_t>> _aliases;
+};
+
+alias_registry& aliases() {
+    static alias_registry result;
+    return result;
+}
+
+tbb::concurrent_vector<std::size_t>& units() {
+    static tbb::concurrent_vector<std::size_t> result;
+    return result;
+}
+
+std::vector<std::uint32_t>& ranks() {
+    static std::vector<std::uint32_t> result;
+    return result;
+}
+
+/**************************************************************************************************/
+
 } // namespace
 
 /**************************************************************************************************/
@@ -39,4 +85,96 @@ std::size_t object_file_register(object_ancestry&& ancestry, file_details&& deta
 
 const object_file_descriptor& object_file_fetch(std::size_t index) { return obj_registry()[index]; }
 
+std::size_t object_file_count() { return obj_registry().size(); }
+
+/**************************************************************************************************/
+
+void object_file_rank_by_ancestry() {
+    const auto& registry = obj_registry();
+    std::vector<std::uint32_t> order(registry.size());
+    std::iota(order.begin(), order.end(), 0);
+
+    std::sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) {
+        return registry[a]._ancestry < registry[b]._ancestry;
+    });
+
+    std::vector<std::uint32_t> result(order.size());
+    std::uint32_t rank{0};
+
+    for (std::size_t i = 0; i != order.size(); ++i) {
+        if (i && registry[order[i - 1]]._ancestry < registry[order[i]]._ancestry) ++rank;
+        result[order[i]] = rank;
+    }
+
+    ranks() = std::move(result);
+}
+
+std::uint32_t object_file_rank(std::size_t index) {
+    assert(index < ranks().size());
+    return ranks()[index];
+}
+
+/**************************************************************************************************/
+
+std::size_t object_file_deduplicate(std::uint64_t fingerprint,
+                                    std::uint64_t size,
+                                    std::size_t index) {
+    auto& registry = aliases();
+    std::lock_guard<std::mutex> lock(registry._mutex);
+    const auto [found, inserted] = registry._first.emplace(content_key{fingerprint, size}, index);
+    if (!inserted) registry._aliases[found->second].push_back(index);
+    return found->second;
+}
+
+/**************************************************************************************************/
+
+std::vector<std::size_t> object_file_aliases(std::size_t index) {
+    auto& registry = aliases();
+    std::lock_guard<std::mutex> lock(registry._mutex);
+    const auto found = registry._aliases.find(index);
+    return found == registry._aliases.end() ? std::vector<std::size_t>() : found->second;
+}
+
+/**************************************************************************************************/
+
+void object_file_add_alias(std::size_t index, std::size_t alias) {
+    auto& registry = aliases();
+    std::lock_guard<std::mutex> lock(registry._mutex);
+    registry._aliases[index].push_back(alias);
+}
+
+/**************************************************************************************************/
+
+std::uint32_t object_file_unit_register(std::size_t cu_header_offset) {
+    const auto index = static_cast<std::size_t>(
+        std::distance(units().begin(), units().push_back(cu_header_offset)));
+    if (index > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::runtime_error("too many compilation units");
+    }
+    return static_cast<std::uint32_t>(index);
+}
+
+std::size_t object_file_unit_offset(std::uint32_t index) {
+    assert(index < units().size());
+    return units()[index];
+}
+
+/**************************************************************************************************/
+
+void object_file_forget_contents() {
+    auto& registry = aliases();
+    std::lock_guard<std::mutex> lock(registry._mutex);
+    registry._first.clear();
+    registry._aliases.clear();
+    units().clear();
+}
+
+/**************************************************************************************************/
+
+void object_file_registry_clear() {
+    object_file_forget_contents();
+    ranks().clear();
+    obj_registry().clear();
+}
+
 /**************************************************************************************************/
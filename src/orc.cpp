@@ -9,14 +9,19 @@
 
 // stdc++
 #include <array>
+#include <atomic>
+#include <bit>
 #include <cxxabi.h>
+#include <deque>
 #include <filesystem>
 #include <fstream>
 #include <functional>
 #include <list>
 #include <mutex>
+#include <optional>
 #include <set>
 #include <thread>
+#include <tuple>
 #include <unordered_map>
 
 // stlab
@@ -33,9 +38,13 @@
 
 // tbb
 #include <tbb/concurrent_unordered_map.h>
+#include <tbb/spin_rw_mutex.h>
 
 // application
+#include "orc/ar.hpp"
 #include "orc/async.hpp"
+#include "orc/die_cache.hpp"
+#include "orc/die_index.hpp"
 #include "orc/dwarf.hpp"
 #include "orc/features.hpp"
 #include "orc/macho.hpp"
@@ -43,6 +52,7 @@
 #include "orc/object_file_registry.hpp"
 #include "orc/parse_file.hpp"
 #include "orc/settings.hpp"
+#include "orc/stats.hpp"
 #include "orc/str.hpp"
 #include "orc/string_pool.hpp"
 #include "orc/tracy.hpp"
@@ -82,42 +92,92 @@ bool attributes_conflict(dw::at name, const attribute& x, const attribute& y) {
     return x != y;
 }
 
-std::vector<dw::at> fatal_attribute_names(const attribute_sequence& x) {
-    std::vector<dw::at> result;
-    for (const auto& entry : x) {
-        if (nonfatal_attribute(entry._name)) continue;
-        result.push_back(entry._name);
+/**************************************************************************************************/
+// The fatal attributes of a sequence, by name. Every standard attribute name is below `direct_k`,
+// so those names are kept in a bitset, with the position of each attribute in the sequence kept
+// in a table indexed by name. The rest (vendor extensions, and there are only ever a few of them)
+// are kept in a short sorted list. Two of these are compared a word at a time, and only the
+// values of the names they share are compared.
+struct fatal_attribute_set {
+    static constexpr std::size_t direct_k{0x100};
+    static constexpr std::size_t word_bits_k{64};
+    using words = std::array<std::uint64_t, direct_k / word_bits_k>;
+
+    explicit fatal_attribute_set(const attribute_sequence& attributes) : _attributes(attributes) {
+        for (std::size_t i = 0; i != attributes.size(); ++i) {
+            const dw::at name = attributes.begin()[i]._name;
+            if (nonfatal_attribute(name)) continue;
+
+            const auto n = static_cast<std::size_t>(name);
+            if (n < direct_k) {
+                _names[n / word_bits_k] |= std::uint64_t(1) << (n % word_bits_k);
+                _index[n] = static_cast<std::uint16_t>(i);
+            } else {
+                _extended.emplace_back(name, i);
+            }
+        }
+
+        std::sort(_extended.begin(), _extended.end());
     }
-    std::sort(result.begin(), result.end());
-    return result;
-}
 
-std::vector<dw::at> find_attribute_conflict(const attribute_sequence& x,
-                                            const attribute_sequence& y) {
-    const auto x_names = fatal_attribute_names(x);
-    const auto y_names = fatal_attribute_names(y);
+    const attribute& direct(std::size_t n) const { return _attributes.begin()[_index[n]]; }
 
-    std::vector<dw::at> result;
-    std::vector<dw::at> intersection;
+    const attribute_sequence& _attributes;
+    words _names{0};
+    std::array<std::uint16_t, direct_k> _index; // only valid for the names in `_names`
+    std::vector<std::pair<dw::at, std::size_t>> _extended;
+};
+
+// Calls `f` with the name of every bit set in `bits`.
+template <class F>
+void for_each_name(const fatal_attribute_set::words& bits, F&& f) {
+    for (std::size_t w = 0; w != bits.size(); ++w) {
+        for (std::uint64_t word = bits[w]; word; word &= word - 1) {
+            f(w * fatal_attribute_set::word_bits_k + std::countr_zero(word));
+        }
+    }
+}
 
-    std::set_symmetric_difference(x_names.begin(), x_names.end(), y_names.begin(), y_names.end(),
-                                  std::back_inserter(result));
+std::vector<dw::at> find_attribute_conflict(const fatal_attribute_set& x,
+                                            const fatal_attribute_set& y) {
+    std::vector<dw::at> result;
+    fatal_attribute_set::words unshared;
+    fatal_attribute_set::words shared;
 
-    std::set_intersection(x_names.begin(), x_names.end(), y_names.begin(), y_names.end(),
-                          std::back_inserter(intersection));
+    for (std::size_t w = 0; w != unshared.size(); ++w) {
+        unshared[w] = x._names[w] ^ y._names[w];
+        shared[w] = x._names[w] & y._names[w];
+    }
 
-    const auto xf = x.begin();
-    const auto xl = x.end();
-    const auto yf = y.begin();
-    const auto yl = y.end();
+    // A fatal attribute one of them has and the other doesn't is a conflict.
+    for_each_name(unshared, [&](std::size_t n) { result.push_back(static_cast<dw::at>(n)); });
 
-    for (const auto name : intersection) {
-        auto xfound = std::find_if(xf, xl, [&](auto& x) { return name == x._name; });
-        auto yfound = std::find_if(yf, yl, [&](auto& y) { return name == y._name; });
-        assert(xfound != xl);
-        assert(yfound != yl);
-        if (!attributes_conflict(name, *xfound, *yfound)) continue;
+    for_each_name(shared, [&](std::size_t n) {
+        const auto name = static_cast<dw::at>(n);
+        if (!attributes_conflict(name, x.direct(n), y.direct(n))) return;
         result.push_back(name);
+    });
+
+    // The extended names are merged, as both lists are sorted.
+    auto xf = x._extended.begin();
+    const auto xl = x._extended.end();
+    auto yf = y._extended.begin();
+    const auto yl = y._extended.end();
+
+    while (xf != xl || yf != yl) {
+        if (yf == yl || (xf != xl && xf->first < yf->first)) {
+            result.push_back((xf++)->first);
+        } else if (xf == xl || yf->first < xf->first) {
+            result.push_back((yf++)->first);
+        } else {
+            const auto name = xf->first;
+            if (attributes_conflict(name, x._attributes.begin()[xf->second],
+                                    y._attributes.begin()[yf->second])) {
+                result.push_back(name);
+            }
+            ++xf;
+            ++yf;
+        }
     }
 
     return result;
@@ -143,26 +203,438 @@ bool type_equivalent(const attribute& x, const attribute& y) {
 
 /**************************************************************************************************/
 
-auto& unsafe_global_die_collection() {
-    static decltype(auto) collection_s = orc::make_leaky<std::list<dies>>();
-    return collection_s;
-}
+// Registered dies live in this arena for the lifetime of the application (or until `orc_reset`.)
+// Each thread bump-allocates dies out of a block of its own, so a die is written exactly once, at
+// its final address, and the die map can point straight at it. The only lock taken is the one to
+// hand a thread a fresh block, which happens once every `dies_per_block_k` dies.
+class die_arena {
+    static constexpr std::size_t dies_per_block_k = 16 * 1024;
+    static constexpr const char* tracy_pool_name_k = "die arena";
+
+    struct cursor {
+        die* _next{nullptr};
+        die* _end{nullptr};
+        std::size_t _generation{0};
+    };
 
-template <class F>
-auto with_global_die_collection(F&& f) {
-    static std::mutex m;
-    std::lock_guard<std::mutex> lock(m);
-    return f(unsafe_global_die_collection());
+    static_assert(std::is_trivially_destructible_v<die>,
+                  "die arena blocks are freed without running destructors");
+
+    std::mutex _m;
+    std::vector<die*> _blocks;
+    // Bumped by `clear`, which invalidates every thread's cursor at once.
+    std::atomic<std::size_t> _generation{1};
+    std::atomic<std::size_t> _bytes{0};
+
+    cursor new_block() {
+        constexpr std::size_t block_bytes_k = dies_per_block_k * sizeof(die);
+        die* block = static_cast<die*>(::operator new(block_bytes_k));
+        TracyAllocN(block, block_bytes_k, tracy_pool_name_k);
+        TracyPlot(tracy_pool_name_k, static_cast<int64_t>(_bytes += block_bytes_k));
+
+        std::lock_guard<std::mutex> lock(_m);
+        _blocks.push_back(block);
+        return cursor{block, block + dies_per_block_k, _generation.load()};
+    }
+
+public:
+    std::size_t bytes() const { return _bytes.load(); }
+
+    die& emplace(die&& d) {
+        thread_local cursor cursor_s;
+
+        if (cursor_s._next == cursor_s._end || cursor_s._generation != _generation.load()) {
+            cursor_s = new_block();
+        }
+
+        return *new (cursor_s._next++) die(std::move(d));
+    }
+
+    // Not thread safe. Nothing else can be touching the arena (or the dies in it) at the time.
+    void clear() {
+        std::lock_guard<std::mutex> lock(_m);
+        for (die* block : _blocks) {
+            TracyFreeN(block, tracy_pool_name_k);
+            ::operator delete(block);
+        }
+        _blocks.clear();
+        _bytes = 0;
+        TracyPlot(tracy_pool_name_k, static_cast<int64_t>(0));
+        ++_generation;
+    }
+};
+
+auto& global_die_arena() {
+    static decltype(auto) arena_s = orc::make_leaky<die_arena>();
+    return arena_s;
 }
 
 /**************************************************************************************************/
 
+// Maps a die hash to the list of registered dies with that hash. The list is threaded through
+// `die::_next_die`, and the map stores its head.
+//
+// The map is split into shards by the top bits of the hash. Each shard is an open-addressing
+// table that stores the hash next to the head pointer, so a probe does not have to touch the die.
+// Claiming a new slot and prepending a die to an existing slot's list are each a single CAS.
+// A shard's reader/writer lock is taken for reading on insertion, and only taken for writing
+// when the shard has to grow, which pre-sizing via `reserve` should make rare.
+//
+// Iteration is by shard: each is a contiguous array, and (as the hashes are well distributed)
+// about the same size as the others, so they make for natural units of parallel work.
+class die_map {
+    static constexpr std::size_t shard_bits_k = 8;
+    static constexpr std::size_t min_capacity_k = 1024; // slots per shard; must be a power of two
+    static constexpr std::size_t empty_k = 0;
+
+    struct slot {
+        std::atomic<std::size_t> _key{empty_k};
+        std::atomic<die*> _head{nullptr};
+        std::atomic<std::uint32_t> _count{0}; // length of the list at `_head`
+        // Whether the dies in the list differ in their fatal attribute hashes (or their paths, if
+        // their die hashes collided.) Only these lists can have ODRVs, so only these are reviewed.
+        std::atomic<bool> _diverged{false};
+    };
+
+    struct shard {
+        tbb::spin_rw_mutex _m;
+        std::unique_ptr<slot[]> _slots{new slot[min_capacity_k]};
+        std::size_t _capacity{min_capacity_k};
+        std::atomic<std::size_t> _size{0};
+    };
+
+    enum class insert_result {
+        claimed, // first die with this hash
+        prepended,
+        full,
+    };
+
+    std::unique_ptr<shard[]> _shards{new shard[shard_count_k]};
+    // `empty_k` cannot be used as a key in the tables, so dies that hash to it get a list of
+    // their own.
+    slot _zero;
+    std::atomic<std::size_t> _diverged_dies{0};
+
+    static std::size_t shard_index(std::size_t key) { return key >> (64 - shard_bits_k); }
+
+    // Each die is compared with the one it is linked in front of. The list is a chain of these
+    // comparisons, so if any two of its dies differ, some die differs from the one after it. Returns
+    // how many dies this adds to the diverged lists (a guess, should two threads race to do so.)
+    static std::size_t prepend(slot& s, die* d) {
+        die* head = s._head.load(std::memory_order_relaxed);
+        do {
+            d->_next_die = head;
+        } while (!s._head.compare_exchange_weak(head, d, std::memory_order_release,
+                                                std::memory_order_relaxed));
+        const std::size_t count = s._count.fetch_add(1, std::memory_order_relaxed) + 1;
+
+        if (s._diverged.load(std::memory_order_relaxed)) return 1;
+        if (!head || (head->_fatal_attribute_hash == d->_fatal_attribute_hash &&
+                      head->_path == d->_path)) {
+            return 0;
+        }
+        return s._diverged.exchange(true, std::memory_order_relaxed) ? 1 : count;
+    }
+
+    static insert_result insert(
+        slot* slots, std::size_t capacity, std::size_t key, die* d, std::size_t& diverged) {
+        const std::size_t mask = capacity - 1;
+
+        for (std::size_t i = 0, n = key & mask; i != capacity; ++i, n = (n + 1) & mask) {
+            slot& s = slots[n];
+            std::size_t found = s._key.load(std::memory_order_acquire);
+
+            if (found == empty_k &&
+                s._key.compare_exchange_strong(found, key, std::memory_order_acq_rel)) {
+                diverged = prepend(s, d);
+                return insert_result::claimed;
+            }
+
+            // Either the slot was already taken, or we lost the race to claim it (in which case
+            // `found` now holds the winner's key.)
+            if (found == key) {
+                diverged = prepend(s, d);
+                return insert_result::prepended;
+            }
+        }
+
+        return insert_result::full;
+    }
+
+    static void grow(shard& s, std::size_t capacity) {
+        tbb::spin_rw_mutex::scoped_lock lock(s._m, true);
+        if (s._capacity != capacity) return; // someone else beat us to it.
+        rehash(s, capacity * 2);
+    }
+
+    // Not thread safe; the caller must hold the shard's lock for writing.
+    static void rehash(shard& s, std::size_t capacity) {
+        std::unique_ptr<slot[]> slots(new slot[capacity]);
+        const std::size_t mask = capacity - 1;
+
+        for (std::size_t i = 0; i != s._capacity; ++i) {
+            const std::size_t key = s._slots[i]._key.load(std::memory_order_relaxed);
+            if (key == empty_k) continue;
+            std::size_t n = key & mask;
+            while (slots[n]._key.load(std::memory_order_relaxed) != empty_k) {
+                n = (n + 1) & mask;
+            }
+            slots[n]._key.store(key, std::memory_order_relaxed);
+            slots[n]._head.store(s._slots[i]._head.load(std::memory_order_relaxed),
+                                 std::memory_order_relaxed);
+            slots[n]._count.store(s._slots[i]._count.load(std::memory_order_relaxed),
+                                  std::memory_order_relaxed);
+            slots[n]._diverged.store(s._slots[i]._diverged.load(std::memory_order_relaxed),
+                                     std::memory_order_relaxed);
+        }
+
+        s._slots = std::move(slots);
+        s._capacity = capacity;
+    }
+
+public:
+    static constexpr std::size_t shard_count_k = std::size_t(1) << shard_bits_k;
+
+    // Pre-sizes the map for `count` unique hashes. Not thread safe.
+    void reserve(std::size_t count) {
+        // Keep the load factor at or below 3/4.
+        const std::size_t per_shard = (count / shard_count_k) * 4 / 3 + 1;
+        std::size_t capacity = min_capacity_k;
+        while (capacity < per_shard) capacity *= 2;
+
+        for (std::size_t i = 0; i != shard_count_k; ++i) {
+            if (_shards[i]._capacity < capacity) rehash(_shards[i], capacity);
+        }
+    }
+
+    // Adds the die to the list of dies that share its hash. Returns `true` if it is the first die
+    // with that hash. Thread safe.
+    bool insert(die* d) {
+        const std::size_t key = d->_hash;
+
+        if (key == empty_k) {
+            std::size_t expected = empty_k;
+            const bool claimed = _zero._key.compare_exchange_strong(expected, 1);
+            if (const auto diverged = prepend(_zero, d)) {
+                _diverged_dies.fetch_add(diverged, std::memory_order_relaxed);
+            }
+            return claimed;
+        }
+
+        shard& s = _shards[shard_index(key)];
+
+        while (true) {
+            insert_result result;
+            std::size_t capacity;
+            std::size_t diverged{0};
+            {
+                tbb::spin_rw_mutex::scoped_lock lock(s._m, false);
+                capacity = s._capacity;
+                result = insert(s._slots.get(), capacity, key, d, diverged);
+            }
+
+            if (diverged) _diverged_dies.fetch_add(diverged, std::memory_order_relaxed);
+
+            const bool over_full = result == insert_result::claimed &&
+                                   (s._size.fetch_add(1) + 1) * 4 > capacity * 3;
+
+            if (result == insert_result::full || over_full) {
+                grow(s, capacity);
+            }
+
+            if (result != insert_result::full) return result == insert_result::claimed;
+        }
+    }
+
+    std::size_t size() const {
+        std::size_t result = _zero._key.load() != empty_k;
+        for (std::size_t i = 0; i != shard_count_k; ++i) {
+            result += _shards[i]._size.load();
+        }
+        return result;
+    }
+
+    // The routines below treat each shard as a random-access range of slots, `[0, capacity)`, so
+    // work over the map can be divided up however the caller sees fit. None of them are thread
+    // safe with respect to `insert`, but disjoint ranges may be visited concurrently.
+
+    std::size_t capacity(std::size_t index) const { return _shards[index]._capacity; }
+
+    // About how many dies are in the diverged lists (see `slot::_diverged`).
+    std::size_t diverged_die_count() const {
+        return _diverged_dies.load(std::memory_order_relaxed);
+    }
+
+    // The number of dies in the list at the slot, if it has diverged (zero if the slot is empty
+    // or it has not.) The list of dies that hash to `empty_k` is counted as part of the first slot
+    // of the first shard.
+    std::size_t diverged_die_count(std::size_t index, std::size_t n) const {
+        const auto count = [](const slot& s) -> std::size_t {
+            if (!s._diverged.load(std::memory_order_relaxed)) return 0;
+            return s._count.load(std::memory_order_relaxed);
+        };
+        std::size_t result = count(_shards[index]._slots[n]);
+        if (index == 0 && n == 0) result += count(_zero);
+        return result;
+    }
+
+    // Calls `f(die*& head)` for every list in the slots `[first, last)` of the shard. `f` may
+    // replace the head of the list.
+    template <class F>
+    void for_each_in_shard(std::size_t index, std::size_t first, std::size_t last, F&& f) {
+        for_each_slot(index, first, last, [](const slot&) { return true; }, f);
+    }
+
+    // As `for_each_in_shard`, but only for the lists that have diverged.
+    template <class F>
+    void for_each_diverged_in_shard(std::size_t index,
+                                    std::size_t first,
+                                    std::size_t last,
+                                    F&& f) {
+        for_each_slot(
+            index, first, last,
+            [](const slot& s) { return s._diverged.load(std::memory_order_relaxed); }, f);
+    }
+
+    // Not thread safe.
+    void clear() {
+        for (std::size_t i = 0; i != shard_count_k; ++i) {
+            shard& s = _shards[i];
+            s._slots.reset(new slot[min_capacity_k]);
+            s._capacity = min_capacity_k;
+            s._size = 0;
+        }
+        _zero._key = empty_k;
+        _zero._head = nullptr;
+        _zero._count = 0;
+        _zero._diverged = false;
+        _diverged_dies = 0;
+    }
+
+private:
+    template <class P, class F>
+    void for_each_slot(std::size_t index, std::size_t first, std::size_t last, P&& p, F& f) {
+        if (index == 0 && first == 0 && _zero._key.load() != empty_k && p(_zero)) {
+            visit(_zero, f);
+        }
+
+        shard& s = _shards[index];
+        for (; first != last; ++first) {
+            if (s._slots[first]._key.load(std::memory_order_relaxed) == empty_k) continue;
+            if (!p(s._slots[first])) continue;
+            visit(s._slots[first], f);
+        }
+    }
+
+    template <class F>
+    static void visit(slot& s, F& f) {
+        die* head = s._head.load(std::memory_order_relaxed);
+        f(head);
+        s._head.store(head, std::memory_order_relaxed);
+    }
+};
+
 auto& global_die_map() {
-    static decltype(auto) map_s =
-        orc::make_leaky<tbb::concurrent_unordered_map<std::size_t, die*>>();
+    static decltype(auto) map_s = orc::make_leaky<die_map>();
     return map_s;
 }
 
+/**************************************************************************************************/
+// The share of the die hashes being registered by the current pass of `orc_process` (see the
+// `hash_partitions` setting.) The partition is taken from bits of the hash that neither the shard
+// nor the slot of a die in the die map depend on, so each pass spreads its dies over all of the
+// map. Set only between passes, while no dies are being registered.
+struct hash_partition {
+    std::size_t _count{1};
+    std::size_t _index{0};
+
+    bool contains(std::size_t hash) const { return _count == 1 || (hash >> 32) % _count == _index; }
+};
+
+auto& current_partition() {
+    static hash_partition partition_s;
+    return partition_s;
+}
+
+/**************************************************************************************************/
+// The roots of a dylib scan, when each is reviewed over only its own dependency closure (see the
+// `dylib_scan_sessions` setting.) Every session shares the one die map, so a dependency of several
+// roots is still registered once. `_closures[n]` says which object files (by `_ofd_index`) are in
+// the closure of the `n`th root. An object file with the same contents as another is not
+// processed, but aliased to it (see `object_file_deduplicate`), so `_members[n]` also has the
+// object files whose dies stand in for those of the closure. Set only between registering the
+// dies and reviewing them.
+struct scan_sessions {
+    std::vector<std::vector<bool>> _closures;
+    std::vector<std::vector<bool>> _members;
+
+    bool empty() const { return _members.empty(); }
+    std::size_t size() const { return _members.size(); }
+
+    // Whether the dies of the object file are a part of the session.
+    bool contains(std::size_t session, std::uint32_t ofd_index) const {
+        const auto& members = _members[session];
+        return ofd_index < members.size() && members[ofd_index];
+    }
+
+    // Whether the object file itself is in the closure of the session's root.
+    bool in_closure(std::size_t session, std::size_t ofd_index) const {
+        const auto& closure = _closures[session];
+        return ofd_index < closure.size() && closure[ofd_index];
+    }
+};
+
+auto& current_sessions() {
+    static scan_sessions sessions_s;
+    return sessions_s;
+}
+
+/**************************************************************************************************/
+// Results found during the review are collected into a buffer per thread, so finding one does not
+// contend with any other thread. They are gathered up once the review is done.
+template <class T>
+class per_thread_buffers {
+    std::mutex _m;
+    std::vector<std::unique_ptr<std::vector<T>>> _buffers;
+
+public:
+    std::vector<T>& local() {
+        thread_local std::vector<T>& buffer_s = [this]() -> auto& {
+            std::lock_guard<std::mutex> lock(_m);
+            return *_buffers.emplace_back(std::make_unique<std::vector<T>>());
+        }();
+        return buffer_s;
+    }
+
+    // Moves every item out of every buffer. Not thread safe.
+    std::vector<T> gather() {
+        std::lock_guard<std::mutex> lock(_m);
+        std::size_t count{0};
+        for (const auto& buffer : _buffers) count += buffer->size();
+
+        std::vector<T> result;
+        result.reserve(count);
+        for (auto& buffer : _buffers) {
+            std::move(buffer->begin(), buffer->end(), std::back_inserter(result));
+            buffer->clear();
+        }
+        return result;
+    }
+};
+
+// A list of dies the review found to have conflicting definitions.
+struct conflicting_list {
+    std::string_view _symbol;
+    const die* _head{nullptr};
+    // The sessions that found the conflict, when the review is by session (see `scan_sessions`.)
+    std::vector<std::size_t> _sessions;
+};
+
+auto& global_conflict_buffers() {
+    static decltype(auto) buffers_s = orc::make_leaky<per_thread_buffers<conflicting_list>>();
+    return buffers_s;
+}
+
 /**************************************************************************************************/
 
 struct cmdline_results {
@@ -177,13 +649,114 @@ const char* problem_prefix() { return settings::instance()._graceful_exit ? "war
 
 /**************************************************************************************************/
 
+// Setting up a `dwarf` for an object file means mapping its top-level file, reading the Mach-O
+// load commands, and parsing the abbreviations. As a single object file can be involved in many
+// ODRV reports, the ready-to-go instances are kept around in this cache, up to a limit, with the
+// least recently used ones evicted first.
+//
+// A `dwarf` is stateful (it has a read position, and the current compilation unit's details) so
+// only one thread may use a given instance at a time.
+class dwarf_cache {
+    static constexpr std::size_t max_size_k = 128;
+
+    struct entry {
+        explicit entry(std::uint32_t ofd_index) : _ofd_index{ofd_index} {}
+
+        std::uint32_t _ofd_index{0};
+        std::mutex _m;
+        std::optional<dwarf> _dwarf;
+    };
+
+    using entry_ptr = std::shared_ptr<entry>;
+    using lru_list = std::list<entry_ptr>; // most recently used at the front
+
+    std::mutex _m;
+    lru_list _lru;
+    std::unordered_map<std::uint32_t, lru_list::iterator> _index;
+
+    entry_ptr find(std::uint32_t ofd_index) {
+        std::lock_guard<std::mutex> lock(_m);
+
+        auto found = _index.find(ofd_index);
+        if (found != _index.end()) {
+            _lru.splice(_lru.begin(), _lru, found->second);
+            return _lru.front();
+        }
+
+        _lru.push_front(std::make_shared<entry>(ofd_index));
+        _index[ofd_index] = _lru.begin();
+
+        if (_lru.size() > max_size_k) {
+            // Threads still using the evicted entry keep it alive until they are done with it.
+            _index.erase(_lru.back()->_ofd_index);
+            _lru.pop_back();
+        }
+
+        return _lru.front();
+    }
+
+public:
+    // Calls `f(dwarf&)` with exclusive access to the ready `dwarf` for the object file.
+    template <class F>
+    auto with_dwarf(std::uint32_t ofd_index, F&& f) {
+        entry_ptr e = find(ofd_index);
+
+        std::lock_guard<std::mutex> lock(e->_m);
+
+        if (!e->_dwarf) {
+            e->_dwarf.emplace(
+                dwarf_from_macho(ofd_index, macho_params{macho_reader_mode::odrv_reporting}));
+        }
+
+        return f(*e->_dwarf);
+    }
+
+    // Not thread safe.
+    void clear() {
+        _index.clear();
+        _lru.clear();
+    }
+};
+
+auto& global_dwarf_cache() {
+    static decltype(auto) cache_s = orc::make_leaky<dwarf_cache>();
+    return cache_s;
+}
+
+/**************************************************************************************************/
+
+// Attributes decoded ahead of time by `prefetch_report_attributes`. The map is filled before the
+// reports are built, and only read while they are.
+auto& prefetched_attributes() {
+    static decltype(auto) map_s =
+        orc::make_leaky<std::unordered_map<const die*, attribute_sequence>>();
+    return map_s;
+}
+
+/**************************************************************************************************/
+// Reads the registered die `d` again from its object file. `d` keeps its offsets relative to its
+// unit; the dwarf wants them relative to __debug_info.
+die_pair fetch_registered_die(dwarf& dwarf, const die& d) {
+    const std::size_t cu_header_offset = object_file_unit_offset(d._cu_index);
+    return dwarf.fetch_one_die(cu_header_offset + d._offset, cu_header_offset,
+                               cu_header_offset + d._cu_die_offset);
+}
+
+/**************************************************************************************************/
+
 attribute_sequence fetch_attributes_for_die(const die& d) {
     // Too verbose for larger projects, but keep around for debugging/smaller projects.
     // ZoneScoped;
 
-    auto dwarf = dwarf_from_macho(d._ofd_index, macho_params{macho_reader_mode::odrv_reporting});
+    auto& prefetched = prefetched_attributes();
+    if (auto found = prefetched.find(&d); found != prefetched.end()) {
+        // Each prefetched die is used by exactly one report, so its attributes can be taken.
+        return std::move(found->second);
+    }
 
-    auto [die, attributes] = dwarf.fetch_one_die(d._offset, d._cu_header_offset, d._cu_die_offset);
+    auto [die, attributes] = global_dwarf_cache().with_dwarf(d._ofd_index, [&](dwarf& dwarf) {
+        return fetch_registered_die(dwarf, d);
+    });
     assert(die._tag == d._tag);
     assert(die._arch == d._arch);
     assert(die._has_children == d._has_children);
@@ -197,45 +770,86 @@ attribute_sequence fetch_attributes_for_die(const die& d) {
 
 /**************************************************************************************************/
 
-odrv_report::odrv_report(std::string_view symbol, const die* list_head)
+odrv_report::odrv_report(std::string_view symbol,
+                         const die* list_head,
+                         const std::function<bool(std::size_t ofd_index)>& includes)
     : _symbol(symbol), _list_head(list_head) {
     // Too verbose for larger projects, but keep around for debugging/smaller projects.
     // ZoneScoped;
 
     assert(_list_head->_conflict);
 
-    // Construct a map of unique definitions of the conflicting symbol.
-    // Each entry in `conflict_map` will be a collection of dies
-    // whose fatal attribute hashes are all the same.
+    // Collect the unique definitions of the conflicting symbol. Each entry in `_conflicts` is
+    // a collection of dies whose fatal attribute hashes are all the same. There are only ever a
+    // few of them, so they are found by a linear search.
     for (const die* next_die = _list_head; next_die; next_die = next_die->_next_die) {
         const die& die = *next_die;
         const std::size_t hash = die._fatal_attribute_hash;
-        const bool new_conflict = _conflict_map.count(hash) == 0;
-        auto& conflict = _conflict_map[hash];
+        auto found = std::find_if(_conflicts.begin(), _conflicts.end(),
+                                  [&](const auto& c) { return c._hash == hash; });
 
-        ++conflict._count;
-
-        if (die._location) {
-            conflict._locations[*die._location].emplace_back(object_file_ancestry(die._ofd_index));
-        }
-
-        if (new_conflict) {
+        if (found == _conflicts.end()) {
             // The fatal attribute hash should be the same for all instances
             // of this `conflict`, so we only need to set its attributes once.
-            conflict._attributes = fetch_attributes_for_die(die);
+            conflict_details conflict;
+            conflict._hash = hash;
             conflict._tag = die._tag;
+            conflict._attributes = fetch_attributes_for_die(die);
+            found = _conflicts.insert(_conflicts.end(), std::move(conflict));
+        }
+
+        // Object files with the same contents as this one were not processed (see
+        // `object_file_alias`), so this die stands in for theirs, too.
+        auto aliases = object_file_aliases(die._ofd_index);
+        const bool included = !includes || includes(die._ofd_index);
+        if (includes) {
+            aliases.erase(std::remove_if(aliases.begin(), aliases.end(),
+                                         [&](std::size_t alias) { return !includes(alias); }),
+                          aliases.end());
+        }
+
+        found->_count += included + aliases.size();
+
+        if (const auto location = die.definition_location()) {
+            if (included) _instances.push_back(instance{hash, *location, die._ofd_index});
+            for (const auto alias : aliases) {
+                _instances.push_back(instance{hash, *location, alias});
+            }
         }
     }
 
-    assert(_conflict_map.size() > 1);
+    assert(_conflicts.size() > 1);
+
+    std::sort(_conflicts.begin(), _conflicts.end(),
+              [](const auto& a, const auto& b) { return a._hash < b._hash; });
+
+    // Stable, so the instances at each location stay in the order of the die list.
+    std::stable_sort(_instances.begin(), _instances.end(), [](const auto& a, const auto& b) {
+        if (a._conflict_hash != b._conflict_hash) return a._conflict_hash < b._conflict_hash;
+        return a._location < b._location;
+    });
+
+    std::size_t first = 0;
+    for (auto& conflict : _conflicts) {
+        std::size_t last = first;
+        while (last != _instances.size() && _instances[last]._conflict_hash == conflict._hash) {
+            ++last;
+        }
+        conflict._first = first;
+        conflict._last = last;
+        first = last;
+    }
 
     // Derive the ODRV categories.
-    const auto conflict_first = _conflict_map.begin();
-    const auto conflict_last = _conflict_map.end();
+    std::vector<fatal_attribute_set> fatal_sets;
+    fatal_sets.reserve(_conflicts.size());
+    for (const auto& conflict : _conflicts) {
+        fatal_sets.emplace_back(conflict._attributes);
+    }
 
-    for (auto x = conflict_first; x != conflict_last; ++x) {
-        for (auto y = std::next(x); y != conflict_last; ++y) {
-            auto conflicts = find_attribute_conflict(x->second._attributes, y->second._attributes);
+    for (auto x = fatal_sets.begin(); x != fatal_sets.end(); ++x) {
+        for (auto y = std::next(x); y != fatal_sets.end(); ++y) {
+            auto conflicts = find_attribute_conflict(*x, *y);
             _conflicting_attributes.insert(_conflicting_attributes.end(), conflicts.begin(),
                                            conflicts.end());
         }
@@ -307,7 +921,7 @@ std::string odrv_report::reporting_categories() const {
 /**************************************************************************************************/
 // Generates a category "slug" based on this symbol's kind + the category (e.g. member:type).
 std::string odrv_report::category(std::size_t n) const {
-    return to_string(_conflict_map.begin()->second._tag) + std::string(":") +
+    return to_string(_conflicts.front()._tag) + std::string(":") +
            (_conflicting_attributes.empty() ? "<none>" : to_string(_conflicting_attributes[n]));
 }
 
@@ -327,15 +941,24 @@ bool emit_report(const odrv_report& report) {
 }
 
 /**************************************************************************************************/
+// Whether a report on a die with this tag could be emitted, by its tag alone. (Its categories all
+// start with the tag.) When this is `false` the report would be filtered out, so it needn't be
+// built at all.
+bool may_emit_tag(dw::tag tag) {
+    const auto& settings = settings::instance();
+    const auto& categories = !settings._violation_ignore.empty() ? settings._violation_ignore
+                                                                 : settings._violation_report;
+
+    if (categories.empty()) return true;
+
+    const std::string prefix = to_string(tag) + std::string(":");
+    const bool listed = std::any_of(categories.begin(), categories.end(), [&](const auto& c) {
+        return c.starts_with(prefix);
+    });
 
-template <class MapType>
-auto sorted_keys(const MapType& map) {
-    std::vector<typename MapType::key_type> result;
-    for (const auto& entry : map) {
-        result.emplace_back(entry.first);
-    }
-    std::sort(result.begin(), result.end());
-    return result;
+    // With a denylist, only a listed tag can be filtered out. With an allowlist, only a listed one
+    // can be reported.
+    return !settings._violation_ignore.empty() || listed;
 }
 
 /**************************************************************************************************/
@@ -344,19 +967,21 @@ std::ostream& operator<<(std::ostream& s, const odrv_report& report) {
     const std::string_view& symbol = report._symbol;
 
     s << problem_prefix() << ": ODRV (" << report.reporting_categories() << "); "
-      << report.conflict_map().size() << " conflicts with `"
-      << (symbol.data() ? demangle(symbol.data()) : "<unknown>") << "`\n";
-    const auto& conflicts = report.conflict_map();
-    for (const auto& entry : sorted_keys(conflicts)) {
-        const auto& conflict = conflicts.at(entry);
-        const auto& locations = conflict._locations;
+      << report.conflicts().size() << " conflicts with `"
+      << (symbol.data() ? demangle(empool(symbol)).view() : "<unknown>") << "`\n";
+    for (const auto& conflict : report.conflicts()) {
+        const auto instances = report.instances(conflict);
 
         s << conflict._attributes;
         s << "    symbol defintion location(s):\n";
-        for (const auto& entry : sorted_keys(locations)) {
-            const auto& instances = locations.at(entry);
-            s << "        " << entry << " (used by `" << instances.front() << "` and "
-              << (instances.size() - 1) << " others)\n";
+        for (auto first = instances.begin(); first != instances.end();) {
+            const auto last = std::find_if(first, instances.end(), [&](const auto& x) {
+                return x._location != first->_location;
+            });
+            s << "        " << first->_location << " (used by `"
+              << object_file_ancestry(first->_ofd_index) << "` and "
+              << (std::distance(first, last) - 1) << " others)\n";
+            first = last;
         }
         s << '\n';
     }
@@ -367,7 +992,67 @@ std::ostream& operator<<(std::ostream& s, const odrv_report& report) {
 
 /**************************************************************************************************/
 
-die* enforce_odrv_for_die_list(die* base, std::vector<odrv_report>& results) {
+namespace {
+
+/**************************************************************************************************/
+// Reviews a sorted list once for each session, over just the dies in that session's closure. The
+// dies in the die map are shared by every session, so each list that conflicts is copied out of
+// it, and is found in the conflicts like any other. When several sessions find the same dies in
+// conflict (as they will, when the dies come from a dependency they share), the conflict is only
+// recorded once, along with every session that found it.
+void enforce_odrv_for_sessions(const die* head) {
+    const auto& sessions = current_sessions();
+    auto& buffer = global_conflict_buffers().local();
+    thread_local std::vector<const die*> dies;
+    // The dies of each conflict recorded, and where in `buffer` it was recorded.
+    std::vector<std::pair<std::vector<const die*>, std::size_t>> recorded;
+
+    for (std::size_t session = 0; session != sessions.size(); ++session) {
+        dies.clear();
+        bool conflict{false};
+
+        for (const die* d = head; d; d = d->_next_die) {
+            if (!sessions.contains(session, d->_ofd_index)) continue;
+            if (!dies.empty() && dies.back()->_fatal_attribute_hash != d->_fatal_attribute_hash) {
+                conflict = true;
+            }
+            dies.push_back(d);
+        }
+
+        if (!conflict) continue;
+
+        const auto found = std::find_if(recorded.begin(), recorded.end(),
+                                        [&](const auto& entry) { return entry.first == dies; });
+        if (found != recorded.end()) {
+            buffer[found->second]._sessions.push_back(session);
+            continue;
+        }
+
+        recorded.emplace_back(dies, buffer.size());
+
+        // The copies live in the die arena, so they last as long as the dies they were made from.
+        die* copy_head{nullptr};
+        die** next = &copy_head;
+        for (const die* d : dies) {
+            die& copy = global_die_arena().emplace(die(*d));
+            *next = &copy;
+            next = &copy._next_die;
+        }
+        *next = nullptr;
+
+        copy_head->_conflict = true;
+
+        buffer.push_back(conflicting_list{path_to_symbol(head->_path.view()), copy_head, {session}});
+    }
+}
+
+/**************************************************************************************************/
+
+} // namespace
+
+/**************************************************************************************************/
+
+die* enforce_odrv_for_die_list(die* base) {
     ZoneScoped;
 
     // pre-flight the vector allocation by counting the number of dies
@@ -385,54 +1070,75 @@ die* enforce_odrv_for_die_list(die* base, std::vector<odrv_report>& results) {
     // reallocating the vector when the die count grows between runs;
     // Otherwise, we are reusing the same memory over again, saving
     // us time.
-    thread_local std::vector<die*> dies;
-    dies.resize(count, nullptr);
+    //
+    // Each die is paired with the rank of its object file's ancestry, so the sort below compares
+    // integers instead of ancestries (see `object_file_rank`.)
+    thread_local std::vector<std::pair<std::uint32_t, die*>> dies;
+    dies.resize(count);
+
+    orc::stats_die_list(count);
 
     // traverse the linked list and put its pointers into the vector
     // so we can sort them by file ancestry.
     std::size_t i = 0;
     for (die* ptr = base; ptr; ptr = ptr->_next_die) {
-        dies[i++] = ptr;
+        dies[i++] = std::make_pair(object_file_rank(ptr->_ofd_index), ptr);
     }
 
-    assert(dies.front() == base);
-    assert(dies.back() != nullptr);
+    assert(dies.front().second == base);
+    assert(dies.back().second != nullptr);
+
+    // Equal paths are the same pool string, so dies with different ones can only share a list if
+    // their die hashes collided. Nothing found in this list can be trusted, so say so.
+    for (const auto& [rank, d] : dies) {
+        if (d->_path == base->_path) continue;
+
+        if (log_level_at_least(settings::log_level::warning)) {
+            cerr_safe([&](auto& s) {
+                s << "warning: die hash collision between " << base->_path << " and "
+                  << d->_path << '\n';
+            });
+        }
+        break;
+    }
 
     // Theory: if multiple copies of the same source file were compiled,
     // the ancestry might not be unique. We assume that's an edge case
     // and the ancestry is unique.
-    std::sort(dies.begin(), dies.end(), [](const die* a, const die* b) {
-        return object_file_ancestry(a->_ofd_index) < object_file_ancestry(b->_ofd_index);
-    });
+    std::sort(dies.begin(), dies.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
 
     bool conflict{false};
     for (size_t i = 1; i < dies.size(); ++i) {
+        die* previous = dies[i - 1].second;
+        die* current = dies[i].second;
+
         // Re-link the die list to match the sorted order.
-        dies[i - 1]->_next_die = dies[i];
+        previous->_next_die = current;
 
         // Check and see if we have any conflicts along the way.
         if (!conflict) {
-            conflict = dies[i - 1]->_fatal_attribute_hash != dies[i]->_fatal_attribute_hash;
+            conflict = previous->_fatal_attribute_hash != current->_fatal_attribute_hash;
         }
     }
-    dies.back()->_next_die = nullptr;
+    dies.back().second->_next_die = nullptr;
 
-    if (!conflict) return dies.front();
+    die* const head = dies.front().second;
 
-    dies[0]->_conflict = true;
+    if (!conflict) return head;
 
-    odrv_report report{path_to_symbol(base->_path.view()), dies[0]};
-
-    // This can be very contentious for large projects. We may want to think
-    // about a more efficient way to collect these reports per-thread, then
-    // bubble them up once they've all been collected.
-    static TracyLockable(std::mutex, odrv_report_mutex);
-    {
-        std::lock_guard<LockableBase(std::mutex)> lock(odrv_report_mutex);
-        results.push_back(report);
+    // The list has to conflict as a whole for any one session's part of it to.
+    if (!current_sessions().empty()) {
+        enforce_odrv_for_sessions(head);
+        return head;
     }
 
-    return dies.front();
+    head->_conflict = true;
+
+    global_conflict_buffers().local().push_back(
+        conflicting_list{path_to_symbol(base->_path.view()), head});
+
+    return head;
 }
 
 /**************************************************************************************************/
@@ -440,8 +1146,184 @@ die* enforce_odrv_for_die_list(die* base, std::vector<odrv_report>& results) {
 namespace {
 
 /**************************************************************************************************/
+// `weights[n]` is the number of dies in the slots `[0, n)` of the shard. While the range holds
+// more than `grain` dies, the back half (by die count, not slot count) is split off and issued as
+// its own work item, where any idle thread can steal it. A single slot is never split, so a symbol
+// with tens of thousands of instances ends up in a piece of work of its own.
+void review_shard_range(std::shared_ptr<const std::vector<std::size_t>> weights,
+                        std::size_t index,
+                        std::size_t first,
+                        std::size_t last,
+                        std::size_t grain) {
+    const auto& w = *weights;
+
+    while (last - first > 1 && w[last] - w[first] > grain) {
+        const std::size_t half = w[first] + (w[last] - w[first]) / 2;
+        auto split = std::upper_bound(w.begin() + first + 1, w.begin() + last, half) - w.begin();
+        // Keep both halves nonempty.
+        split = std::clamp<std::size_t>(split, first + 1, last - 1);
+
+        orc::do_work([weights, index, split, last, grain] {
+            review_shard_range(weights, index, split, last, grain);
+        });
+
+        last = split;
+    }
+
+    global_die_map().for_each_diverged_in_shard(index, first, last, [&](die*& head) {
+        head = enforce_odrv_for_die_list(head);
+    });
+}
 
-void parse_dsym(const std::filesystem::path& dsym) {
+void review_shard(std::size_t index, std::size_t grain) {
+    ZoneScoped;
+
+    const auto& map = global_die_map();
+    const std::size_t capacity = map.capacity(index);
+    auto weights = std::make_shared<std::vector<std::size_t>>(capacity + 1, 0);
+
+    for (std::size_t i = 0; i != capacity; ++i) {
+        (*weights)[i + 1] = (*weights)[i] + map.diverged_die_count(index, i);
+    }
+
+    review_shard_range(std::move(weights), index, 0, capacity, grain);
+}
+
+/**************************************************************************************************/
+// Decodes the attributes of every die an `odrv_report` will need, ahead of building the reports.
+// The dies are grouped by object file and sorted by offset, so each object file is decoded in a
+// single forward pass. This turns what would otherwise be scattered seeks (and page faults) over
+// the inputs into sequential reads. Object files are decoded in parallel.
+void prefetch_report_attributes(const std::vector<conflicting_list>& conflicts) {
+    ZoneScoped;
+
+    // The report needs the attributes of the first die in the list with any given fatal attribute
+    // hash. This must match the die `odrv_report::odrv_report` picks.
+    std::vector<const die*> needed;
+    std::vector<std::size_t> seen;
+    for (const auto& conflict : conflicts) {
+        seen.clear();
+        for (const die* d = conflict._head; d; d = d->_next_die) {
+            if (std::find(seen.begin(), seen.end(), d->_fatal_attribute_hash) != seen.end()) {
+                continue;
+            }
+            seen.push_back(d->_fatal_attribute_hash);
+            needed.push_back(d);
+        }
+    }
+
+    std::sort(needed.begin(), needed.end(), [](const die* a, const die* b) {
+        return std::tie(a->_ofd_index, a->_cu_index, a->_offset) <
+               std::tie(b->_ofd_index, b->_cu_index, b->_offset);
+    });
+
+    std::vector<attribute_sequence> attributes(needed.size());
+
+    for (auto first = needed.begin(); first != needed.end();) {
+        const std::uint32_t ofd_index = (*first)->_ofd_index;
+        auto last = std::find_if(first, needed.end(),
+                                 [&](const die* d) { return d->_ofd_index != ofd_index; });
+        auto out = attributes.begin() + std::distance(needed.begin(), first);
+
+        orc::do_work([_first = first, _last = last, _out = out, ofd_index]() mutable {
+            ZoneScopedN("prefetch_report_attributes_for_file");
+            global_dwarf_cache().with_dwarf(ofd_index, [&](dwarf& dwarf) {
+                for (; _first != _last; ++_first, ++_out) {
+                    const die& d = **_first;
+                    *_out = std::get<1>(fetch_registered_die(dwarf, d));
+                }
+            });
+        });
+
+        first = last;
+    }
+
+    orc::block_on_work();
+
+    auto& prefetched = prefetched_attributes();
+    prefetched.reserve(needed.size());
+    for (std::size_t i = 0; i != needed.size(); ++i) {
+        prefetched.emplace(needed[i], std::move(attributes[i]));
+    }
+}
+
+/**************************************************************************************************/
+
+// Builds the reports to be emitted, in symbol order, and no more of them than are needed: once
+// there are `max_violation_count` of them, the rest of the conflicts are never looked at. Those
+// that will be filtered out by their tags alone are never built, either. The reports are built in
+// parallel, a wave at a time. Each wave is no larger than what's left to reach the limit, but no
+// smaller than the number of workers, in case some are filtered out.
+std::vector<odrv_report> make_reports(std::vector<conflicting_list>&& conflicts) {
+    ZoneScoped;
+
+    // A symbol has more than one conflict only when sessions found different dies of it in
+    // conflict. Those are ordered by session, so the reports come out the same way every run.
+    std::sort(conflicts.begin(), conflicts.end(), [](const auto& a, const auto& b) {
+        return std::tie(a._symbol, a._sessions) < std::tie(b._symbol, b._sessions);
+    });
+
+    conflicts.erase(std::remove_if(conflicts.begin(), conflicts.end(),
+                                   [](const conflicting_list& conflict) {
+                                       for (const die* d = conflict._head; d; d = d->_next_die) {
+                                           if (may_emit_tag(d->_tag)) return false;
+                                       }
+                                       return true;
+                                   }),
+                    conflicts.end());
+
+    const std::size_t max_count = settings::instance()._max_violation_count;
+    const std::size_t workers = orc::queue_size();
+    constexpr std::size_t reports_per_worker_k = 16;
+    std::vector<odrv_report> result;
+
+    for (auto first = conflicts.begin(); first != conflicts.end();) {
+        std::size_t wave_size = workers * reports_per_worker_k;
+        if (max_count) wave_size = std::min(wave_size, std::max(max_count - result.size(), workers));
+        const auto last = first + std::min<std::ptrdiff_t>(wave_size, conflicts.end() - first);
+        const std::vector<conflicting_list> wave(first, last);
+        std::vector<std::optional<odrv_report>> reports(wave.size());
+
+        prefetch_report_attributes(wave);
+
+        for (std::size_t i = 0; i != wave.size(); ++i) {
+            orc::do_work([&_report = reports[i], _conflict = wave[i]] {
+                if (_conflict._sessions.empty()) {
+                    _report.emplace(_conflict._symbol, _conflict._head);
+                    return;
+                }
+
+                // Only the object files of the sessions that found the conflict are listed.
+                const auto& sessions = current_sessions();
+                _report.emplace(_conflict._symbol, _conflict._head, [&](std::size_t ofd_index) {
+                    return std::any_of(_conflict._sessions.begin(), _conflict._sessions.end(),
+                                       [&](std::size_t session) {
+                                           return sessions.in_closure(session, ofd_index);
+                                       });
+                });
+            });
+        }
+
+        orc::block_on_work();
+
+        prefetched_attributes().clear();
+
+        for (auto& report : reports) {
+            if (!emit_report(*report)) continue;
+            result.push_back(std::move(*report));
+            if (result.size() == max_count) return result;
+        }
+
+        first = last;
+    }
+
+    return result;
+}
+
+/**************************************************************************************************/
+
+void append_dsym_files(const std::filesystem::path& dsym,
+                       std::vector<std::filesystem::path>& files) {
     // This may be making a lot of assumptions about the various files, nuances, metadata, directory
     // structures, etc., that are contained within a dSYM. I would expect further tweaks will
     // be necessary as real-world issues are found.
@@ -451,105 +1333,435 @@ void parse_dsym(const std::filesystem::path& dsym) {
     for (const auto& entry : std::filesystem::directory_iterator(dsym / "Contents" / "Resources" / "DWARF")) {
         const auto path = entry.path();
         if (!is_regular_file(path)) continue;
-        orc::do_work([_input_path = std::move(path)]{
-            freader input(_input_path);
-
-            parse_file(_input_path.string(), object_ancestry(), input, input.size(),
-                       macho_params{macho_reader_mode::register_dies});
-        });
+        files.push_back(path);
     }
 }
 
 /**************************************************************************************************/
+// Feeds inputs to the workers as they are pushed, with no more than `max_open` of them mapped at a
+// time. Until then each input is mapped and handed off as soon as it is pushed; past that it waits
+// in line. Whenever one is unmapped (which happens once every Mach-O in it has been processed) the
+// next in line is mapped and handed off in its place, so there is always work mapped and waiting
+// for the workers without the mappings piling up. Inputs may be pushed from any thread, while the
+// ones before them are processed. The caller must `block_on_work` before the pipeline goes away.
+class input_pipeline {
+public:
+    explicit input_pipeline(std::size_t max_open) : _max_open(max_open) {}
+
+    // Inputs that do not exist are skipped, and dSYM bundles are replaced by the files inside them.
+    // An input may also be one member of an archive, as debug maps name them (see
+    // `parse_ar_member_path`), in which case only that member is read.
+    void push(const std::filesystem::path& input_path) {
+        const auto member = parse_ar_member_path(input_path);
+        if (!exists(member ? member->_archive : input_path)) {
+            if (log_level_at_least(settings::log_level::verbose)) {
+                cerr_safe([&](auto& s) {
+                    s << "file " << input_path.string() << " does not exist\n";
+                });
+            }
+            return;
+        }
 
-} // namespace
+        if (input_path.extension() == ".dSYM" && is_directory(input_path)) {
+            // special case: it's actually a directory.
+            std::vector<std::filesystem::path> files;
+            append_dsym_files(input_path, files);
+            for (auto& file : files) {
+                enqueue(std::move(file));
+            }
+        } else {
+            enqueue(input_path);
+        }
+    }
 
-/**************************************************************************************************/
+private:
+    static void parse_input(freader input, const std::filesystem::path& input_path) {
+        if (globals::instance()._cancelled) return;
 
-std::vector<odrv_report> orc_process(std::vector<std::filesystem::path>&& file_list) {
-    // First stage: (optional) dependency/dylib preprocessing
-    if (settings::instance()._dylib_scan_mode) {
-        TracyMessageL("orc_process: dylib scan");
+        macho_params params{macho_reader_mode::register_dies};
+        std::filesystem::path file_path = input_path;
 
-        // dylib scan mode involves a pre-processing step where we parse the file list
-        // and discover any dylibs those Mach-O files depend upon. Note that we're
-        // glomming all these dependencies together, so if there are multiple
-        // files in `file_list`, we could be "finding" ODRVs across independent
-        // artifact+dylib groups that really do not exist.
-        file_list = macho_derive_dylibs(std::move(file_list));
+        if (auto member = parse_ar_member_path(input_path)) {
+            file_path = std::move(member->_archive);
+            params._ar_member = std::move(member->_member);
+        }
+
+        parse_file(file_path.string(), object_ancestry(), input, input.size(), std::move(params));
     }
 
-    TracyMessageL("orc_process: process all DIEs");
+    // The file to map for an input.
+    static std::filesystem::path file_path(const std::filesystem::path& input_path) {
+        auto member = parse_ar_member_path(input_path);
+        return member ? std::move(member->_archive) : input_path;
+    }
 
-    for (const auto& input_path : file_list) {
-        orc::do_work([_input_path = input_path] {
-            if (!exists(_input_path)) {
-                if (log_level_at_least(settings::log_level::verbose)) {
-                    cerr_safe([&](auto& s) {
-                        s << "file " << _input_path.string() << " does not exist\n";
-                    });
-                }
+    void enqueue(std::filesystem::path input_path) {
+        // Without parallel processing each input is unmapped before the next one is pushed anyway,
+        // and opening the next in line from `on_unmap` could recurse once per input.
+        if (!settings::instance()._parallel_processing) {
+            parse_input(freader(file_path(input_path)), input_path);
+            return;
+        }
+
+        {
+            std::lock_guard m(_mutex);
+            if (_max_open && _open == _max_open) {
+                _waiting.push_back(std::move(input_path));
                 return;
             }
+            ++_open;
+        }
 
-            if (_input_path.extension() == ".dSYM" && is_directory(_input_path)) {
-                // special case: it's actually a directory.
-                parse_dsym(_input_path);
-            } else {
-                freader input(_input_path);
+        open(std::move(input_path));
+    }
+
+    void on_unmap() {
+        std::filesystem::path next;
 
-                parse_file(_input_path.string(), object_ancestry(), input, input.size(),
-                           macho_params{macho_reader_mode::register_dies});
+        {
+            std::lock_guard m(_mutex);
+            if (_waiting.empty()) {
+                --_open;
+                return;
+            }
+            next = std::move(_waiting.front());
+            _waiting.pop_front();
+        }
+
+        open(std::move(next));
+    }
+
+    void open(std::filesystem::path input_path) {
+        freader input(file_path(input_path), [this] { on_unmap(); });
+
+        orc::do_work([_input = std::move(input), _path = std::move(input_path)]() mutable {
+            parse_input(std::move(_input), _path);
+        });
+    }
+
+    const std::size_t _max_open;
+    std::mutex _mutex;
+    std::size_t _open{0};
+    std::deque<std::filesystem::path> _waiting;
+};
+
+/**************************************************************************************************/
+// Registers the dies of every input. In dylib scan mode, the inputs are the Mach-O files in
+// `inputs` and every dylib they depend on, each of which is added to `found` (if given) as it is
+// discovered. The dependency closure of each input is stored in `closures` (if given.)
+void register_inputs(const std::vector<std::filesystem::path>& inputs,
+                     bool scan_dylibs,
+                     std::vector<std::filesystem::path>* found,
+                     std::vector<std::vector<std::filesystem::path>>* closures) {
+    input_pipeline pipeline(settings::instance()._max_open_files);
+
+    if (scan_dylibs) {
+        TracyMessageL("orc_process: dylib scan");
+
+        // Each file is handed to the pipeline as soon as it is discovered, so its DIEs are
+        // processed while the scan goes on. Note that we're glomming all these dependencies
+        // together, so if there are multiple files in `inputs`, we could be "finding" ODRVs
+        // across independent artifact+dylib groups that really do not exist, unless they are
+        // reviewed a closure at a time (see `scan_sessions`.)
+        std::mutex found_mutex;
+        auto result = macho_derive_dylibs(inputs, [&](const std::filesystem::path& p) {
+            if (found) {
+                std::lock_guard lock(found_mutex);
+                found->push_back(p);
             }
+            pipeline.push(p);
         });
+
+        if (closures) *closures = std::move(result);
+    } else {
+        for (const auto& input_path : inputs) {
+            pipeline.push(input_path);
+        }
     }
 
     orc::block_on_work();
+}
 
-    TracyMessageL("orc_process: review DIEs for ODRVs");
+/**************************************************************************************************/
+// Maps the dependency closures found by a dylib scan to the object files registered from them. An
+// object file belongs to a closure if its top-level file does, or (for an archive member named by
+// a debug map) if its member path does (see `ar_member_path`.)
+scan_sessions make_sessions(const std::vector<std::vector<std::filesystem::path>>& closures) {
+    std::unordered_map<std::string, std::vector<std::size_t>> sessions_by_path;
+    for (std::size_t session = 0; session != closures.size(); ++session) {
+        for (const auto& path : closures[session]) {
+            sessions_by_path[path.string()].push_back(session);
+        }
+    }
 
-    std::vector<odrv_report> result;
+    const std::size_t count = object_file_count();
+    scan_sessions result;
+    result._closures.assign(closures.size(), std::vector<bool>(count, false));
+
+    for (std::size_t i = 0; i != count; ++i) {
+        const auto& ancestry = object_file_ancestry(i);
+        if (ancestry.empty()) continue;
 
-    // We now subdivide the work. We do so by looking at the total number of entries
-    // in the map, breaking up the work into chunks, and then issuing a `do_work`
-    // statement on each chunk. This is generally faster than issuing a `do_work`
-    // call for each entry, as there can be _many_ entries, and each `do_work` call
-    // incurs some bookkeeping. (It should go without saying that the die map
-    // should not be modified while this processing happens.) We set the number of
-    // work chunks to be the processor count of the machine, and resize the amount
-    // of work per core.
-    const std::size_t work_size = global_die_map().size();
-    const std::size_t chunk_count = std::thread::hardware_concurrency();
-    const std::size_t chunk_size = std::ceil(work_size / static_cast<float>(chunk_count));
-    std::size_t cur_work = 0;
-    auto first = global_die_map().begin();
-
-    while (cur_work != work_size) {
-        // All but the last chunk will be the same size.
-        // The last one could be up to (chunk_count - 1) smaller.
-        const auto next_chunk_size = std::min(chunk_size, work_size - cur_work);
-        const auto last = std::next(first, next_chunk_size);
-        orc::do_work([_first = first, _last = last, &result]() mutable {
-            for (; _first != _last; ++_first) {
-                _first->second = enforce_odrv_for_die_list(_first->second, result);
+        const std::string path(ancestry.front().view());
+        auto found = sessions_by_path.find(path);
+        if (found == sessions_by_path.end() && ancestry.size() > 1) {
+            const auto names = ancestry.names();
+            found = sessions_by_path.find(path + '(' + std::string(names[1].view()) + ')');
+        }
+        if (found == sessions_by_path.end()) continue;
+
+        for (const auto session : found->second) {
+            result._closures[session][i] = true;
+        }
+    }
+
+    // A session's own copy of an object file may have been aliased to another session's copy, in
+    // which case the dies of the other copy are the session's, too.
+    result._members = result._closures;
+    for (std::size_t i = 0; i != count; ++i) {
+        for (const auto alias : object_file_aliases(i)) {
+            for (std::size_t session = 0; session != closures.size(); ++session) {
+                if (result._closures[session][alias]) result._members[session][i] = true;
             }
-        });
-        cur_work += next_chunk_size;
-        first = last;
+        }
+    }
+
+    return result;
+}
+
+/**************************************************************************************************/
+// Reviews every diverged list in the die map for ODRVs, and returns the lists found to have them.
+// The others are all copies of the same definition.
+std::vector<conflicting_list> review_dies(std::size_t die_count) {
+    TracyMessageL("orc_process: review DIEs for ODRVs");
+
+    // The dies to review are divided up by how many of them there are, not by how many entries
+    // there are in the die map (see `review_shard`.) The grain is small enough to give each
+    // worker several pieces of work, which evens out the load when some lists are much longer
+    // than others. (It should go without saying that the die map should not be modified while
+    // this processing happens.)
+    orc::stats_die_map(global_die_map().size(), global_die_arena().bytes());
+    orc::stats_phase_scope review_phase(orc::stats_phase::review);
+
+    constexpr std::size_t chunks_per_worker_k = 16;
+    constexpr std::size_t min_grain_k = 1024;
+    const std::size_t grain =
+        std::max(min_grain_k, die_count / (orc::queue_size() * chunks_per_worker_k));
+
+    for (std::size_t i = 0; i != die_map::shard_count_k; ++i) {
+        orc::do_work([_index = i, grain] { review_shard(_index, grain); });
     }
 
     orc::block_on_work();
 
-    TracyMessageL("orc_process: Sorting & filtering ODRV reports");
+    return global_conflict_buffers().gather();
+}
+
+/**************************************************************************************************/
+// Registers the dies with `register_pass(pass)`, then reviews and reports on them, once per hash
+// partition (see the `hash_partitions` setting.) After each pass but the last, its dies are freed
+// (see `orc_reset`.) A report holds everything it needs to be emitted, so the reports outlive the
+// dies of their pass. Every pass registers the same inputs, but only the first pass counts them.
+// `expected_symbols` is a guess at how many unique symbols there will be, to size the die map.
+std::vector<odrv_report> process_in_passes(std::size_t expected_symbols,
+                                           const std::function<void(std::size_t)>& register_pass) {
+    const auto& settings = settings::instance();
+    const std::size_t partitions = std::max<std::size_t>(settings._hash_partitions, 1);
+    auto& g = globals::instance();
+    std::size_t object_files{0};
+    std::size_t dies_processed{0};
+    std::size_t dies_skipped{0};
+    std::vector<odrv_report> result;
+
+    for (std::size_t pass = 0; pass != partitions; ++pass) {
+        current_partition() = hash_partition{partitions, pass};
+        global_die_map().reserve(expected_symbols / partitions);
+
+        {
+            orc::stats_phase_scope register_phase(orc::stats_phase::register_dies);
+            register_pass(pass);
+        }
+
+        // What has been registered so far is incomplete, so it is not reviewed.
+        if (g._cancelled) {
+            current_partition() = hash_partition();
+            orc::stats_die_counting(true);
+            return std::vector<odrv_report>();
+        }
+
+        object_file_rank_by_ancestry();
+
+        if (pass == 0) {
+            object_files = g._object_file_count;
+            dies_processed = g._die_processed_count;
+            dies_skipped = g._die_skipped_count;
+            orc::stats_die_counting(false);
+        } else {
+            g._object_file_count = object_files;
+            g._die_processed_count = dies_processed;
+            g._die_skipped_count = dies_skipped;
+        }
+
+        auto conflicts = review_dies(global_die_map().diverged_die_count());
+
+        TracyMessageL("orc_process: generate ODRV reports");
+
+        {
+            orc::stats_phase_scope reports_phase(orc::stats_phase::reports);
+            auto reports = make_reports(std::move(conflicts));
+            result.insert(result.end(), std::make_move_iterator(reports.begin()),
+                          std::make_move_iterator(reports.end()));
+        }
+
+        if (pass + 1 != partitions) orc_reset();
+    }
+
+    current_partition() = hash_partition();
+    orc::stats_die_counting(true);
+
+    if (partitions > 1) {
+        // Each pass's reports are sorted, and no more than the limit, but not so all together.
+        std::stable_sort(result.begin(), result.end(),
+                         [](const auto& a, const auto& b) { return a._symbol < b._symbol; });
+
+        const std::size_t max_count = settings._max_violation_count;
+        if (max_count && result.size() > max_count) {
+            result.erase(result.begin() + max_count, result.end());
+        }
+    }
+
+    return result;
+}
+
+/**************************************************************************************************/
+// Pre-sizing the die map means it rarely (if ever) has to grow while it is being filled. This is a
+// rough guess (one unique symbol per 4KB of input) based on the size of the inputs.
+std::size_t expected_symbols(const std::vector<std::filesystem::path>& inputs) {
+    constexpr std::uintmax_t bytes_per_symbol_k = 4 * 1024;
+    std::uintmax_t input_size{0};
+    for (const auto& input_path : inputs) {
+        std::error_code ec;
+        const auto size = std::filesystem::file_size(input_path, ec);
+        if (!ec) input_size += size;
+    }
+    return input_size / bytes_per_symbol_k;
+}
+
+/**************************************************************************************************/
+
+} // namespace
+
+/**************************************************************************************************/
+// Only the first pass saves the die cache; the others would only save the same objects again. (In
+// dylib scan mode the dependencies aren't known before the first pass, so only the roots are
+// counted toward the size of the die map, and the first pass records the dependencies it
+// discovers for the rest, along with the closure of each root, if they are to be reviewed one at
+// a time.)
+std::vector<odrv_report> orc_process(std::vector<std::filesystem::path>&& file_list) {
+    TracyMessageL("orc_process: process all DIEs");
+
+    const auto& settings = settings::instance();
+    const bool multiple_passes = settings._hash_partitions > 1;
+    const bool sessions =
+        settings._dylib_scan_mode && settings._dylib_scan_sessions && file_list.size() > 1;
+    std::vector<std::filesystem::path> discovered;
+    std::vector<std::vector<std::filesystem::path>> closures;
+
+    orc::die_cache_load();
+
+    auto result = process_in_passes(expected_symbols(file_list), [&](std::size_t pass) {
+        if (pass == 0) {
+            register_inputs(file_list, settings._dylib_scan_mode,
+                            multiple_passes ? &discovered : nullptr,
+                            sessions ? &closures : nullptr);
+        } else {
+            register_inputs(settings._dylib_scan_mode ? discovered : file_list, false, nullptr,
+                            nullptr);
+        }
+
+        // An incomplete registration is not saved.
+        if (globals::instance()._cancelled) return;
+
+        // Each pass registers the object files anew, so their closures are found anew, too.
+        if (sessions) current_sessions() = make_sessions(closures);
+
+        if (pass == 0) {
+            orc::die_cache_save();
+        } else {
+            orc::die_cache_discard();
+        }
+    });
 
-    std::sort(result.begin(), result.end(),
-              [](const odrv_report& a, const odrv_report& b) { return a._symbol < b._symbol; });
+    current_sessions() = scan_sessions();
 
     return result;
 }
 
 /**************************************************************************************************/
 
+void orc_emit_index(std::vector<std::filesystem::path>&& file_list,
+                    const std::filesystem::path& index_path) {
+    TracyMessageL("orc_emit_index: process all DIEs");
+
+    global_die_map().reserve(expected_symbols(file_list));
+
+    orc::die_cache_load();
+
+    {
+        orc::stats_phase_scope register_phase(orc::stats_phase::register_dies);
+        register_inputs(file_list, settings::instance()._dylib_scan_mode, nullptr, nullptr);
+    }
+
+    if (globals::instance()._cancelled) return;
+
+    orc::die_cache_save();
+    orc::stats_die_map(global_die_map().size(), global_die_arena().bytes());
+
+    TracyMessageL("orc_emit_index: write the index");
+
+    orc::stats_phase_scope output_phase(orc::stats_phase::output);
+    orc::die_index_write(index_path);
+}
+
+/**************************************************************************************************/
+// The indices are read in parallel, and again for every pass.
+std::vector<odrv_report> orc_merge(const std::vector<std::filesystem::path>& index_paths) {
+    TracyMessageL("orc_merge: read die indices");
+
+    // An index holds about as many bytes per die as an object file holds per symbol (see
+    // `expected_symbols`), and does not have the debug info in between them.
+    constexpr std::size_t bytes_per_die_k = 64;
+    constexpr std::size_t dies_per_symbol_k = 4;
+    std::size_t index_size{0};
+    for (const auto& index_path : index_paths) {
+        std::error_code ec;
+        const auto size = std::filesystem::file_size(index_path, ec);
+        if (!ec) index_size += size;
+    }
+
+    return process_in_passes(index_size / bytes_per_die_k / dies_per_symbol_k, [&](std::size_t) {
+        std::mutex error_mutex;
+        std::exception_ptr error;
+
+        for (const auto& index_path : index_paths) {
+            orc::do_work([&, _path = index_path] {
+                try {
+                    orc::die_index_read(_path);
+                } catch (...) {
+                    std::lock_guard lock(error_mutex);
+                    if (!error) error = std::current_exception();
+                }
+            });
+        }
+
+        orc::block_on_work();
+
+        if (error) std::rethrow_exception(error);
+    });
+}
+
+/**************************************************************************************************/
+
 void to_json(nlohmann::json& j, const attribute_value& a) {
     // limitation: only one of these types will be output,
     // though I haven't seen a case where more than one is needed.
@@ -576,23 +1788,28 @@ void to_json(nlohmann::json& j, const attribute_sequence& a) {
     }
 }
 
-void to_json(nlohmann::json& j, const odrv_report::conflict_details& c) {
+void to_json(nlohmann::json& j, const odrv_report& p, const odrv_report::conflict_details& c) {
     j["count"] = c._count;
     j["attributes"] = c._attributes;
-    const auto& locations = c._locations;
     auto& instances = j["locations"];
-    for (const auto& location : sorted_keys(locations)) {
-        const std::string location_str = location.file.allocate_string() + ":" + std::to_string(location.loc);
-        auto& location_json = instances[location_str];
-        for (const auto& ancestry : locations.at(location)) {
-            auto* node = &location_json;
-            for (std::size_t i = 0; i < ancestry._count; ++i) {
-                const std::string key = ancestry._ancestors[i].allocate_string();
-                if (i == (ancestry._count - 1)) {
-                    (*node)["object_files"].push_back(key);
-                } else {
-                    node = &(*node)[key];
-                }
+    const odrv_report::instance* previous = nullptr;
+    nlohmann::json* location_json = nullptr;
+    for (const auto& instance : p.instances(c)) {
+        if (!previous || previous->_location != instance._location) {
+            const auto& location = instance._location;
+            const std::string location_str = location.file.allocate_string() + ":" + std::to_string(location.loc);
+            location_json = &instances[location_str];
+        }
+        previous = &instance;
+
+        auto* node = location_json;
+        const auto names = object_file_ancestry(instance._ofd_index).names();
+        for (std::size_t i = 0; i < names.size(); ++i) {
+            const std::string key = names[i].allocate_string();
+            if (i == (names.size() - 1)) {
+                (*node)["object_files"].push_back(key);
+            } else {
+                node = &(*node)[key];
             }
         }
     }
@@ -605,9 +1822,10 @@ void to_json(nlohmann::json& j, const odrv_report& p) {
         j["attributes"].push_back(p.category(i));
     }
 
-    const auto& conflicts = p.conflict_map();
-    for (const auto& entry : sorted_keys(conflicts)) {
-        j["definitions"].push_back(conflicts.at(entry));
+    for (const auto& conflict : p.conflicts()) {
+        nlohmann::json definition;
+        to_json(definition, p, conflict);
+        j["definitions"].push_back(std::move(definition));
     }
 }
 
@@ -617,74 +1835,163 @@ namespace orc {
 
 /**************************************************************************************************/
 
-void register_dies(dies die_vector) {
-    ZoneScoped;
+void register_die(die&& x) {
+    assert(!x._skippable);
 
-    globals::instance()._die_processed_count += die_vector.size();
+    if (!current_partition().contains(x._hash)) return;
 
-    // pre-process the vector of dies by partitioning them into those that are skippable and those
-    // that are not. Then, we erase the skippable ones and shrink the vector to fit, which will
-    // cause a reallocation and copying of only the necessary dies into a vector whose memory
-    // consumption is exactly what's needed.
+    die& d = global_die_arena().emplace(std::move(x));
 
-    auto unskipped_end =
-        std::partition(die_vector.begin(), die_vector.end(), std::not_fn(&die::_skippable));
+    if (global_die_map().insert(&d)) {
+        ++globals::instance()._unique_symbol_count;
+    }
+}
 
-    std::size_t skip_count = std::distance(unskipped_end, die_vector.end());
+/**************************************************************************************************/
 
-    die_vector.erase(unskipped_end, die_vector.end());
-    die_vector.shrink_to_fit();
+void for_each_registered_die(const std::function<void(const die&)>& f) {
+    auto& map = global_die_map();
 
-    // This is a list so the die vectors don't move about. The dies become pretty entangled as they
-    // point to one another by reference, and the odr_map itself stores const pointers to the dies
-    // it registers. Thus, we move our incoming die_vector to the end of this list, and all the
-    // pointers we use will stay valid for the lifetime of the application.
-    dies& dies = *with_global_die_collection([&](auto& collection) {
-        collection.push_back(std::move(die_vector));
-        return --collection.end();
-    });
+    for (std::size_t i = 0; i != die_map::shard_count_k; ++i) {
+        map.for_each_in_shard(i, 0, map.capacity(i), [&](die*& head) {
+            for (const die* d = head; d; d = d->_next_die) {
+                f(*d);
+            }
+        });
+    }
+}
+
+/**************************************************************************************************/
 
-    for (auto& d : dies) {
-        assert(!d._skippable);
+namespace {
 
-        //
-        // At this point we know we're going to register the die. Hereafter belongs
-        // work exclusive to DIEs getting registered/odr-enforced.
-        //
+/**************************************************************************************************/
 
-        auto result = global_die_map().insert(std::make_pair(d._hash, &d));
-        if (result.second) {
-            ++globals::instance()._unique_symbol_count;
-            continue;
-        }
+#ifndef NDEBUG
+constexpr int json_indent_k = 2; // pretty-print in debug builds
+#else
+constexpr int json_indent_k = 0; // no indentation in release builds (there are still newlines)
+#endif
+
+// The JSON for `j`, as it would be printed `depth` levels deep into the document.
+std::string json_at_depth(const nlohmann::json& j, std::size_t depth) {
+    std::string result = j.dump(json_indent_k);
+    const std::string newline = "\n" + std::string(depth * json_indent_k, ' ');
+    for (std::size_t p = result.find('\n'); p != std::string::npos; p = result.find('\n', p + 1)) {
+        result.replace(p, 1, newline);
+        p += newline.size() - 1;
+    }
+
+    return result;
+}
+
+// A key and its value, the way `dump` prints a member of an object `depth` levels deep.
+std::string json_member(std::string_view key, const std::string& value, std::size_t depth) {
+    std::string result = "\n" + std::string(depth * json_indent_k, ' ');
+    result += nlohmann::json(key).dump();
+    result += ": ";
+    result += value;
+    return result;
+}
 
-        constexpr auto mutex_count_k = 67; // prime; to help reduce any hash bias
-        static std::mutex mutexes_s[mutex_count_k];
-        std::lock_guard<std::mutex> lock(mutexes_s[d._hash % mutex_count_k]);
+// The nonempty buckets of the histogram, as `[at least, count]` pairs.
+nlohmann::json histogram_json(const stats_histogram& histogram) {
+    nlohmann::json result = nlohmann::json::array();
+    for (std::size_t i = 0; i != histogram.size(); ++i) {
+        if (!histogram[i]) continue;
+        result.push_back({i ? std::size_t(1) << i : 0, histogram[i]});
+    }
+    return result;
+}
+
+// The die counts (see `stats_die_counts`) for the synopsis.
+nlohmann::json die_counts_json() {
+    const auto counts = stats_die_counts_sum();
+    nlohmann::json result;
+
+    auto& reasons = result["skipped_by_reason"];
+    reasons = nlohmann::json::object_t();
+    for (std::size_t i = 0; i != counts._skipped_by_reason.size(); ++i) {
+        reasons[to_string(static_cast<skip_reason>(i))] = counts._skipped_by_reason[i];
+    }
 
-        die& d_in_map = *result.first->second;
-        d._next_die = d_in_map._next_die;
-        d_in_map._next_die = &d;
+    auto& tags = result["tags"];
+    tags = nlohmann::json::object_t();
+    for (std::size_t i = 0; i != stats_die_counts::tag_count_k; ++i) {
+        const auto registered = counts._registered_by_tag[i];
+        const auto skipped = counts._skipped_by_tag[i];
+        if (!registered && !skipped) continue;
+        const bool other = i == stats_die_counts::tag_count_k - 1;
+        const char* name = other ? "other" : to_string(static_cast<dw::tag>(i));
+        tags[name] = {{"registered", registered}, {"skipped", skipped}};
     }
 
-    globals::instance()._die_skipped_count += skip_count;
+    result["die_list_lengths"] = histogram_json(counts._die_list_lengths);
+    result["object_file_dies"] = histogram_json(counts._object_file_dies);
+
+    return result;
 }
 
 /**************************************************************************************************/
 
-std::string to_json(const std::vector<odrv_report>& reports) {
-#ifndef NDEBUG
-    constexpr auto spaces_k = 2; // pretty-print in debug builds
-#else
-    constexpr auto spaces_k = 0; // no pretty-printing in release builds
-#endif
+} // namespace
 
-    nlohmann::json violations = nlohmann::json::object_t();
+/**************************************************************************************************/
 
-    for (const auto& report : reports) {
-        assert(violations.count(report._symbol) == 0);
-        violations[report._symbol] = report;
+void to_json(std::ostream& out, const std::vector<odrv_report>& reports) {
+    // Each symbol is one member of the violations. Several reports of one symbol (see
+    // `dylib_scan_sessions`) are written under it as an array, in the order they were given.
+    std::vector<std::size_t> groups; // where each symbol's reports start
+    for (std::size_t i = 0; i != reports.size(); ++i) {
+        assert(i == 0 || reports[i - 1]._symbol <= reports[i]._symbol);
+        if (i == 0 || reports[i - 1]._symbol != reports[i]._symbol) groups.push_back(i);
     }
+    groups.push_back(reports.size());
+
+    // The symbols are formatted by the workers in chunks, then written out in order. They're done a
+    // wave of chunks at a time, so no more than a wave's worth of text is held at once.
+    constexpr std::size_t chunk_size_k = 64;
+    const std::size_t group_count = groups.size() - 1;
+    const std::size_t chunk_count = (group_count + chunk_size_k - 1) / chunk_size_k;
+    const std::size_t wave_size = orc::queue_size() * 4;
+    std::vector<std::string> chunks;
+
+    out << '{' << json_member("violations", "{", 1);
+
+    for (std::size_t wave = 0; wave < chunk_count; wave += wave_size) {
+        chunks.assign(std::min(wave_size, chunk_count - wave), std::string());
+
+        for (std::size_t i = 0; i != chunks.size(); ++i) {
+            orc::do_work([&, _chunk = wave + i, &_text = chunks[i]] {
+                const std::size_t first = _chunk * chunk_size_k;
+                const std::size_t last = std::min(first + chunk_size_k, group_count);
+                for (std::size_t g = first; g != last; ++g) {
+                    const auto& report = reports[groups[g]];
+                    const std::size_t count = groups[g + 1] - groups[g];
+                    if (g) _text += ',';
+                    if (count == 1) {
+                        _text += json_member(report._symbol, json_at_depth(report, 2), 2);
+                        continue;
+                    }
+
+                    nlohmann::json group = nlohmann::json::array();
+                    for (std::size_t j = groups[g]; j != groups[g + 1]; ++j) {
+                        group.push_back(reports[j]);
+                    }
+                    _text += json_member(report._symbol, json_at_depth(group, 2), 2);
+                }
+            });
+        }
+
+        orc::block_on_work();
+
+        for (const auto& text : chunks) {
+            out << text;
+        }
+    }
+
+    if (!reports.empty()) out << '\n' << std::string(json_indent_k, ' ');
+    out << '}';
 
     const auto& g = globals::instance();
     nlohmann::json synopsis;
@@ -694,13 +2001,11 @@ std::string to_json(const std::vector<odrv_report>& reports) {
     synopsis["dies_skipped"] = g._die_skipped_count.load();
     synopsis["dies_skipped_pct"] = g._die_processed_count ? (g._die_skipped_count * 100. / g._die_processed_count) : 0;
     synopsis["unique_symbols"] = g._unique_symbol_count.load();
+    synopsis["die_counts"] = die_counts_json();
 
-    nlohmann::json result = nlohmann::json::object_t {
-        { "violations", std::move(violations) },
-        { "synopsis", std::move(synopsis) },
-    };
-
-    return result.dump(spaces_k);
+    // The synopsis goes last, once everything it sums up has been written.
+    out << ',' << json_member("synopsis", json_at_depth(synopsis, 1), 1);
+    out << "\n}";
 }
 
 std::string version_json() {
@@ -720,20 +2025,63 @@ std::string version_json() {
 
 void orc_reset() {
     global_die_map().clear();
-    with_global_die_collection([](auto& collection) { collection.clear(); });
+    global_die_arena().clear();
+    global_dwarf_cache().clear();
+    object_file_forget_contents();
 }
 
 /**************************************************************************************************/
 
-const char* demangle(const char* x) {
-    // The returned char* is good until the next call to demangle() on the same thread.
+namespace {
+
+/**************************************************************************************************/
+// Demangled names, keyed by the hash of the mangled name. Like the string pool's keys, these are
+// never removed: a name is demangled at most once for the life of the application.
+auto& demangled_names() {
+    using entry = std::pair<pool_string, pool_string>; // mangled, demangled
+    static decltype(auto) names_s =
+        orc::make_leaky<tbb::concurrent_unordered_map<std::size_t, entry>>();
+    return names_s;
+}
+
+/**************************************************************************************************/
+
+} // namespace
+
+/**************************************************************************************************/
+
+pool_string demangle(pool_string mangled) {
+    if (mangled.empty()) return mangled;
+
+    auto& names = demangled_names();
+    const auto found = names.find(mangled.hash());
+    if (found != names.end() && found->second.first == mangled) return found->second.second;
+
+    // `__cxa_demangle` writes into the buffer it is given, and `realloc`s it when it is too small,
+    // so each thread's buffer grows to fit the longest name it has seen and is then reused.
     // See: https://gcc.gnu.org/onlinedocs/libstdc++/libstdc++-html-USERS-4.3/a01696.html
-    thread_local std::unique_ptr<char, void (*)(void*)> hold{nullptr, &free};
+    thread_local std::unique_ptr<char, void (*)(void*)> buffer_s{nullptr, &free};
+    thread_local std::size_t capacity_s{0};
     int status = 0;
-    char* p = abi::__cxa_demangle(x, nullptr, nullptr, &status);
-    if (!p || status != 0) return x;
-    hold.reset(p);
-    return p;
+    char* p = abi::__cxa_demangle(mangled.view().data(), buffer_s.get(), &capacity_s, &status);
+    if (p) {
+        (void)buffer_s.release(); // `p` replaces it, or is it.
+        buffer_s.reset(p);
+    }
+
+    const pool_string result = p && status == 0 ? empool(std::string_view(p)) : mangled;
+
+    // On a hash collision the first name in keeps the slot, and the other is never cached.
+    names.emplace(mangled.hash(), std::make_pair(mangled, result));
+
+    return result;
+}
+
+/**************************************************************************************************/
+
+const char* demangle(const char* x) {
+    if (!x || !*x) return x;
+    return demangle(empool(x)).view().data();
 }
 
 /**************************************************************************************************/
@@ -11,8 +11,10 @@
 #include "orc/features.hpp"
 
 // stdc++
+#include <algorithm>
 #include <bit>
 #include <cstdio>
+#include <cstring>
 
 // system
 #include <fcntl.h> // open
@@ -28,6 +30,7 @@
 #include "orc/fat.hpp"
 #include "orc/macho.hpp"
 #include "orc/orc.hpp"
+#include "orc/stats.hpp"
 
 /**************************************************************************************************/
 
@@ -91,15 +94,22 @@ file_details detect_file(freader& s) {
 
 /**************************************************************************************************/
 
-auto mmap_file(const std::filesystem::path& p) {
+auto mmap_file(const std::filesystem::path& p, std::function<void()> on_unmap = nullptr) {
     // using result_type = std::unique_ptr<char, std::function<void(char*)>>;
     using result_type = std::shared_ptr<char>;
     auto size = std::filesystem::file_size(p);
     int fd = open(p.string().c_str(), O_RDONLY);
     void* ptr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
     close(fd);
-    if (ptr == MAP_FAILED) return result_type();
-    auto deleter = [_sz = size](void* x) { munmap(x, _sz); };
+    if (ptr == MAP_FAILED) {
+        if (on_unmap) on_unmap();
+        return result_type();
+    }
+    orc::stats_bytes_mapped(size);
+    auto deleter = [_sz = size, _on_unmap = std::move(on_unmap)](void* x) {
+        munmap(x, _sz);
+        if (_on_unmap) _on_unmap();
+    };
     return result_type(static_cast<char*>(ptr), std::move(deleter));
 }
 
@@ -109,44 +119,94 @@ auto mmap_file(const std::filesystem::path& p) {
 
 /**************************************************************************************************/
 // See https://en.wikipedia.org/wiki/LEB128
-std::uint32_t uleb128(freader& s) {
-    std::uint32_t result{0};
-    std::size_t shift{0};
+namespace {
 
-    while (true) {
-        auto c = s.get();
-        if (shift <
-            32) // shifts above 32 on uint32_t are undefined, but the s.get() needs to continue.
-            result |= (c & 0x7f) << shift;
-        if (!(c & 0x80)) return result;
-        shift += 7;
+/**************************************************************************************************/
+// A decoded LEB128 value, before any sign extension.
+struct leb128 {
+    std::uint64_t _value{0};
+    std::size_t _shift{0}; // 7 times the number of bytes the value took up
+    bool _sign{false}; // the sign bit of the last byte, for `sleb128`
+};
+
+// The fast path. When at least 8 bytes remain, they are read at once, and the end of the value
+// is found by looking for the first byte without its continuation bit. The 7-bit groups are then
+// packed together in three steps, doubling their width each time, rather than one at a time.
+bool leb128_fast(freader& s, leb128& result) {
+    if constexpr (std::endian::native != std::endian::little) {
+        return false;
+    } else {
+        if (s.size() - s.tellg() < sizeof(std::uint64_t)) return false;
+
+        // Most values fit in one byte, so that case gets a (well predicted) branch of its own.
+        // Without it, the position of the next value always waits on the arithmetic below.
+        const auto first = static_cast<std::uint8_t>(*(s.data() + s.tellg()));
+        if (!(first & 0x80)) {
+            result = leb128{first, 7, (first & 0x40) != 0};
+            s.seekg(1, std::ios::cur);
+            return true;
+        }
+
+        std::uint64_t x;
+        std::memcpy(&x, s.data() + s.tellg(), sizeof(x));
+
+        const std::uint64_t ends = ~x & 0x8080808080808080ull;
+        if (!ends) return false; // longer than 8 bytes
+
+        const std::size_t n = (std::countr_zero(ends) >> 3) + 1;
+        const std::uint64_t last = (x >> (8 * (n - 1))) & 0xff;
+
+        if (n < 8) x &= (std::uint64_t(1) << (8 * n)) - 1;
+        x = ((x & 0x7f007f007f007f00ull) >> 1) | (x & 0x007f007f007f007full);
+        x = ((x & 0x3fff00003fff0000ull) >> 2) | (x & 0x00003fff00003fffull);
+        x = ((x & 0x0fffffff00000000ull) >> 4) | (x & 0x000000000fffffffull);
+
+        result = leb128{x, 7 * n, (last & 0x40) != 0};
+        s.seekg(n, std::ios::cur);
+        return true;
     }
 }
 
-/**************************************************************************************************/
-
-std::int32_t sleb128(freader& s) {
-    std::int32_t result{0};
-    std::size_t shift{0};
-    bool sign{false};
+// The slow path, for values near the end of the buffer, or longer than 8 bytes.
+leb128 leb128_slow(freader& s) {
+    leb128 result;
 
     while (true) {
-        auto c = s.get();
-        result |= (c & 0x7f) << shift;
-        shift += 7;
+        const auto c = static_cast<std::uint8_t>(s.get());
+        // Shifts of 64 or more are undefined, but the bytes still need to be read.
+        if (result._shift < 64) result._value |= std::uint64_t(c & 0x7f) << result._shift;
+        result._shift += 7;
         if (!(c & 0x80)) {
-            sign = c & 0x40;
-            break;
+            result._sign = c & 0x40;
+            return result;
         }
     }
+}
 
-    constexpr auto size_k{sizeof(result) * 8};
+leb128 read_leb128(freader& s) {
+    leb128 result;
+    if (leb128_fast(s, result)) return result;
+    return leb128_slow(s);
+}
 
-    if (sign && shift < size_k) {
-        result |= -(1 << shift);
-    }
+/**************************************************************************************************/
+
+} // namespace
+
+/**************************************************************************************************/
 
-    return result;
+std::uint64_t uleb128(freader& s) { return read_leb128(s)._value; }
+
+/**************************************************************************************************/
+
+std::int64_t sleb128(freader& s) {
+    auto result = read_leb128(s);
+
+    // Branchless, as the sign of a value is much harder to predict than its length.
+    const std::uint64_t extend = -std::uint64_t(result._sign & (result._shift < 64));
+    result._value |= extend & (~std::uint64_t(0) << std::min<std::size_t>(result._shift, 63));
+
+    return static_cast<std::int64_t>(result._value);
 }
 
 /**************************************************************************************************/
@@ -183,3 +243,32 @@ freader::freader(const std::filesystem::path& p)
     : _buffer(mmap_file(p)), _f(_buffer.get()), _p(_f), _l(_p + std::filesystem::file_size(p)) {}
 
 /**************************************************************************************************/
+
+freader::freader(const std::filesystem::path& p, std::function<void()> on_unmap)
+    : _buffer(mmap_file(p, std::move(on_unmap))), _f(_buffer.get()), _p(_f),
+      _l(_p + std::filesystem::file_size(p)) {}
+
+/**************************************************************************************************/
+
+void freader::advise(advice a, std::size_t offset, std::size_t size) const {
+    if (!_buffer || size == 0 || offset >= this->size()) return;
+
+    // `madvise` wants a page-aligned address. The mapping starts on a page, so the range is
+    // widened down to the page it starts in.
+    static const std::size_t page_size_s = sysconf(_SC_PAGESIZE);
+    const std::size_t first = offset - offset % page_size_s;
+    const std::size_t last = std::min(offset + size, this->size());
+
+    int flag = MADV_NORMAL;
+    switch (a) {
+        case advice::normal: flag = MADV_NORMAL; break;
+        case advice::sequential: flag = MADV_SEQUENTIAL; break;
+        case advice::random: flag = MADV_RANDOM; break;
+        case advice::willneed: flag = MADV_WILLNEED; break;
+        case advice::dontneed: flag = MADV_DONTNEED; break;
+    }
+
+    (void)madvise(_f + first, last - first, flag);
+}
+
+/**************************************************************************************************/
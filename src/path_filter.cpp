@@ -0,0 +1,131 @@
+// Copyright 2026 Adobe
+// All Rights Reserved.
+//
+// NOTICE: Adobe permits you to use, modify, and distribute this file in accordance with the terms
+// of the Adobe license agreement accompanying it.
+
+// identity
+#include "orc/path_filter.hpp"
+
+// stdc++
+#include <algorithm>
+#include <deque>
+
+/**************************************************************************************************/
+
+namespace orc {
+
+/**************************************************************************************************/
+
+namespace {
+
+/**************************************************************************************************/
+// Prefixes and paths are anchored to the ends of the path by these, which can't appear in one.
+constexpr char path_begin_k = '\x01';
+constexpr char path_end_k = '\x02';
+
+/**************************************************************************************************/
+
+} // namespace
+
+/**************************************************************************************************/
+
+path_filter::path_filter(const std::vector<std::string>& substrings,
+                         const std::vector<std::string>& prefixes,
+                         const std::vector<std::string>& paths) {
+    _nodes.emplace_back(); // the root
+
+    for (const auto& pattern : substrings) {
+        _nodes[insert(pattern)]._rejects_extensions = true;
+    }
+
+    for (const auto& pattern : prefixes) {
+        _nodes[insert(path_begin_k + pattern)]._rejects_extensions = true;
+    }
+
+    for (const auto& pattern : paths) {
+        _nodes[insert(path_begin_k + pattern + path_end_k)]._rejects_path = true;
+    }
+
+    // Failure links, breadth first so each node's are done before its children need them. A node
+    // also matches whatever its failure node matches.
+    std::deque<std::uint32_t> queue;
+
+    for (const auto& [c, next] : _nodes[0]._next) {
+        queue.push_back(next);
+    }
+
+    while (!queue.empty()) {
+        const std::uint32_t state = queue.front();
+        queue.pop_front();
+
+        for (const auto& [c, next] : _nodes[state]._next) {
+            const std::uint32_t fail = step(_nodes[state]._fail, c);
+            _nodes[next]._fail = fail;
+            _nodes[next]._rejects_extensions |= _nodes[fail]._rejects_extensions;
+            _nodes[next]._rejects_path |= _nodes[fail]._rejects_path;
+            queue.push_back(next);
+        }
+    }
+
+    _begin = append(cursor(), std::string_view(&path_begin_k, 1));
+}
+
+/**************************************************************************************************/
+
+std::uint32_t path_filter::insert(std::string_view pattern) {
+    std::uint32_t state = 0;
+
+    for (char c : pattern) {
+        std::uint32_t next = child(state, c);
+        if (!next) {
+            next = static_cast<std::uint32_t>(_nodes.size());
+            _nodes[state]._next.emplace_back(c, next);
+            _nodes.emplace_back();
+        }
+        state = next;
+    }
+
+    return state;
+}
+
+/**************************************************************************************************/
+
+std::uint32_t path_filter::child(std::uint32_t state, char c) const {
+    const auto& next = _nodes[state]._next;
+    auto found = std::find_if(next.begin(), next.end(), [c](const auto& x) { return x.first == c; });
+    return found == next.end() ? 0 : found->second;
+}
+
+/**************************************************************************************************/
+
+std::uint32_t path_filter::step(std::uint32_t state, char c) const {
+    while (true) {
+        if (const std::uint32_t next = child(state, c)) return next;
+        if (state == 0) return 0;
+        state = _nodes[state]._fail;
+    }
+}
+
+/**************************************************************************************************/
+
+path_filter::cursor path_filter::append(cursor c, std::string_view text) const {
+    for (char x : text) {
+        c._state = step(c._state, x);
+        c._rejected |= _nodes[c._state]._rejects_extensions;
+    }
+
+    return c;
+}
+
+/**************************************************************************************************/
+
+bool path_filter::rejects(cursor c) const {
+    return c._rejected || _nodes[step(c._state, path_end_k)]._rejects_path;
+}
+
+/**************************************************************************************************/
+
+} // namespace orc
+
+/**************************************************************************************************/
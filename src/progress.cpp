@@ -0,0 +1,219 @@
+// Copyright 2026 Adobe
+// All Rights Reserved.
+//
+// NOTICE: Adobe permits you to use, modify, and distribute this file in accordance with the terms
+// of the Adobe license agreement accompanying it.
+
+// identity
+#include "orc/progress.hpp"
+
+// stdc++
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <thread>
+
+// system
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#elif defined(__linux__)
+#include <unistd.h>
+#endif
+
+// nlohmann/json
+#include "nlohmann/json.hpp"
+
+// application
+#include "orc/orc.hpp"
+#include "orc/settings.hpp"
+#include "orc/stats.hpp"
+#include "orc/task_system.hpp"
+
+/**************************************************************************************************/
+
+namespace orc {
+
+/**************************************************************************************************/
+
+namespace {
+
+/**************************************************************************************************/
+
+using clock_type = std::chrono::steady_clock;
+
+// The bytes of memory the process has resident, or zero if that is not known.
+std::size_t resident_bytes() {
+#if defined(__APPLE__)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info),
+                  &count) != KERN_SUCCESS) {
+        return 0;
+    }
+    return info.resident_size;
+#elif defined(__linux__)
+    std::ifstream statm("/proc/self/statm");
+    std::size_t size{0};
+    std::size_t resident{0};
+    if (!(statm >> size >> resident)) return 0;
+    return resident * sysconf(_SC_PAGESIZE);
+#else
+    return 0;
+#endif
+}
+
+std::size_t input_bytes(const std::vector<std::filesystem::path>& inputs) {
+    std::size_t result{0};
+    for (const auto& input : inputs) {
+        std::error_code ec;
+        const auto size = std::filesystem::file_size(input, ec);
+        if (!ec) result += size;
+    }
+    return result;
+}
+
+// One sample of the progress of the scan.
+struct sample {
+    clock_type::time_point _time;
+    std::size_t _object_files{0};
+    std::size_t _dies_processed{0};
+    std::size_t _unique_symbols{0};
+    std::size_t _bytes_mapped{0};
+    std::size_t _queued_tasks{0};
+    std::size_t _resident_bytes{0};
+};
+
+sample take_sample() {
+    const auto& g = globals::instance();
+    sample result;
+    result._time = clock_type::now();
+    result._object_files = g._object_file_count;
+    result._dies_processed = g._die_processed_count;
+    result._unique_symbols = g._unique_symbol_count;
+    result._bytes_mapped = stats_bytes_mapped_total();
+    // Without parallel processing there is no task system to ask (and asking would start one.)
+    result._queued_tasks = settings::instance()._parallel_processing ? pts().pending() : 0;
+    result._resident_bytes = resident_bytes();
+    return result;
+}
+
+std::string format_bytes(std::size_t bytes) {
+    std::stringstream result;
+    result << std::fixed << std::setprecision(1) << bytes / (1024. * 1024. * 1024.) << " GB";
+    return std::move(result).str();
+}
+
+/**************************************************************************************************/
+
+} // namespace
+
+/**************************************************************************************************/
+
+struct progress_reporter::implementation {
+    implementation(std::size_t input_bytes, clock_type::duration interval)
+        : _input_bytes(input_bytes), _interval(interval), _start(take_sample()),
+          _previous(_start) {
+        const auto& path = settings::instance()._progress_file;
+        if (!path.empty()) _json.emplace(path, std::ios::app);
+
+        _thread = std::thread([this] { run(); });
+    }
+
+    ~implementation() {
+        {
+            std::lock_guard<std::mutex> lock(_m);
+            _done = true;
+        }
+        _cv.notify_one();
+        _thread.join();
+        report(take_sample());
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(_m);
+        while (!_cv.wait_for(lock, _interval, [this] { return _done; })) {
+            report(take_sample());
+        }
+    }
+
+    void report(const sample& current) {
+        const double elapsed = std::chrono::duration<double>(current._time - _start._time).count();
+        const double since = std::chrono::duration<double>(current._time - _previous._time).count();
+        const auto per_second = [&](std::size_t now, std::size_t before) {
+            return since > 0 && now >= before ? (now - before) / since : 0;
+        };
+        const double files_per_second =
+            per_second(current._object_files, _previous._object_files);
+        const double dies_per_second =
+            per_second(current._dies_processed, _previous._dies_processed);
+
+        // Once more has been mapped than there was input (e.g., by a dylib scan) there's no
+        // telling how much remains.
+        std::optional<double> eta;
+        if (current._bytes_mapped && current._bytes_mapped < _input_bytes) {
+            eta = elapsed * (_input_bytes - current._bytes_mapped) / current._bytes_mapped;
+        }
+
+        _previous = current;
+
+        if (_json) {
+            nlohmann::json line;
+            line["seconds"] = elapsed;
+            line["object_files"] = current._object_files;
+            line["object_files_per_second"] = files_per_second;
+            line["dies_processed"] = current._dies_processed;
+            line["dies_per_second"] = dies_per_second;
+            line["unique_symbols"] = current._unique_symbols;
+            line["queued_tasks"] = current._queued_tasks;
+            line["resident_bytes"] = current._resident_bytes;
+            line["bytes_mapped"] = current._bytes_mapped;
+            line["input_bytes"] = _input_bytes;
+            if (eta) line["eta_seconds"] = *eta;
+            *_json << line.dump() << std::endl;
+            return;
+        }
+
+        // Formatted here, so the precision of the error stream is left alone.
+        std::stringstream line;
+        line << "progress: " << std::fixed << std::setprecision(1) << elapsed << "s: "
+             << current._object_files << " object files (" << files_per_second << "/s), "
+             << current._dies_processed << " dies (" << dies_per_second << "/s), "
+             << current._unique_symbols << " unique symbols, " << current._queued_tasks
+             << " tasks queued, " << format_bytes(current._resident_bytes) << " resident";
+        if (eta) line << ", about " << *eta << "s to go";
+        line << '\n';
+
+        cerr_safe([&](auto& s) { s << line.str(); });
+    }
+
+    const std::size_t _input_bytes;
+    const clock_type::duration _interval;
+    const sample _start;
+    sample _previous;
+    std::optional<std::ofstream> _json;
+    std::mutex _m;
+    std::condition_variable _cv;
+    bool _done{false};
+    std::thread _thread;
+};
+
+/**************************************************************************************************/
+
+progress_reporter::progress_reporter(const std::vector<std::filesystem::path>& inputs) {
+    const std::size_t interval = settings::instance()._progress_interval;
+    if (!interval) return;
+
+    _impl = std::make_unique<implementation>(input_bytes(inputs), std::chrono::seconds(interval));
+}
+
+progress_reporter::~progress_reporter() = default;
+
+/**************************************************************************************************/
+
+} // namespace orc
+
+/**************************************************************************************************/
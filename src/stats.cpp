@@ -0,0 +1,357 @@
+// Copyright 2026 Adobe
+// All Rights Reserved.
+//
+// NOTICE: Adobe permits you to use, modify, and distribute this file in accordance with the terms
+// of the Adobe license agreement accompanying it.
+
+// identity
+#include "orc/stats.hpp"
+
+// stdc++
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// nlohmann/json
+#include "nlohmann/json.hpp"
+
+// application
+#include "orc/memory.hpp"
+#include "orc/object_file_registry.hpp"
+#include "orc/orc.hpp"
+#include "orc/settings.hpp"
+#include "orc/string_pool.hpp"
+
+/**************************************************************************************************/
+
+namespace orc {
+
+/**************************************************************************************************/
+
+namespace {
+
+/**************************************************************************************************/
+
+using clock_type = std::chrono::steady_clock;
+
+constexpr std::size_t slowest_count_k = 10; // object files listed in the stats
+
+constexpr std::array<const char*, static_cast<std::size_t>(stats_phase::count_k)> phase_names_k{
+    "dylib_scan", "register_dies", "review", "reports", "output",
+};
+
+struct phase_times {
+    clock_type::time_point _begin{clock_type::time_point::max()};
+    clock_type::time_point _end{clock_type::time_point::min()};
+
+    bool ran() const { return _begin <= _end; }
+    double seconds() const { return std::chrono::duration<double>(_end - _begin).count(); }
+};
+
+struct slow_object_file {
+    std::uint32_t _ofd_index{0};
+    clock_type::duration _duration{0};
+};
+
+struct stats {
+    std::mutex _m;
+    std::array<phase_times, static_cast<std::size_t>(stats_phase::count_k)> _phases;
+    std::atomic<std::size_t> _bytes_mapped{0};
+    std::size_t _die_map_symbols{0};
+    std::size_t _die_arena_bytes{0};
+    std::vector<slow_object_file> _slowest; // a min-heap of the slowest, by duration
+
+    static bool slower(const slow_object_file& a, const slow_object_file& b) {
+        return a._duration > b._duration;
+    }
+};
+
+stats& global_stats() {
+    static decltype(auto) result = orc::make_leaky<stats>();
+    return result;
+}
+
+auto& phase(stats& s, stats_phase p) { return s._phases[static_cast<std::size_t>(p)]; }
+
+void warn(const std::string& message) {
+    if (!log_level_at_least(settings::log_level::warning)) return;
+    cout_safe([&](auto& s) { s << "warning: stats: " << message << '\n'; });
+}
+
+/**************************************************************************************************/
+// Each thread counts into its own, so the counters are never contended. They are atomic only so
+// they can be summed while other threads are counting.
+struct die_counters {
+    using counter = std::atomic<std::size_t>;
+    template <std::size_t N>
+    using counters = std::array<counter, N>;
+
+    counters<static_cast<std::size_t>(skip_reason::count_k)> _skipped_by_reason{};
+    counters<stats_die_counts::tag_count_k> _registered_by_tag{};
+    counters<stats_die_counts::tag_count_k> _skipped_by_tag{};
+    counters<std::tuple_size_v<stats_histogram>> _die_list_lengths{};
+    counters<std::tuple_size_v<stats_histogram>> _object_file_dies{};
+
+    static void bump(counter& c) {
+        c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    template <std::size_t N>
+    static void sum(const counters<N>& from, std::array<std::size_t, N>& to) {
+        for (std::size_t i = 0; i != N; ++i) {
+            to[i] += from[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    template <std::size_t N>
+    static void reset(counters<N>& x) {
+        for (auto& c : x) {
+            c.store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+std::mutex& die_counters_mutex() {
+    static std::mutex result;
+    return result;
+}
+
+// Never freed, so a thread's counts outlive the thread.
+auto& all_die_counters() {
+    using counters_type = std::vector<std::unique_ptr<die_counters>>;
+    static decltype(auto) result = orc::make_leaky<counters_type>();
+    return result;
+}
+
+die_counters& local_die_counters() {
+    thread_local die_counters& result = []() -> auto& {
+        std::lock_guard<std::mutex> lock(die_counters_mutex());
+        return *all_die_counters().emplace_back(std::make_unique<die_counters>());
+    }();
+    return result;
+}
+
+std::atomic_bool& die_counting() {
+    static std::atomic_bool result{true};
+    return result;
+}
+
+std::size_t tag_bucket(dw::tag tag) {
+    return std::min(static_cast<std::size_t>(tag), stats_die_counts::tag_count_k - 1);
+}
+
+std::size_t histogram_bucket(std::size_t value) {
+    return value ? std::bit_width(value) - 1 : 0;
+}
+
+/**************************************************************************************************/
+
+} // namespace
+
+/**************************************************************************************************/
+
+bool stats_enabled() { return !settings::instance()._stats_file.empty(); }
+
+/**************************************************************************************************/
+
+void stats_phase_begin(stats_phase p) {
+    if (!stats_enabled()) return;
+    auto& s = global_stats();
+    const auto now = clock_type::now();
+    std::lock_guard<std::mutex> lock(s._m);
+    auto& times = phase(s, p);
+    times._begin = std::min(times._begin, now);
+}
+
+void stats_phase_end(stats_phase p) {
+    if (!stats_enabled()) return;
+    auto& s = global_stats();
+    const auto now = clock_type::now();
+    std::lock_guard<std::mutex> lock(s._m);
+    auto& times = phase(s, p);
+    times._end = std::max(times._end, now);
+}
+
+/**************************************************************************************************/
+
+void stats_bytes_mapped(std::size_t size) { global_stats()._bytes_mapped += size; }
+
+std::size_t stats_bytes_mapped_total() { return global_stats()._bytes_mapped.load(); }
+
+/**************************************************************************************************/
+
+void stats_object_file(std::uint32_t ofd_index, clock_type::duration duration) {
+    if (!stats_enabled()) return;
+    auto& s = global_stats();
+    std::lock_guard<std::mutex> lock(s._m);
+    auto& slowest = s._slowest;
+
+    if (slowest.size() == slowest_count_k) {
+        if (duration <= slowest.front()._duration) return;
+        std::pop_heap(slowest.begin(), slowest.end(), stats::slower);
+        slowest.pop_back();
+    }
+
+    slowest.push_back(slow_object_file{ofd_index, duration});
+    std::push_heap(slowest.begin(), slowest.end(), stats::slower);
+}
+
+/**************************************************************************************************/
+
+void stats_die_map(std::size_t symbol_count, std::size_t arena_bytes) {
+    if (!stats_enabled()) return;
+    auto& s = global_stats();
+    std::lock_guard<std::mutex> lock(s._m);
+    s._die_map_symbols = std::max(s._die_map_symbols, symbol_count);
+    s._die_arena_bytes = std::max(s._die_arena_bytes, arena_bytes);
+}
+
+/**************************************************************************************************/
+
+void stats_reset() {
+    auto& s = global_stats();
+    std::lock_guard<std::mutex> lock(s._m);
+    s._phases = decltype(s._phases)();
+    s._bytes_mapped = 0;
+    s._die_map_symbols = 0;
+    s._die_arena_bytes = 0;
+    s._slowest.clear();
+}
+
+/**************************************************************************************************/
+
+void stats_write() {
+    if (!stats_enabled()) return;
+
+    auto& s = global_stats();
+    const auto& g = globals::instance();
+    std::lock_guard<std::mutex> lock(s._m);
+    nlohmann::json result;
+
+    auto& phases = result["phases"];
+    phases = nlohmann::json::object_t();
+    for (std::size_t i = 0; i != phase_names_k.size(); ++i) {
+        if (s._phases[i].ran()) phases[phase_names_k[i]] = s._phases[i].seconds();
+    }
+
+    const auto& registering = phase(s, stats_phase::register_dies);
+    const double registering_seconds = registering.ran() ? registering.seconds() : 0;
+
+    result["bytes_mapped"] = s._bytes_mapped.load();
+    result["object_files"] = g._object_file_count.load();
+    result["dies_processed"] = g._die_processed_count.load();
+    result["dies_skipped"] = g._die_skipped_count.load();
+    result["dies_per_second"] =
+        registering_seconds > 0 ? g._die_processed_count / registering_seconds : 0;
+
+    const auto pool = empool_statistics();
+    auto& string_pool = result["string_pool"];
+    string_pool["bytes"] = pool._bytes;
+    string_pool["lookups"] = pool._lookups;
+    string_pool["hits"] = pool._hits;
+    string_pool["hit_rate"] = pool._lookups ? static_cast<double>(pool._hits) / pool._lookups : 0;
+
+    auto& die_map = result["die_map"];
+    die_map["symbols"] = s._die_map_symbols;
+    die_map["arena_bytes"] = s._die_arena_bytes;
+
+    auto slowest = s._slowest;
+    std::sort(slowest.begin(), slowest.end(), stats::slower);
+    auto& slowest_json = result["slowest_object_files"];
+    slowest_json = nlohmann::json::array();
+    for (const auto& entry : slowest) {
+        std::stringstream ss;
+        ss << object_file_ancestry(entry._ofd_index);
+        slowest_json.push_back({
+            {"object_file", std::move(ss).str()},
+            {"seconds", std::chrono::duration<double>(entry._duration).count()},
+        });
+    }
+
+    const std::string& path = settings::instance()._stats_file;
+    std::ofstream output(path);
+    output << result.dump(2) << '\n';
+    if (!output) warn("could not write " + path);
+}
+
+/**************************************************************************************************/
+
+const char* to_string(skip_reason reason) {
+    switch (reason) {
+        case skip_reason::tag: return "tag";
+        case skip_reason::internal_subprogram: return "internal_subprogram";
+        case skip_reason::path: return "path";
+        case skip_reason::objc_class: return "objc_class";
+        case skip_reason::self_referential_type: return "self_referential_type";
+        case skip_reason::count_k: break;
+    }
+    return "unknown";
+}
+
+/**************************************************************************************************/
+
+void stats_die_registered(dw::tag tag) {
+    if (!die_counting().load(std::memory_order_relaxed)) return;
+    die_counters::bump(local_die_counters()._registered_by_tag[tag_bucket(tag)]);
+}
+
+void stats_die_skipped(dw::tag tag, skip_reason reason) {
+    if (!die_counting().load(std::memory_order_relaxed)) return;
+    auto& counters = local_die_counters();
+    die_counters::bump(counters._skipped_by_tag[tag_bucket(tag)]);
+    die_counters::bump(counters._skipped_by_reason[static_cast<std::size_t>(reason)]);
+}
+
+void stats_die_list(std::size_t length) {
+    die_counters::bump(local_die_counters()._die_list_lengths[histogram_bucket(length)]);
+}
+
+void stats_object_file_dies(std::size_t count) {
+    if (!die_counting().load(std::memory_order_relaxed)) return;
+    die_counters::bump(local_die_counters()._object_file_dies[histogram_bucket(count)]);
+}
+
+/**************************************************************************************************/
+
+void stats_die_counting(bool enabled) { die_counting() = enabled; }
+
+/**************************************************************************************************/
+
+stats_die_counts stats_die_counts_sum() {
+    stats_die_counts result;
+    std::lock_guard<std::mutex> lock(die_counters_mutex());
+
+    for (const auto& counters : all_die_counters()) {
+        die_counters::sum(counters->_skipped_by_reason, result._skipped_by_reason);
+        die_counters::sum(counters->_registered_by_tag, result._registered_by_tag);
+        die_counters::sum(counters->_skipped_by_tag, result._skipped_by_tag);
+        die_counters::sum(counters->_die_list_lengths, result._die_list_lengths);
+        die_counters::sum(counters->_object_file_dies, result._object_file_dies);
+    }
+
+    return result;
+}
+
+void stats_die_counts_reset() {
+    std::lock_guard<std::mutex> lock(die_counters_mutex());
+
+    for (auto& counters : all_die_counters()) {
+        die_counters::reset(counters->_skipped_by_reason);
+        die_counters::reset(counters->_registered_by_tag);
+        die_counters::reset(counters->_skipped_by_tag);
+        die_counters::reset(counters->_die_list_lengths);
+        die_counters::reset(counters->_object_file_dies);
+    }
+}
+
+/**************************************************************************************************/
+
+} // namespace orc
+
+/**************************************************************************************************/
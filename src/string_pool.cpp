@@ -8,7 +8,9 @@
 #include "orc/string_pool.hpp"
 
 // stdc++
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
 #include <cstring>
 #include <memory>
@@ -19,6 +21,7 @@
 
 // tbb
 #include <tbb/concurrent_unordered_map.h>
+#include <tbb/spin_rw_mutex.h>
 
 // application
 #include "orc/features.hpp"
@@ -32,6 +35,11 @@
 #define ORC_PRIVATE_FEATURE_PROFILE_POOL_MUTEXES() (ORC_PRIVATE_FEATURE_TRACY() && 0)
 #define ORC_PRIVATE_FEATURE_PROFILE_EMPOOL() (ORC_PRIVATE_FEATURE_TRACY() && 0)
 
+// When enabled, each thread empools strings into ponds of its own, and publishes them into an
+// open-addressed table with a compare-and-swap. Otherwise, strings go into one of
+// `string_pool_count_k` pools, each behind a mutex.
+#define ORC_PRIVATE_FEATURE_LOCK_FREE_STRING_POOL() (1)
+
 /**************************************************************************************************/
 
 namespace {
@@ -43,7 +51,7 @@ constexpr int string_pool_count_k = 23;
 /**************************************************************************************************/
 
 std::size_t string_view_hash(std::string_view s) {
-    return orc::murmur3_64(s.data(), static_cast<std::uint32_t>(s.length()));
+    return orc::string_hash(s.data(), s.length());
 }
 
 /**************************************************************************************************/
@@ -55,6 +63,296 @@ std::size_t string_view_hash(std::string_view s) {
 // The _data pointer is returned to a null terminated string, to make debugging easier
 // get_size() and get_hash() unpack this data as needed.
 //
+constexpr std::size_t string_prefix_size_k = sizeof(std::uint32_t) + sizeof(std::size_t);
+
+std::size_t laid_out_size(std::size_t n) { return n + string_prefix_size_k + 1; }
+
+// Lays the string out at `p`, which must have `laid_out_size(s.size())` bytes available, and
+// returns the pointer to its characters.
+const char* lay_out(char* p, std::string_view s, std::size_t h) {
+    const uint32_t sz = (uint32_t)s.size();
+    // Memory isn't aligned - need to memcpy to pack the data
+    std::memcpy(p, &sz, sizeof(uint32_t));
+    std::memcpy(p + sizeof(uint32_t), &h, sizeof(size_t));
+    std::memcpy(p + string_prefix_size_k, s.data(), sz);
+    *(p + string_prefix_size_k + sz) = 0; // null terminate for debugging
+    return p + string_prefix_size_k;
+}
+
+std::size_t laid_out_hash(const char* data) {
+    return orc::unaligned_read<std::size_t>(data - sizeof(std::size_t));
+}
+
+// Hashes can collide, so a string found by its hash still has to be compared. The length and the
+// first few bytes rule out nearly every mismatch before the full comparison.
+bool laid_out_equal(const char* data, std::string_view s) {
+    if (orc::unaligned_read<std::uint32_t>(data - string_prefix_size_k) != s.size()) return false;
+    const std::size_t n = std::min<std::size_t>(s.size(), sizeof(std::uint64_t));
+    if (std::memcmp(data, s.data(), n) != 0) return false;
+    return std::memcmp(data + n, s.data() + n, s.size() - n) == 0;
+}
+
+/**************************************************************************************************/
+// For `empool_statistics`. Each thread counts into counters of its own (so counting costs no more
+// than an uncontended store), and they are summed when asked for.
+struct pool_counters {
+    std::atomic<std::size_t> _lookups{0};
+    std::atomic<std::size_t> _misses{0};
+
+    static void bump(std::atomic<std::size_t>& counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+};
+
+std::mutex& pool_counters_mutex() {
+    static std::mutex result;
+    return result;
+}
+
+// Never freed, so a thread's counts outlive the thread.
+auto& all_pool_counters() {
+    using counters_type = std::vector<std::unique_ptr<pool_counters>>;
+    static decltype(auto) result = orc::make_leaky<counters_type>();
+    return result;
+}
+
+pool_counters& local_pool_counters() {
+    thread_local pool_counters& result = []() -> auto& {
+        std::lock_guard<std::mutex> lock(pool_counters_mutex());
+        return *all_pool_counters().emplace_back(std::make_unique<pool_counters>());
+    }();
+    return result;
+}
+
+std::atomic<std::size_t>& pool_bytes() {
+    static std::atomic<std::size_t> result{0};
+    return result;
+}
+
+/**************************************************************************************************/
+
+#if ORC_FEATURE(LOCK_FREE_STRING_POOL)
+
+/**************************************************************************************************/
+// A thread's ponds are only ever handed out to that thread. The ponds themselves are never freed,
+// as the strings in them live as long as the application does.
+struct pond {
+    char* _p{nullptr};
+    std::size_t _n{0};
+    std::size_t _size{0};
+
+    static void keep(std::unique_ptr<char[]>&& pond) {
+        using ponds_type = std::vector<std::unique_ptr<char[]>>;
+        static decltype(auto) ponds = orc::make_leaky<ponds_type>();
+        static std::mutex m;
+        std::lock_guard<std::mutex> lock(m);
+        ponds.push_back(std::move(pond));
+    }
+
+    const char* empool(std::string_view incoming, std::size_t h) {
+        const std::size_t tsz = laid_out_size(incoming.size());
+
+        if (_n < tsz) {
+            // As with the mutex-guarded pools, grow exponentially.
+            _n = std::max<std::size_t>(_size * 2, tsz);
+            auto fresh = std::make_unique<char[]>(_n);
+            _p = fresh.get();
+            _size += _n;
+            pool_bytes() += _n;
+            keep(std::move(fresh));
+        }
+
+        const char* result = lay_out(_p, incoming, h);
+        _n -= tsz;
+        _p += tsz;
+        return result;
+    }
+
+    // Gives back the string most recently empooled by this thread.
+    void release(const char* data) {
+        const auto size = orc::unaligned_read<std::uint32_t>(data - string_prefix_size_k);
+        const std::size_t tsz = laid_out_size(size);
+        assert(data - string_prefix_size_k + tsz == _p);
+        _p -= tsz;
+        _n += tsz;
+    }
+};
+
+pond& local_pond() {
+    thread_local pond result;
+    return result;
+}
+
+/**************************************************************************************************/
+// Maps string hashes to the empooled string with that hash. Each slot holds the pointer to a
+// string's characters (its hash is right before them), or null if the slot is empty. Slots are
+// claimed with a compare-and-swap, so threads only ever wait on one another when a shard of the
+// table grows.
+//
+// Two strings with the same hash are both entered (in different slots), so a collision never
+// merges two strings into one. That is unlike the mutex-guarded variant below, which trusts the
+// hash.
+class intern_table {
+    static constexpr std::size_t shard_bits_k = 6;
+    static constexpr std::size_t shard_count_k = std::size_t(1) << shard_bits_k;
+    static constexpr std::size_t min_capacity_k = 4096; // slots per shard; must be a power of two
+
+    using slot = std::atomic<const char*>;
+
+    struct shard {
+        tbb::spin_rw_mutex _m;
+        std::unique_ptr<slot[]> _slots{new slot[min_capacity_k]()};
+        std::size_t _capacity{min_capacity_k};
+        std::atomic<std::size_t> _size{0};
+    };
+
+    std::unique_ptr<shard[]> _shards{new shard[shard_count_k]};
+    std::atomic<std::size_t> _collisions{0};
+
+    static std::size_t shard_index(std::size_t h) { return h >> (64 - shard_bits_k); }
+
+    void collided() {
+        const std::size_t n = _collisions.fetch_add(1, std::memory_order_relaxed) + 1;
+        TracyPlot("string pool collisions", static_cast<int64_t>(n));
+        (void)n;
+    }
+
+    // Returns the string `s` (whose hash is `h`). If it is not there and `data` is not null,
+    // `data` is entered as that string, and `claimed` is set. Returns null if the string is not
+    // there (and `data` is null), or if there is no room for it.
+    const char* probe(slot* slots,
+                      std::size_t capacity,
+                      std::size_t h,
+                      std::string_view s,
+                      const char* data,
+                      bool& claimed) {
+        const std::size_t mask = capacity - 1;
+
+        for (std::size_t i = 0, n = h & mask; i != capacity; ++i, n = (n + 1) & mask) {
+            const char* found = slots[n].load(std::memory_order_acquire);
+
+            if (!found) {
+                if (!data) return nullptr;
+                if (slots[n].compare_exchange_strong(found, data, std::memory_order_acq_rel)) {
+                    claimed = true;
+                    return data;
+                }
+                // Lost the race for the slot; `found` now holds the winner.
+            }
+
+            if (laid_out_hash(found) != h) continue;
+            if (laid_out_equal(found, s)) return found;
+            collided();
+        }
+
+        return nullptr;
+    }
+
+    static void grow(shard& s, std::size_t capacity) {
+        tbb::spin_rw_mutex::scoped_lock lock(s._m, true);
+        if (s._capacity != capacity) return; // someone else beat us to it.
+
+        const std::size_t new_capacity = capacity * 2;
+        const std::size_t mask = new_capacity - 1;
+        std::unique_ptr<slot[]> slots(new slot[new_capacity]());
+
+        for (std::size_t i = 0; i != s._capacity; ++i) {
+            const char* data = s._slots[i].load(std::memory_order_relaxed);
+            if (!data) continue;
+            std::size_t n = laid_out_hash(data) & mask;
+            while (slots[n].load(std::memory_order_relaxed)) {
+                n = (n + 1) & mask;
+            }
+            slots[n].store(data, std::memory_order_relaxed);
+        }
+
+        s._slots = std::move(slots);
+        s._capacity = new_capacity;
+    }
+
+public:
+    const char* find(std::string_view str, std::size_t h) {
+        shard& s = _shards[shard_index(h)];
+        tbb::spin_rw_mutex::scoped_lock lock(s._m, false);
+        bool claimed{false};
+        return probe(s._slots.get(), s._capacity, h, str, nullptr, claimed);
+    }
+
+    // Enters `data` (laid out as `str`, whose hash is `h`), unless `str` is already in the table.
+    // Returns the string the table ends up with for `str`.
+    const char* insert(std::string_view str, std::size_t h, const char* data) {
+        shard& s = _shards[shard_index(h)];
+
+        while (true) {
+            const char* result;
+            bool claimed{false};
+            std::size_t capacity;
+            {
+                tbb::spin_rw_mutex::scoped_lock lock(s._m, false);
+                capacity = s._capacity;
+                result = probe(s._slots.get(), capacity, h, str, data, claimed);
+            }
+
+            // Keep the load factor at or below 3/4.
+            const bool over_full = claimed && (s._size.fetch_add(1) + 1) * 4 > capacity * 3;
+
+            if (!result || over_full) grow(s, capacity);
+
+            if (result) return result;
+        }
+    }
+};
+
+intern_table& table() {
+    static decltype(auto) result = orc::make_leaky<intern_table>();
+    return result;
+}
+
+/**************************************************************************************************/
+
+const char* intern(std::string_view src, std::size_t h) {
+#if ORC_FEATURE(PROFILE_EMPOOL)
+    ZoneScoped;
+    ZoneColor(tracy::Color::ColorType::Green); // cache hit
+    ZoneText(src.data(), src.size());
+#endif // ORC_FEATURE(PROFILE_EMPOOL)
+
+    auto& t = table();
+
+    if (const char* c = t.find(src, h)) return c;
+
+    // Not already interned. Copy it into our own pond, then try to publish it. If another thread
+    // published the same string in the meantime, use theirs and give our copy back.
+    auto& p = local_pond();
+    const char* ptr = p.empool(src, h);
+    const char* result = t.insert(src, h, ptr);
+
+    if (result != ptr) {
+#if ORC_FEATURE(PROFILE_EMPOOL)
+        ZoneColor(tracy::Color::ColorType::Orange); // cache "half-hit"
+#endif // ORC_FEATURE(PROFILE_EMPOOL)
+        p.release(ptr);
+    } else {
+        pool_counters::bump(local_pool_counters()._misses);
+#if ORC_FEATURE(PROFILE_EMPOOL)
+        ZoneColor(tracy::Color::ColorType::Red); // cache miss
+#endif // ORC_FEATURE(PROFILE_EMPOOL)
+    }
+
+    return result;
+}
+
+const char* adopt(const char* data, std::size_t h) {
+    const auto size = orc::unaligned_read<std::uint32_t>(data - string_prefix_size_k);
+    return table().insert(std::string_view(data, size), h, data);
+}
+
+/**************************************************************************************************/
+
+#else
+
+/**************************************************************************************************/
+
 struct pool {
     char* _p{nullptr};
     std::size_t _n{0};
@@ -70,9 +368,8 @@ struct pool {
     ponds_type _ponds{orc::make_leaky<ponds_type>()};
 #endif // ORC_FEATURE(LEAKY_MEMORY)
 
-    const char* empool(std::string_view incoming) {
-        const uint32_t sz = (uint32_t)incoming.size();
-        const uint32_t tsz = sz + sizeof(uint32_t) + sizeof(size_t) + 1;
+    const char* empool(std::string_view incoming, std::size_t h) {
+        const std::size_t tsz = laid_out_size(incoming.size());
 
         if (_n < tsz) {
             // grow the pool's ponds exponentially. This will strike a balance between
@@ -82,6 +379,7 @@ struct pool {
             _ponds.push_back(std::make_unique<char[]>(_n));
             _p = _ponds.back().get();
             _size += _n;
+            pool_bytes() += _n;
 
 #if ORC_FEATURE(PROFILE_POOL_MEMORY)
             assert(_id);
@@ -89,14 +387,7 @@ struct pool {
 #endif // ORC_FEATURE(PROFILE_POOL_MEMORY)
         }
 
-        const std::size_t h = string_view_hash(incoming);
-        // Memory isn't aligned - need to memcpy to pack the data
-        std::memcpy(_p, &sz, sizeof(uint32_t));
-        std::memcpy(_p + sizeof(uint32_t), &h, sizeof(size_t));
-        std::memcpy(_p + sizeof(uint32_t) + sizeof(size_t), incoming.data(), sz);
-        *(_p + tsz - 1) = 0; // null terminate for debugging
-
-        const char* result = _p + sizeof(uint32_t) + sizeof(size_t);
+        const char* result = lay_out(_p, incoming, h);
         _n -= tsz;
         _p += tsz;
         return result;
@@ -159,6 +450,75 @@ auto& pool(std::size_t index) {
 
 /**************************************************************************************************/
 
+auto& pool_keys() {
+    static decltype(auto) keys =
+        orc::make_leaky<tbb::concurrent_unordered_map<size_t, const char*>>();
+    return keys;
+}
+
+const char* find_key(std::size_t h) {
+    const auto& keys = pool_keys();
+    const auto found = keys.find(h);
+    return found == keys.end() ? nullptr : found->second;
+}
+
+/**************************************************************************************************/
+
+const char* intern(std::string_view src, std::size_t h) {
+#if ORC_FEATURE(PROFILE_EMPOOL)
+    ZoneScoped;
+    ZoneColor(tracy::Color::ColorType::Green); // cache hit
+    ZoneText(src.data(), src.size());
+#endif // ORC_FEATURE(PROFILE_EMPOOL)
+
+    if (const char* c = find_key(h)) return c;
+
+    const int index = h % string_pool_count_k;
+    std::lock_guard<string_pool_mutex> pool_guard(pool_mutex(index));
+
+    // Now that we have the lock, do the search again in case another thread empooled the string
+    // while we were waiting for the lock.
+    if (const char* c = find_key(h)) {
+#if ORC_FEATURE(PROFILE_EMPOOL)
+        ZoneColor(tracy::Color::ColorType::Orange); // cache "half-hit"
+#endif // ORC_FEATURE(PROFILE_EMPOOL)
+        return c;
+    }
+
+    // Not already interned; empool it and add to the 'keys'
+    // The pools are not threadsafe, so we need one per mutex
+    const char* ptr = pool(index).empool(src, h);
+    assert(ptr);
+    pool_keys().insert(std::make_pair(h, ptr));
+    pool_counters::bump(local_pool_counters()._misses);
+
+#if ORC_FEATURE(PROFILE_EMPOOL)
+    ZoneColor(tracy::Color::ColorType::Red); // cache miss
+#endif // ORC_FEATURE(PROFILE_EMPOOL)
+
+    return ptr;
+}
+
+const char* adopt(const char* data, std::size_t h) {
+    if (const char* c = find_key(h)) return c;
+
+    const int index = h % string_pool_count_k;
+    std::lock_guard<string_pool_mutex> pool_guard(pool_mutex(index));
+
+    // As with `intern`, another thread may have gotten here first.
+    if (const char* c = find_key(h)) return c;
+
+    pool_keys().insert(std::make_pair(h, data));
+
+    return data;
+}
+
+/**************************************************************************************************/
+
+#endif // ORC_FEATURE(LOCK_FREE_STRING_POOL)
+
+/**************************************************************************************************/
+
 } // namespace
 
 /**************************************************************************************************/
@@ -178,12 +538,18 @@ std::size_t pool_string::get_hash(const char* d) {
     return orc::unaligned_read<std::size_t>(bytes);
 }
 
-pool_string empool(std::string_view src) {
-#if ORC_FEATURE(PROFILE_EMPOOL)
-    ZoneScoped;
-    ZoneColor(tracy::Color::ColorType::Green); // cache hit
-    ZoneText(src.data(), src.size());
-#endif // ORC_FEATURE(PROFILE_EMPOOL)
+/**************************************************************************************************/
+
+std::size_t empool_hash(std::string_view src) { return string_view_hash(src); }
+
+/**************************************************************************************************/
+
+pool_string empool(std::string_view src) { return empool(src, string_view_hash(src)); }
+
+/**************************************************************************************************/
+
+pool_string empool(std::string_view src, std::size_t hash) {
+    assert(hash == string_view_hash(src));
 
     // A pool_string is empty iff _data = nullptr
     // So this creates an empty pool_string (as opposed to an empty string_view, where
@@ -192,48 +558,40 @@ pool_string empool(std::string_view src) {
         return pool_string(nullptr);
     }
 
-    static decltype(auto) keys =
-        orc::make_leaky<tbb::concurrent_unordered_map<size_t, const char*>>();
+    pool_counters::bump(local_pool_counters()._lookups);
 
-    const std::size_t h = string_view_hash(src);
+    pool_string ps(intern(src, hash));
+    assert(ps.view() == src);
+    return ps;
+}
 
-    auto find_key = [&](std::size_t h) -> const char* {
-        const auto found = keys.find(h);
-        return found == keys.end() ? nullptr : found->second;
-    };
+/**************************************************************************************************/
 
-    if (const char* c = find_key(h)) {
-        pool_string ps(c);
-        assert(ps.view() == src);
-        return ps;
+empool_stats empool_statistics() {
+    empool_stats result;
+    result._bytes = pool_bytes().load();
+
+    std::size_t misses{0};
+    std::lock_guard<std::mutex> lock(pool_counters_mutex());
+    for (const auto& counters : all_pool_counters()) {
+        result._lookups += counters->_lookups.load(std::memory_order_relaxed);
+        misses += counters->_misses.load(std::memory_order_relaxed);
     }
 
-    const int index = h % string_pool_count_k;
-    std::lock_guard<string_pool_mutex> pool_guard(pool_mutex(index));
+    result._hits = result._lookups - std::min(misses, result._lookups);
 
-    // Now that we have the lock, do the search again in case another thread empooled the string
-    // while we were waiting for the lock.
-    if (const char* c = find_key(h)) {
-#if ORC_FEATURE(PROFILE_EMPOOL)
-        ZoneColor(tracy::Color::ColorType::Orange); // cache "half-hit"
-#endif // ORC_FEATURE(PROFILE_EMPOOL)
+    return result;
+}
 
-        pool_string ps(c);
-        assert(ps.view() == src);
-        return ps;
-    }
+/**************************************************************************************************/
 
-    // Not already interned; empool it and add to the 'keys'
-    // The pools are not threadsafe, so we need one per mutex
-    const char* ptr = pool(index).empool(src);
-    assert(ptr);
-    keys.insert(std::make_pair(h, ptr));
+pool_string empool_adopt(const char* data) {
+    assert(data);
 
-#if ORC_FEATURE(PROFILE_EMPOOL)
-    ZoneColor(tracy::Color::ColorType::Red); // cache miss
-#endif // ORC_FEATURE(PROFILE_EMPOOL)
+    const std::size_t h = pool_string::get_hash(data);
+    assert(h == string_view_hash(std::string_view(data, pool_string::get_size(data))));
 
-    return pool_string(ptr);
+    return pool_string(adopt(data, h));
 }
 
 /**************************************************************************************************/
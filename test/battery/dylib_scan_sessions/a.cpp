@@ -0,0 +1,5 @@
+struct object {
+    bool _x;
+};
+
+int a(const object& o) { return o._x; }
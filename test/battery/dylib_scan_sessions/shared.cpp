@@ -0,0 +1,6 @@
+struct object {
+    bool _x;
+    bool _y;
+};
+
+int shared(const object& o) { return o._x; }
@@ -0,0 +1,14 @@
+struct object {
+    int f();
+};
+
+inline int object::f() {
+    struct local {
+        bool _x;
+    };
+
+    local l{true};
+    return l._x;
+}
+
+int one() { return object().f(); }
@@ -0,0 +1,15 @@
+struct object {
+    int f();
+};
+
+inline int object::f() {
+    struct local {
+        bool _x;
+        bool _y;
+    };
+
+    local l{true, false};
+    return l._x;
+}
+
+int two() { return object().f(); }
@@ -1,8 +1,12 @@
 // stdc++
 #include <array>
+#include <chrono>
+#include <cmath>
 #include <exception>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <map>
 #include <sstream>
 #include <unordered_map>
 
@@ -10,6 +14,9 @@
 #include <fcntl.h>
 #include <unistd.h>
 
+// json
+#include "nlohmann/json.hpp"
+
 // toml++
 #include <toml++/toml.h>
 
@@ -17,6 +24,7 @@
 #include <orc/dwarf.hpp>
 #include <orc/macho.hpp>
 #include <orc/orc.hpp>
+#include <orc/settings.hpp>
 #include <orc/tracy.hpp>
 
 /**************************************************************************************************/
@@ -27,6 +35,8 @@ namespace {
 
 struct orc_test_settings {
     bool _json_mode{false};
+    std::filesystem::path _perf_baseline; // see `perf_gate`
+    bool _perf_update{false}; // write the baseline instead of comparing against it
 };
 
 auto& test_settings() {
@@ -161,15 +171,32 @@ struct compilation_unit {
 
 /**************************************************************************************************/
 
+std::string object_file_stem(const compilation_unit& unit) {
+    return !unit._object_file_name.empty() ? unit._object_file_name : unit._src.stem().string();
+}
+
 auto object_file_path(const std::filesystem::path& battery_path, const compilation_unit& unit) {
-    auto stem =
-        !unit._object_file_name.empty() ? unit._object_file_name : unit._src.stem().string();
     auto result = std::filesystem::temp_directory_path() / "orc_test" / battery_path.filename() /
-                  (stem + ".obj");
+                  (object_file_stem(unit) + ".obj");
     create_directories(result.parent_path());
     return result;
 }
 
+/**************************************************************************************************/
+// A dylib linked from some of the test's object files. When a test has any, they are the roots of
+// a dylib scan, instead of the object files being scanned directly.
+struct linked_dylib {
+    std::string _name;
+    std::vector<std::string> _objects; // by object file stem (see `object_file_stem`)
+    std::optional<std::string> _path; // only set this if you want to delete the dylib
+
+    ~linked_dylib() {
+        if (_path) {
+            unlink(_path->c_str());
+        }
+    }
+};
+
 /**************************************************************************************************/
 
 std::string exec(std::string cmd) {
@@ -350,6 +377,86 @@ std::vector<std::filesystem::path> compile_compilation_units(const std::filesyst
 
 /**************************************************************************************************/
 
+std::vector<linked_dylib> derive_linked_dylibs(const toml::table& settings) {
+    std::vector<linked_dylib> result;
+    const toml::array* arr = settings["dylib"].as_array();
+    if (!arr) return result;
+    for (const toml::node& dylib_node : *arr) {
+        const toml::table* dylib_ptr = dylib_node.as_table();
+        if (!dylib_ptr) {
+            throw std::runtime_error(std::string("expected a dylib table, found: ") +
+                                     to_string(dylib_node.type()));
+        }
+        const toml::table& src = *dylib_ptr;
+        linked_dylib dylib;
+
+        std::optional<std::string_view> name = src["name"].value<std::string_view>();
+        if (!name) {
+            throw std::runtime_error("Missing required dylib key \"name\"");
+        }
+        dylib._name = *name;
+
+        if (const toml::array* objects = src["objects"].as_array()) {
+            for (const auto& object : *objects) {
+                if (std::optional<std::string_view> stem = object.value<std::string_view>()) {
+                    dylib._objects.emplace_back(*stem);
+                }
+            }
+        }
+
+        if (dylib._objects.empty()) {
+            throw std::runtime_error("dylib " + dylib._name + " has no objects");
+        }
+
+        result.push_back(dylib);
+    }
+    return result;
+}
+
+/**************************************************************************************************/
+// Links each dylib from the object files already compiled for `units`, which must outlive them.
+std::vector<std::filesystem::path> link_dylibs(const std::filesystem::path& home,
+                                               const toml::table& settings,
+                                               const std::vector<compilation_unit>& units,
+                                               std::vector<linked_dylib>& dylibs) {
+    std::vector<std::filesystem::path> result;
+    const bool preserve_object_files =
+        settings["orc_test_flags"]["preserve_object_files"].value_or(false);
+    console() << "Linking " << dylibs.size() << " dylib(s):\n";
+    for (auto& dylib : dylibs) {
+        auto temp_path = std::filesystem::temp_directory_path() / "orc_test" / home.filename() /
+                         (dylib._name + ".dylib");
+        create_directories(temp_path.parent_path());
+        if (preserve_object_files) {
+            console() << temp_path << '\n';
+        } else {
+            dylib._path = temp_path;
+        }
+        std::string command(path_to_clang());
+        command += " -dynamiclib";
+        for (const auto& stem : dylib._objects) {
+            auto found = std::find_if(units.begin(), units.end(), [&](const auto& unit) {
+                return object_file_stem(unit) == stem;
+            });
+            if (found == units.end()) {
+                throw std::runtime_error("dylib " + dylib._name + " names unknown object " + stem);
+            }
+            command += " " + object_file_path(home, *found).string();
+        }
+        command += " -o " + temp_path.string();
+        std::string output = exec(command.c_str());
+        if (!output.empty()) {
+            console() << output;
+            throw std::runtime_error("unexpected link failure");
+        }
+        result.emplace_back(std::move(temp_path));
+        console() << "    " << result.back().filename() << '\n';
+    }
+    return result;
+}
+
+/**************************************************************************************************/
+
 std::vector<expected_odrv> derive_expected_odrvs(const std::filesystem::path& home,
                                                  const toml::table& settings) {
     std::vector<expected_odrv> result;
@@ -392,7 +499,7 @@ bool odrv_report_match(const expected_odrv& odrv, const odrv_report& report) {
 
     const std::string& linkage_name = demangle(odrv.linkage_name().c_str());
     if (!linkage_name.empty()) {
-        const auto& die_pair = report.conflict_map().begin()->second;
+        const auto& die_pair = report.conflicts().front();
         const char* report_linkage_name = demangle(die_pair._attributes.string(dw::at::linkage_name).view().begin());
         if (linkage_name != report_linkage_name)
             return false;
@@ -404,6 +511,211 @@ bool odrv_report_match(const expected_odrv& odrv, const odrv_report& report) {
 
 constexpr const char* tomlname_k = "odrv_test.toml";
 
+/**************************************************************************************************/
+// What a battery test cost to process. The counters are the ones ORC prints in its synopsis, and
+// they are what catch a change that makes ORC do more work than it should (e.g., a `skip_die`
+// filter that no longer fires) long before its timings would.
+struct perf_sample {
+    double _process_seconds{0};
+    std::size_t _dies_processed{0};
+    std::size_t _dies_skipped{0};
+    std::size_t _unique_symbols{0};
+
+    double dies_skipped_pct() const {
+        return _dies_processed ? _dies_skipped * 100. / _dies_processed : 0;
+    }
+};
+
+auto& perf_samples() {
+    static std::map<std::string, perf_sample> result; // sorted, so the baseline diffs well
+    return result;
+}
+
+/**************************************************************************************************/
+
+toml::table to_toml(const perf_sample& sample) {
+    toml::table result;
+    result.insert("process_seconds", sample._process_seconds);
+    result.insert("dies_processed", static_cast<toml::int64_t>(sample._dies_processed));
+    result.insert("dies_skipped", static_cast<toml::int64_t>(sample._dies_skipped));
+    result.insert("dies_skipped_pct", sample.dies_skipped_pct());
+    result.insert("unique_symbols", static_cast<toml::int64_t>(sample._unique_symbols));
+    return result;
+}
+
+/**************************************************************************************************/
+// How far a sample may stray from its baseline before it counts as a regression. These are the
+// defaults; a baseline file can override any of them in its `[tolerance]` table.
+struct perf_tolerance {
+    double _dies_skipped_pct{1}; // points the skipped share may drop
+    double _counts{0.05}; // relative change allowed in the die and symbol counts, either way
+    double _process_seconds{1}; // relative increase allowed in processing time...
+    double _process_seconds_slack{0.25}; // ...plus this many seconds, as small tests are noisy
+};
+
+perf_tolerance derive_perf_tolerance(const toml::table& baseline) {
+    perf_tolerance result;
+    const auto& tolerance = baseline["tolerance"];
+    result._dies_skipped_pct =
+        tolerance["dies_skipped_pct"].value_or(result._dies_skipped_pct);
+    result._counts = tolerance["counts"].value_or(result._counts);
+    result._process_seconds = tolerance["process_seconds"].value_or(result._process_seconds);
+    result._process_seconds_slack =
+        tolerance["process_seconds_slack"].value_or(result._process_seconds_slack);
+    return result;
+}
+
+/**************************************************************************************************/
+
+std::optional<toml::table> read_perf_baseline(const std::filesystem::path& path) {
+    if (!exists(path)) return std::nullopt;
+
+    try {
+        return toml::parse_file(path.string());
+    } catch (const toml::parse_error& error) {
+        console_error() << error << '\n';
+        throw std::runtime_error("performance baseline parsing error");
+    }
+}
+
+/**************************************************************************************************/
+// Rewrites the baseline with the samples from this run, keeping its tolerances (if any). Cases
+// that did not run this time (e.g., they were disabled) keep their old entries.
+void write_perf_baseline(const std::filesystem::path& path) {
+    toml::table baseline = read_perf_baseline(path).value_or(toml::table());
+
+    if (!baseline["cases"].is_table()) {
+        baseline.insert_or_assign("cases", toml::table());
+    }
+
+    toml::table& cases = *baseline["cases"].as_table();
+
+    for (const auto& [name, sample] : perf_samples()) {
+        cases.insert_or_assign(name, to_toml(sample));
+    }
+
+    std::ofstream out(path);
+    if (!out) {
+        throw std::runtime_error("could not write performance baseline " + path.string());
+    }
+    out << baseline << '\n';
+
+    console() << "Wrote performance baseline for " << perf_samples().size() << " test(s) to "
+              << path << '\n';
+}
+
+/**************************************************************************************************/
+// Compares the samples from this run against the baseline, and logs an error for every one that
+// has regressed. Returns the number of regressions. Until a baseline has been recorded (there is no
+// file, or it has no cases) nothing is gated, but that is logged as a warning. Once there is one, a
+// case it knows nothing about counts as a regression, so a new test can't go ungated. Timings are
+// only compared for cases that have them recorded, as they depend on the machine.
+std::size_t perf_gate(const std::filesystem::path& path) {
+    auto baseline_opt = read_perf_baseline(path);
+    const toml::table* cases = baseline_opt ? (*baseline_opt)["cases"].as_table() : nullptr;
+
+    if (!cases || cases->empty()) {
+        logging::warning("no performance baseline recorded at " + path.string() +
+                         "; nothing was gated. Run with --perf_update to record one");
+        return 0;
+    }
+
+    const toml::table& baseline = *baseline_opt;
+    const perf_tolerance tolerance = derive_perf_tolerance(baseline);
+    std::size_t result{0};
+    std::size_t missing{0};
+
+    const auto regressed = [&](const std::string& name, const std::string& message) {
+        logging::error(message, "Performance regression", name);
+        ++result;
+    };
+
+    const auto count_regressed = [&](const std::string& name,
+                                     const char* key,
+                                     std::size_t actual,
+                                     std::int64_t expected) {
+        const double delta = std::abs(static_cast<double>(actual) - expected);
+        if (delta <= expected * tolerance._counts) return;
+        regressed(name, std::string(key) + " is " + std::to_string(actual) + "; baseline is " +
+                            std::to_string(expected));
+    };
+
+    for (const auto& [name, sample] : perf_samples()) {
+        const auto& entry = baseline["cases"][name];
+
+        if (!entry.is_table()) {
+            logging::error("no performance baseline for this test", "Performance regression",
+                           name);
+            ++missing;
+            ++result;
+            continue;
+        }
+
+        const double skipped_pct = entry["dies_skipped_pct"].value_or(0.);
+        if (sample.dies_skipped_pct() < skipped_pct - tolerance._dies_skipped_pct) {
+            regressed(name, "dies_skipped_pct is " + std::to_string(sample.dies_skipped_pct()) +
+                                "; baseline is " + std::to_string(skipped_pct));
+        }
+
+        count_regressed(name, "dies_processed", sample._dies_processed,
+                        entry["dies_processed"].value_or(std::int64_t(0)));
+        count_regressed(name, "unique_symbols", sample._unique_symbols,
+                        entry["unique_symbols"].value_or(std::int64_t(0)));
+
+        const auto seconds = entry["process_seconds"].value<double>();
+        if (!seconds) continue;
+        const double seconds_limit =
+            *seconds * (1 + tolerance._process_seconds) + tolerance._process_seconds_slack;
+        if (sample._process_seconds > seconds_limit) {
+            regressed(name, "process_seconds is " + std::to_string(sample._process_seconds) +
+                                "; baseline is " + std::to_string(*seconds));
+        }
+    }
+
+    if (missing) {
+        console_error() << missing << " test(s) have no performance baseline; rerun with "
+                        << "--perf_update to record them\n";
+    }
+
+    if (result) {
+        console_error() << result << " performance regression(s) against " << path
+                        << "; if they are expected, rerun with --perf_update\n";
+    }
+
+    return result;
+}
+
+/**************************************************************************************************/
+// Writes the reports as ORC's JSON output would, and makes sure every one of them can be read back
+// out of it. A symbol with several reports has them in an array, and a symbol repeated as a key
+// would be caught here, as parsing keeps only the last of them.
+void check_json_reports(const std::vector<odrv_report>& reports) {
+    std::stringstream json;
+    orc::to_json(json, reports);
+
+    const auto violations = nlohmann::json::parse(json.str())["violations"];
+    std::size_t count{0};
+    for (const auto& value : violations) {
+        count += value.is_array() ? value.size() : 1;
+    }
+
+    if (count != reports.size()) {
+        throw std::runtime_error("JSON output has " + std::to_string(count) + " of " +
+                                 std::to_string(reports.size()) + " ODRV report(s)");
+    }
+}
+
+/**************************************************************************************************/
+// Applies the test's `[orc_flags]` to the ORC engine's settings. They have the names they have in
+// the ORC config file.
+void apply_orc_flags(const toml::table& settings) {
+    auto& orc_settings = settings::instance();
+    const auto& flags = settings["orc_flags"];
+
+    orc_settings._hash_partitions =
+        flags["hash_partitions"].value_or(orc_settings._hash_partitions);
+}
+
 /**************************************************************************************************/
 
 void run_battery_test(const std::filesystem::path& home) {
@@ -453,14 +765,48 @@ void run_battery_test(const std::filesystem::path& home) {
 
     auto object_files = compile_compilation_units(home, settings, compilation_units);
 
+    // With dylibs to link, the test is a dylib scan of them instead.
+    auto dylibs = derive_linked_dylibs(settings);
+    auto& orc_settings = settings::instance();
+    // The test's settings only last for the test.
+    const struct settings saved_settings = orc_settings;
+
+    apply_orc_flags(settings);
+
+    if (!dylibs.empty()) {
+        object_files = link_dylibs(home, settings, compilation_units, dylibs);
+        orc_settings._dylib_scan_mode = true;
+        orc_settings._dylib_scan_sessions =
+            settings["orc_test_flags"]["dylib_scan_sessions"].value_or(false);
+    }
+
     orc_reset();
+
+    auto& globals = globals::instance();
+    globals._unique_symbol_count = 0;
+    globals._die_processed_count = 0;
+    globals._die_skipped_count = 0;
+
+    const auto process_start = std::chrono::steady_clock::now();
     auto reports = orc_process(std::move(object_files));
+    const std::chrono::duration<double> process_duration =
+        std::chrono::steady_clock::now() - process_start;
+
+    orc_settings = saved_settings;
+
+    perf_sample sample;
+    sample._process_seconds = process_duration.count();
+    sample._dies_processed = globals._die_processed_count;
+    sample._dies_skipped = globals._die_skipped_count;
+    sample._unique_symbols = globals._unique_symbol_count;
+    perf_samples()[test_name] = sample;
 
     console() << "ODRVs expected: " << expected_odrvs.size() << "; reported: " << reports.size() << '\n';
 
     toml::table result;
     result.insert("expected", static_cast<toml::int64_t>(expected_odrvs.size()));
     result.insert("reported", static_cast<toml::int64_t>(reports.size()));
+    result.insert("perf", to_toml(sample));
     toml_out().insert(test_name, std::move(result));
 
     // At this point, the reports.size() should match the expected_odrvs.size()
@@ -500,6 +846,8 @@ void run_battery_test(const std::filesystem::path& home) {
 
         throw std::runtime_error("ODRV count mismatch");
     }
+
+    check_json_reports(reports);
 }
 
 /**************************************************************************************************/
@@ -533,7 +881,9 @@ int main(int argc, char** argv) try {
     orc::profiler::initialize();
 
     if (argc < 2) {
-        console_error() << "Usage: " << argv[0] << " /path/to/test/battery/\n";
+        console_error() << "Usage: " << argv[0]
+                        << " /path/to/test/battery/ [--json_mode] [--perf_baseline file]"
+                           " [--perf_update]\n";
         throw std::runtime_error("no path to test battery given");
     }
 
@@ -543,17 +893,43 @@ int main(int argc, char** argv) try {
         throw std::runtime_error("test battery path is missing or not a directory");
     }
 
-    test_settings()._json_mode = argc > 2 && std::string(argv[2]) == "--json_mode";
+    auto& settings = test_settings();
+
+    // The baseline is checked in next to the battery.
+    auto battery_dir = battery_path.lexically_normal();
+    if (!battery_dir.has_filename()) battery_dir = battery_dir.parent_path(); // trailing slash
+    settings._perf_baseline = battery_dir.parent_path() / "perf_baseline.toml";
+
+    for (int i = 2; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        if (arg == "--json_mode") {
+            settings._json_mode = true;
+        } else if (arg == "--perf_update") {
+            settings._perf_update = true;
+        } else if (arg == "--perf_baseline" && i + 1 < argc) {
+            settings._perf_baseline = argv[++i];
+        } else {
+            throw std::runtime_error("unknown argument: " + arg);
+        }
+    }
 
     traverse_directory_tree(battery_path);
 
-    if (test_settings()._json_mode) {
+    std::size_t regressions{0};
+
+    if (settings._perf_update) {
+        write_perf_baseline(settings._perf_baseline);
+    } else {
+        regressions = perf_gate(settings._perf_baseline);
+    }
+
+    if (settings._json_mode) {
         cout_safe([&](auto& s){
             s << toml::json_formatter{ toml_out() } << '\n';
         });
     }
 
-    return EXIT_SUCCESS;
+    return regressions ? EXIT_FAILURE : EXIT_SUCCESS;
 } catch (const std::exception& error) {
     logging::error(error.what(), "Fatal error");
     return EXIT_FAILURE;